@@ -192,8 +192,12 @@ static inline float fixf(float v, float def){
     return v;
 }
 
-void sf_compressor_process(sf_compressor_state_st *state, int size, sf_sample_st *input,
-    sf_sample_st *output){
+// the compressor core works on strided channel pointers so the same code can serve both the
+// stereo sf_sample_st layout and plain mono float buffers.  inR/outR are NULL for mono, in which
+// case the right channel is treated as silent.  input and output may be the same buffer, as each
+// input sample is read before its output sample is written.
+static void sf_compressor_process_channels(sf_compressor_state_st *state, int size,
+    const float *inL, const float *inR, float *outL, float *outR, int stride){
 
     // pull out the state into local variables
     float metergain            = state->metergain;
@@ -267,8 +271,8 @@ void sf_compressor_process(sf_compressor_state_st *state, int size, sf_sample_st
             delayreadpos = (delayreadpos + 1) % delaybufsize,
             delaywritepos = (delaywritepos + 1) % delaybufsize){
 
-            float inputL = input[samplepos].L * linearpregain;
-            float inputR = input[samplepos].R * linearpregain;
+            float inputL = inL[samplepos * stride] * linearpregain;
+            float inputR = inR ? inR[samplepos * stride] * linearpregain : 0.0f;
             delaybuf[delaywritepos] = (sf_sample_st){ .L = inputL, .R = inputR };
 
             inputL = absf(inputL);
@@ -320,10 +324,9 @@ void sf_compressor_process(sf_compressor_state_st *state, int size, sf_sample_st
                 metergain += (premixgaindb - metergain) * meterrelease; // fall slowly
 
             // apply the gain
-            output[samplepos] = (sf_sample_st){
-                .L = delaybuf[delayreadpos].L * gain,
-                .R = delaybuf[delayreadpos].R * gain
-            };
+            outL[samplepos * stride] = delaybuf[delayreadpos].L * gain;
+            if (outR)
+                outR[samplepos * stride] = delaybuf[delayreadpos].R * gain;
         }
     }
 
@@ -334,3 +337,14 @@ void sf_compressor_process(sf_compressor_state_st *state, int size, sf_sample_st
     state->delaywritepos = delaywritepos;
     state->delayreadpos  = delayreadpos;
 }
+
+void sf_compressor_process(sf_compressor_state_st *state, int size, sf_sample_st *input,
+    sf_sample_st *output){
+    sf_compressor_process_channels(state, size, &input[0].L, &input[0].R, &output[0].L,
+        &output[0].R, 2);
+}
+
+void sf_compressor_process_mono(sf_compressor_state_st *state, int size, const float *input,
+    float *output){
+    sf_compressor_process_channels(state, size, input, NULL, output, NULL, 1);
+}
@@ -111,6 +111,11 @@ void sf_advancecomp(sf_compressor_state_st *state,
 void sf_compressor_process(sf_compressor_state_st *state, int size, sf_sample_st *input,
     sf_sample_st *output);
 
+// mono version of sf_compressor_process, working on plain float samples; input and output may
+// point to the same buffer to process in place
+void sf_compressor_process_mono(sf_compressor_state_st *state, int size, const float *input,
+    float *output);
+
 SF_API_END
 
 #endif // SNDFILTER_COMPRESSOR__H
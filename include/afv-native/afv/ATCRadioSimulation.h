@@ -31,19 +31,23 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-#ifndef AFV_NATIVE_RADIOSIMULATION_H
-#define AFV_NATIVE_RADIOSIMULATION_H
+#ifndef AFV_NATIVE_ATCRADIOSIMULATION_H
+#define AFV_NATIVE_ATCRADIOSIMULATION_H
 
 #include "afv-native/Log.h"
 #include "afv-native/afv/EffectResources.h"
 #include "afv-native/afv/RemoteVoiceSource.h"
 #include "afv-native/afv/RollingAverage.h"
+#include "afv-native/afv/StreamRegistry.h"
+#include "afv-native/afv/TransmitPipeline.h"
 #include "afv-native/afv/VoiceCompressionSink.h"
 #include "afv-native/afv/dto/CrossCoupleGroup.h"
 #include "afv-native/afv/dto/StationTransceiver.h"
 #include "afv-native/afv/dto/Transceiver.h"
 #include "afv-native/afv/dto/voice_server/AudioRxOnTransceivers.h"
+#include "afv-native/afv/dto/voice_server/AudioRxOnTransceiversView.h"
 #include "afv-native/afv/dto/voice_server/AudioTxOnTransceivers.h"
+#include "afv-native/audio/EffectVoice.h"
 #include "afv-native/audio/ISampleSink.h"
 #include "afv-native/audio/ISampleSource.h"
 #include "afv-native/audio/ITick.h"
@@ -58,6 +62,7 @@
 #include "afv-native/event/EventCallbackTimer.h"
 #include "afv-native/hardwareType.h"
 #include "afv-native/util/ChainedCallback.h"
+#include "afv-native/util/SnapshotPointer.h"
 #include "afv-native/util/other.h"
 #include "afv-native/utility.h"
 #include <atomic>
@@ -82,50 +87,86 @@ namespace afv_native { namespace afv {
         bool                              onHeadset = false;
     };
 
-    /** RadioState is the internal state object for each radio within a ATCRadioSimulation.
+    /** AtcRadioState is the configuration of each radio within a ATCRadioSimulation.
      *
-     * It tracks the current playback position of the mixing effects, the channel frequency and gain.
+     * Radio states are published to the renderer, and handed out by getRadioState, as immutable
+     * snapshots - to change one, the ATCRadioSimulation copies it, edits the copy, and publishes
+     * the result.  The renderer's working state for the radio lives in AtcRadioFx instead.
      */
     class AtcRadioState {
       public:
-        unsigned int                                 Frequency;
-        float                                        Gain = 1.0;
-        std::shared_ptr<audio::RecordedSampleSource> Click;
-        std::shared_ptr<audio::RecordedSampleSource> Crackle;
-        std::shared_ptr<audio::RecordedSampleSource> AcBus;
-        std::shared_ptr<audio::RecordedSampleSource> VhfWhiteNoise;
-        std::shared_ptr<audio::RecordedSampleSource> HfWhiteNoise;
-        std::shared_ptr<audio::SineToneSource>       BlockTone;
-        audio::SimpleCompressorEffect                simpleCompressorEffect;
-        std::shared_ptr<audio::VHFFilterSource>      vhfFilter;
-        int                                          mLastRxCount;
-        bool                                         mBypassEffects    = false;
-        bool                                         mHfSquelch        = false;
-        bool                                         onHeadset         = true;
-        bool                                         tx                = false;
-        bool                                         rx                = true;
-        bool                                         xc                = false;
-        bool                                         crossCoupleAcross = false;
-        std::string                                  stationName       = "";
-        std::vector<dto::Transceiver>                transceivers;
-        HardwareType    simulatedHardware = HardwareType::Schmid_ED_137B;
-        bool            isATIS            = false;
-        PlaybackChannel playbackChannel   = PlaybackChannel::Both;
-
-        std::string              lastTransmitCallsign      = "";
-        std::vector<std::string> liveTransmittingCallsigns = {};
-        time_t                   lastVoiceTime;
+        unsigned int                  Frequency;
+        float                         Gain              = 1.0;
+        bool                          mBypassEffects    = false;
+        bool                          mHfSquelch        = false;
+        bool                          onHeadset         = true;
+        bool                          tx                = false;
+        bool                          rx                = true;
+        bool                          xc                = false;
+        bool                          crossCoupleAcross = false;
+        std::string                   stationName       = "";
+        std::vector<dto::Transceiver> transceivers;
+        HardwareType                  simulatedHardware = HardwareType::Schmid_ED_137B;
+        bool                          isATIS            = false;
+        PlaybackChannel               playbackChannel   = PlaybackChannel::Both;
+
+        std::string lastTransmitCallsign = "";
     };
 
-    /** CallsignMeta is the per-packetstream metadata stored within the ATCRadioSimulation object.
+    typedef std::map<unsigned int, AtcRadioState> AtcRadioStateMap;
+
+    /** AtcRadioFx is the renderer's working state for each radio.
      *
-     * It's used to hold the RemoteVoiceSource object for that callsign+channel combination,
-     * and the list of transceivers that this packet stream relates to.
+     * It tracks the current playback position of the mixing effects, and is only ever touched by
+     * the output holding mRendering (other than mLastRxCount, which may be read from anywhere, and
+     * mRxEvents, which the event loop takes).
+     *
+     * Everything here is created up front with the radio, and the renderer only ever starts,
+     * stops and resets it, so it never allocates when a transmission starts or ends.
+     */
+    class AtcRadioFx {
+      public:
+        AtcRadioFx(const EffectResources &resources, HardwareType hardware);
+
+        audio::EffectVoice            Click;
+        audio::EffectVoice            Crackle;
+        audio::EffectVoice            AcBus;
+        audio::EffectVoice            VhfWhiteNoise;
+        audio::EffectVoice            HfWhiteNoise;
+        audio::SineToneSource         BlockTone;
+        audio::SimpleCompressorEffect simpleCompressorEffect;
+        audio::VHFFilterSource        vhfFilter;
+        std::atomic<int>              mLastRxCount{0};
+        /** mRendering is held by the output rendering the radio.  A radio only moves between the
+         * outputs when it's switched between headset and speaker, and this stops the two outputs
+         * from both working on it while their snapshots disagree.
+         */
+        std::atomic<bool> mRendering{false};
+
+        /** mBlockTonePlaying and mEffectsActive record whether BlockTone, and the rest of the
+         * receive effects, are part way through playing.  They're restarted from the beginning
+         * whenever they're next needed after being stopped.
+         */
+        bool mBlockTonePlaying = false;
+        bool mEffectsActive    = false;
+
+        /** mRxEvents holds the receive events the renderer has seen but the event loop hasn't
+         * reported yet, as RxBeginPending and RxEndPending.  RxEndFirst records which of the two
+         * happened first if both are pending.  The renderer only ever sets them, and the event loop
+         * takes them all at once.
+         */
+        static const uint8_t RxBeginPending = 0x01;
+        static const uint8_t RxEndPending   = 0x02;
+        static const uint8_t RxEndFirst     = 0x04;
+        std::atomic<uint8_t> mRxEvents{0};
+    };
+
+    /** AtcRadioActivity tracks who is currently transmitting on each radio, for the client
+     * events.  It's protected by ATCRadioSimulation::mRadioStateLock.
      */
-    struct AtcCallsignMeta {
-        std::shared_ptr<RemoteVoiceSource> source;
-        std::vector<dto::RxTransceiver>    transceivers;
-        AtcCallsignMeta();
+    struct AtcRadioActivity {
+        std::vector<std::string> liveTransmittingCallsigns = {};
+        time_t                   lastVoiceTime             = 0;
     };
 
     enum class AtcRadioSimulationState {
@@ -143,25 +184,36 @@ namespace afv_native { namespace afv {
      * methods) and instead provides the Ptt functions to control the conversion of said input into
      * voice packets.
      */
-    class ATCRadioSimulation: public std::enable_shared_from_this<ATCRadioSimulation>, public audio::ISampleSink, public ICompressedFrameSink {
+    class ATCRadioSimulation: public std::enable_shared_from_this<ATCRadioSimulation>, public audio::ISampleSink {
       public:
         ATCRadioSimulation(struct event_base *evBase, std::shared_ptr<EffectResources> resources, cryptodto::UDPChannel *channel);
         virtual ~ATCRadioSimulation();
 
         ATCRadioSimulation(const ATCRadioSimulation &copySrc) = delete;
 
-        bool _packetListening(const afv::dto::AudioRxOnTransceivers &pkt);
-        void rxVoicePacket(const afv::dto::AudioRxOnTransceivers &pkt);
+        bool _packetListening(const afv::dto::AudioRxOnTransceiversView &pkt);
+        void rxVoicePacket(const afv::dto::AudioRxOnTransceiversView &pkt);
+        /** These overloads take the time the packet arrived at, for packets built up in memory
+         * rather than received, such as HeadlessRenderer's.
+         */
+        void rxVoicePacket(const afv::dto::AudioRxOnTransceiversView &pkt, util::monotime_t now);
+        void rxVoicePacket(const afv::dto::AudioRxOnTransceivers &pkt, util::monotime_t now);
 
         void setCallsign(const std::string &newCallsign);
         void setClientPosition(double lat, double lon, double amslm, double aglm);
 
         bool addFrequency(unsigned int radio, bool onHeadset, std::string stationName = "", HardwareType hardware = HardwareType::Schmid_ED_137B, PlaybackChannel channel = PlaybackChannel::Both);
         void removeFrequency(unsigned int freq);
+        /** isFrequencyActive and isFrequencyActiveButUnused must be called with mRadioStateLock
+         * held.  Use getRadioState from outside the simulation.
+         */
         bool isFrequencyActive(unsigned int freq);
         bool isFrequencyActiveButUnused(unsigned int freq);
 
-        std::map<unsigned int, AtcRadioState> getRadioState();
+        /** getRadioState returns the current configuration of every radio.  The snapshot is
+         * shared, not copied, and never changes once it's been handed out.
+         */
+        std::shared_ptr<const AtcRadioStateMap> getRadioState();
 
         bool getRxState(unsigned int freq);
         bool getTxState(unsigned int freq);
@@ -237,6 +289,44 @@ namespace afv_native { namespace afv {
             return mHeadsetDevice;
         }
 
+        /** logAudioStatistics dumps the per-output render and transmit counters to the AFV log. */
+        void logAudioStatistics();
+
+        /** getRenderTimings returns how long the headset or speaker output has spent in each
+         * stage of getAudioFrame so far.
+         */
+        OutputDeviceState::RenderTimings getRenderTimings(bool onHeadset);
+
+        /** setJitterLatencyMode picks how the received streams' jitterbuffers trade delay against
+         * loss.  It applies to current and future streams alike.
+         */
+        void setJitterLatencyMode(JitterLatencyMode mode);
+
+        /** setEnableTransmitFec turns Opus in-band FEC on or off for the voice we send.  See
+         * VoiceCompressionSink::setInbandFec.
+         */
+        void setEnableTransmitFec(bool enable, int expectedLossPercent);
+
+        /** getStreamJitterStatistics fills statsOut with the playout counters for callsign's
+         * stream.
+         *
+         * @return false if nothing is being received from callsign.
+         */
+        bool getStreamJitterStatistics(const std::string &callsign, JitterStatistics &statsOut);
+
+        /** getFrequencyJitterStatistics sums the playout counters of the streams being received on
+         * frequency.
+         */
+        JitterStatistics getFrequencyJitterStatistics(unsigned int frequency);
+
+        /** setMaxReceiveStreams caps how many callsigns have a decoder at once, replacing the least
+         * recently active when a new one is heard.  0, the default, removes the cap.
+         */
+        void setMaxReceiveStreams(unsigned int maxStreams);
+
+        /** getStreamPoolStatistics returns the received stream and decoder pool counters. */
+        StreamPoolStatistics getStreamPoolStatistics();
+
       protected:
         /** maintenanceTimerIntervalMs is the internal in milliseconds between periodic cleanups
          * of the inbound audio frame objects.
@@ -262,16 +352,51 @@ namespace afv_native { namespace afv {
         double                           mClientAltitudeMSLM = 100;
         double                           mClientAltitudeGLM  = 100;
 
-        std::mutex mStreamMapLock;
-        std::unordered_map<std::string, struct AtcCallsignMeta> mHeadsetIncomingStreams;
-        std::unordered_map<std::string, struct AtcCallsignMeta> mSpeakerIncomingStreams;
+        /** mIncomingStreams holds one decoder per callsign, shared by the headset and speaker
+         * outputs.  Decoded frames are cached per frame tick (see
+         * RemoteVoiceSource::getCachedAudioFrame) so each frame is only decoded once.
+         */
+        StreamRegistry mIncomingStreams;
+        /** mRenderStreams is the stream table for each output's render in progress, indexed by
+         * renderer number (see rendererFor).  Only valid during that output's getAudioFrame.
+         */
+        StreamRegistry::StreamTable *mRenderStreams[StreamRegistry::rendererCount] = {};
+        /** mLatestFrameTick is the newest frame tick rendered by either output. */
+        std::atomic<uint64_t> mLatestFrameTick{0};
 
-        std::mutex                            mRadioStateLock;
-        std::atomic<bool>                     mPtt;
-        bool                                  mLastFramePtt;
-        std::atomic<uint32_t>                 mTxSequence;
-        std::map<unsigned int, AtcRadioState> mRadioState;
-        std::shared_ptr<audio::ITick>         mTick;
+        /** RadioSnapshot is the renderer's view of the radios: each radio's configuration paired
+         * with its effects state, in frequency order.
+         */
+        struct RadioSnapshot {
+            struct Radio {
+                const AtcRadioState        *state;
+                std::shared_ptr<AtcRadioFx> fx;
+            };
+            std::shared_ptr<const AtcRadioStateMap> states;
+            std::vector<Radio>                      radios;
+        };
+
+        /** mRadioStateLock protects mRadioState, mRadioFx and mRadioActivity.  The renderer never
+         * takes it - it reads mRadioSnapshot instead, and leaves reporting receive events to the
+         * event loop (see raiseRxEvent).
+         */
+        std::mutex                                          mRadioStateLock;
+        std::atomic<bool>                                   mPtt;
+        /** mLastFramePtt is whether PTT was down for the previous captured frame.  Capture callback
+         * (and reset) only.
+         */
+        bool                                                mLastFramePtt;
+        std::atomic<uint32_t>                               mTxSequence;
+        std::shared_ptr<const AtcRadioStateMap>             mRadioState;
+        /** mTxTransceivers is the IDs of every transceiver on a transmitting radio, as of the last
+         * publishRadioState.  The transmit worker reads it with std::atomic_load, so it never
+         * needs mRadioStateLock.
+         */
+        std::shared_ptr<const std::vector<uint16_t>>        mTxTransceivers;
+        std::map<unsigned int, std::shared_ptr<AtcRadioFx>> mRadioFx;
+        std::map<unsigned int, AtcRadioActivity>            mRadioActivity;
+        util::SnapshotPointer<RadioSnapshot, StreamRegistry::rendererCount> mRadioSnapshot;
+        std::shared_ptr<audio::ITick>                       mTick;
 
         bool mDefaultEnableHfSquelch = false;
         bool mDefaultBypassEffects   = false;
@@ -291,34 +416,81 @@ namespace afv_native { namespace afv {
 
         event::EventCallbackTimer mMaintenanceTimer;
         event::EventCallbackTimer mVoiceTimeoutTimer;
+        /** mRxEventTimer is never scheduled - the renderer activates it to have the event loop
+         * report the receive events it has raised, with reportRxEvents.
+         */
+        event::EventCallbackTimer mRxEventTimer;
         RollingAverage<double>    mVuMeter;
 
-        void resetRadioFx(unsigned int radio, bool except_click = false);
+        /** mTxEncoded and mTxDto are reused for every frame sent, so that sending doesn't allocate
+         * once they have grown to size.  Transmit worker only.
+         */
+        std::vector<unsigned char> mTxEncoded;
+        dto::AudioTxOnTransceivers mTxDto;
+
+        /** mTransmitPipeline is declared last, so its thread is stopped before anything it uses
+         * is destroyed.
+         */
+        TransmitPipeline mTransmitPipeline;
 
-        void set_radio_effects(unsigned int rxIter);
+        /** processCapturedFrame filters and meters one captured frame, then encodes and sends it
+         * if it's being transmitted.  Transmit worker only.
+         */
+        void processCapturedFrame(const TransmitPipeline::Frame &frame);
 
-        bool mix_effect(std::shared_ptr<audio::ISampleSource> effect, float gain, std::shared_ptr<OutputDeviceState> state);
+        void resetRadioFx(AtcRadioFx &fx, bool except_click = false);
 
-        void processCompressedFrame(std::vector<unsigned char> compressedData) override;
+        /** set_radio_effects starts fx's receive effects, if they aren't already running. */
+        void set_radio_effects(AtcRadioFx &fx);
 
-        static void dtoHandler(const std::string &dtoName, const unsigned char *bufIn, size_t bufLen, void *user_data);
-        void instDtoHandler(const std::string &dtoName, const unsigned char *bufIn, size_t bufLen);
+        /** editRadioState returns a private copy of the current radio states to modify and pass to
+         * publishRadioState.  Both must be called with mRadioStateLock held.
+         */
+        std::shared_ptr<AtcRadioStateMap> editRadioState();
+        void                              publishRadioState(std::shared_ptr<const AtcRadioStateMap> radioState);
+
+        /** raiseRxEvent adds event to fx's pending receive events, and wakes the event loop to
+         * report them if it isn't due to already.  Renderer only.
+         */
+        void raiseRxEvent(AtcRadioFx &fx, uint8_t event);
+
+        /** reportRxEvents reports every radio's pending receive events.  Event loop only. */
+        void reportRxEvents();
+
+        /** flushRxEvents reports freq's receive events, taken from its mRxEvents.  Must be called
+         * with mRadioStateLock held.
+         */
+        void flushRxEvents(unsigned int freq, uint8_t events);
+
+        void mix_effect(audio::EffectVoice &effect, float gain, const std::shared_ptr<OutputDeviceState> &state);
+        void mix_effect(audio::ISampleSource &effect, float gain, const std::shared_ptr<OutputDeviceState> &state);
+
+        /** processCompressedFrame sends one encoded frame on the transmitting transceivers.
+         * Transmit worker only.
+         */
+        void processCompressedFrame(const std::vector<unsigned char> &compressedData, uint32_t sequence, bool lastPacket);
+
+        /** dtoHandler is the UDPChannel handler for received AudioRxOnTransceivers DTOs. */
+        static void dtoHandler(const unsigned char *bufIn, size_t bufLen, void *user_data);
+        void        instDtoHandler(const unsigned char *bufIn, size_t bufLen);
 
         void maintainIncomingStreams();
         void maintainVoiceTimeout();
 
       private:
-        bool _process_radio(const std::map<void *, audio::SampleType[audio::frameSizeSamples]> &sampleCache, unsigned int rxIter, bool onHeadset);
+        bool _process_radio(const RadioSnapshot::Radio &radio, bool onHeadset);
 
-        void interleave(audio::SampleType *leftChannel, audio::SampleType *rightChannel, audio::SampleType *outputBuffer, size_t numSamples);
+        /** gatherStreamFrames pulls every stream's frame for frameTick into renderer's frames in
+         * mRenderStreams[renderer].  Only from that output's getAudioFrame.
+         */
+        void gatherStreamFrames(uint64_t frameTick, size_t renderer);
 
         /** mix_buffers is a utility function that mixes two buffers of audio together. The src_dst
          * buffer is assumed to be the final output buffer and is modified by the mixing in place.
          * src2 is read-only and will be scaled by the provided linear gain.
          *
-         * @note as this mixer has some really fundamental assumptions about buffer alignment which
-         * are required as it uses SSE2 intrinsics to perform the mixing.  These requirements are
-         * met inside elsewhere inside this class.
+         * @note the mixing itself is done by audio::kernels::mix, which picks the vector
+         * implementation for the running CPU.
          *
          * @param src_dst pointer to the source and destination buffer.
          * @param src2 pointer to the origin of the samples to mix in.
@@ -328,4 +500,4 @@ namespace afv_native { namespace afv {
     };
 }} // namespace afv_native::afv
 
-#endif // AFV_NATIVE_RADIOSIMULATION_H
+#endif // AFV_NATIVE_ATCRADIOSIMULATION_H
@@ -0,0 +1,58 @@
+#pragma once
+#include "afv-native/afv/dto/domain/RxTransceiver.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace afv_native { namespace afv {
+    /** FrequencyRouteIndex maps each frequency to the incoming streams that are being received on it.
+     *
+     * It's kept up to date as voice packets arrive so that the mixer only has to visit the streams
+     * routed to the radio it's rendering, rather than scanning every stream's transceiver list.
+     *
+     * Updates only reuse vector capacity once a frequency has been seen, so a steady stream of
+     * packets doesn't allocate.  The index is not thread-safe - StreamRegistry only ever updates its
+     * own copy, and hands the renderer immutable copies.
+     */
+    class FrequencyRouteIndex {
+      public:
+        /** StreamRoute is one stream heard on a frequency.
+         *
+         * ratio is the position of the first of the stream's transceivers on that frequency.  The
+         * distance ratios themselves change with nearly every packet, so StreamRegistry keeps them
+         * outside the index, where they can be updated without rebuilding it.
+         */
+        struct StreamRoute {
+            size_t slot;
+            size_t ratio;
+        };
+
+        /** update replaces the routes for the stream in slot.
+         *
+         * @param slot the stream's slot.
+         * @param previous the transceivers the stream was last routed with.
+         * @param current the transceivers from the newest packet.
+         */
+        void update(size_t slot, const std::vector<dto::RxTransceiver> &previous, const std::vector<dto::RxTransceiver> &current);
+
+        /** remove drops all routes for the stream in slot. */
+        void remove(size_t slot, const std::vector<dto::RxTransceiver> &transceivers);
+
+        /** find returns the streams heard on frequency, ordered by slot, or nullptr if there are none. */
+        const std::vector<StreamRoute> *find(uint32_t frequency) const;
+
+        /** compact forgets frequencies that no longer have any streams on them.
+         *
+         * This frees memory, so it should be called from periodic maintenance rather than per packet.
+         */
+        void compact();
+
+        void clear();
+
+      private:
+        std::unordered_map<uint32_t, std::vector<StreamRoute>> mRoutes;
+
+        void removeRoute(uint32_t frequency, size_t slot);
+    };
+}} // namespace afv_native::afv
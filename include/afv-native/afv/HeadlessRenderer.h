@@ -0,0 +1,112 @@
+#pragma once
+#include "afv-native/afv/ATCRadioSimulation.h"
+#include "afv-native/afv/RadioSimulation.h"
+#include "afv-native/afv/dto/voice_server/AudioRxOnTransceivers.h"
+#include "afv-native/audio/OutputDeviceState.h"
+#include "afv-native/audio/audio_params.h"
+#include "afv-native/event.h"
+#include "afv-native/util/ChainedCallback.h"
+#include "afv-native/util/monotime.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace afv_native { namespace afv {
+    /** HeadlessRenderer drives a radio simulation without any audio devices, on a virtual clock.
+     *
+     * Voice packets are scheduled against frame ticks.  run() delivers each tick's packets through
+     * rxVoicePacket and then renders the tick from the headset and speaker outputs through
+     * getAudioFrame, as fast as the simulation allows.  The output can be kept in memory and saved
+     * as a WAV file, and run() reports the frame rate along with the per-stage render timings.
+     *
+     * Each packet is delivered with the virtual time of its tick, which moves on
+     * audio::frameLengthMs per tick, so the output depends only on the packets scheduled and not
+     * on how quickly the host renders them.  The process-wide util::monotime_get() clock is left
+     * alone.
+     *
+     * The renderer takes the simulation's outputs over with setupDevices, so the simulation
+     * mustn't also be attached to a real audio device.  The renderer shares ownership of the
+     * simulation, so the simulation lives at least as long as the renderer - and so must the event
+     * base the simulation was made with.
+     */
+    class HeadlessRenderer {
+      public:
+        struct Stats {
+            uint64_t ticks   = 0;
+            uint64_t packets = 0;
+            double   wallSeconds = 0.0;
+            /** ticksPerSecond is the number of ticks rendered (on both outputs) per second of wall time. */
+            double ticksPerSecond = 0.0;
+            /** realtimeFactor is how many times faster than real time the ticks were rendered. */
+            double realtimeFactor = 0.0;
+            /** deliverNs is the time spent in rxVoicePacket, in nanoseconds. */
+            uint64_t deliverNs = 0;
+            /** headset and speaker are each output's render timings over this run. */
+            OutputDeviceState::RenderTimings headset;
+            OutputDeviceState::RenderTimings speaker;
+        };
+
+        explicit HeadlessRenderer(std::shared_ptr<ATCRadioSimulation> simulation);
+        explicit HeadlessRenderer(std::shared_ptr<RadioSimulation> simulation);
+        HeadlessRenderer(const HeadlessRenderer &) = delete;
+        HeadlessRenderer &operator=(const HeadlessRenderer &) = delete;
+
+        /** addPacket schedules pkt to be delivered at the start of tick. */
+        void addPacket(uint64_t tick, const dto::AudioRxOnTransceivers &pkt);
+
+        /** addTransmission schedules a transmission from callsign, heard through transceivers,
+         * with one of opusFrames delivered per tick from startTick on.  The last frame is flagged
+         * as the end of the transmission.
+         */
+        void addTransmission(uint64_t startTick, const std::string &callsign, const std::vector<dto::RxTransceiver> &transceivers, const std::vector<std::vector<unsigned char>> &opusFrames);
+
+        /** encodeTone returns frameCount Opus frames of a sine tone, for use with addTransmission. */
+        static std::vector<std::vector<unsigned char>> encodeTone(double frequencyHz, float amplitude, size_t frameCount);
+
+        /** setCapture selects whether run() keeps the rendered output in memory. */
+        void setCapture(bool capture);
+
+        /** getCapturedOutput returns everything captured from an output so far, as interleaved
+         * frames of getChannelCount(onHeadset) channels.
+         */
+        const std::vector<audio::SampleType> &getCapturedOutput(bool onHeadset) const;
+        int                                   getChannelCount(bool onHeadset) const;
+
+        /** saveWav writes the captured output to fileName.  Returns false if it couldn't. */
+        bool saveWav(bool onHeadset, const std::string &fileName) const;
+
+        /** run renders tickCount ticks, carrying on from wherever the last run stopped.
+         *
+         * Other than while capturing, run() allocates nothing itself, so any allocation during a
+         * run is the simulation's.
+         */
+        Stats run(uint64_t tickCount);
+
+        static void logStats(const Stats &stats);
+
+        /** Events carries the simulation's client events, as ATCClient's ClientEventCallback would. */
+        util::ChainedCallback<void(ClientEventType, void *, void *)> Events;
+
+      private:
+        std::function<void(const dto::AudioRxOnTransceivers &, util::monotime_t)> mDeliver;
+        std::function<void(audio::SampleType *, bool)>                            mRender;
+        std::function<OutputDeviceState::RenderTimings(bool)>                     mRenderTimings;
+        std::function<int(bool)>                                                  mChannelCount;
+
+        std::multimap<uint64_t, dto::AudioRxOnTransceivers> mSchedule;
+        uint64_t                                            mTick;
+
+        /** mFrame has room for a stereo frame, whichever output is rendering, so that run() itself
+         * doesn't allocate unless it's capturing.
+         */
+        std::vector<audio::SampleType> mFrame;
+
+        bool                           mCapture;
+        std::vector<audio::SampleType> mHeadsetOutput;
+        std::vector<audio::SampleType> mSpeakerOutput;
+    };
+}} // namespace afv_native::afv
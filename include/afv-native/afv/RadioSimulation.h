@@ -42,8 +42,13 @@
 #include "afv-native/afv/EffectResources.h"
 #include "afv-native/afv/RemoteVoiceSource.h"
 #include "afv-native/afv/RollingAverage.h"
+#include "afv-native/afv/StreamRegistry.h"
+#include "afv-native/afv/TransmitPipeline.h"
 #include "afv-native/afv/VoiceCompressionSink.h"
 #include "afv-native/afv/dto/voice_server/AudioRxOnTransceivers.h"
+#include "afv-native/afv/dto/voice_server/AudioRxOnTransceiversView.h"
+#include "afv-native/afv/dto/voice_server/AudioTxOnTransceivers.h"
+#include "afv-native/audio/EffectVoice.h"
 #include "afv-native/audio/ISampleSink.h"
 #include "afv-native/audio/ISampleSource.h"
 #include "afv-native/audio/SineToneSource.h"
@@ -53,6 +58,7 @@
 #include "afv-native/cryptodto/UDPChannel.h"
 #include "afv-native/event/EventCallbackTimer.h"
 #include "afv-native/util/ChainedCallback.h"
+#include "afv-native/util/SnapshotPointer.h"
 #include "afv-native/audio/OutputDeviceState.h"
 
 namespace afv_native {
@@ -69,38 +75,46 @@ namespace afv_native {
             bool onHeadset = false;
         };
 
-        /** RadioState is the internal state object for each radio within a RadioSimulation.
-         *
-         * It tracks the current playback position of the mixing effects, the channel frequency and gain.
+        /** RadioConfig is a radio's settings, as set through the simulation.  The renderer only ever
+         * sees them through a published RadioSimulation::RadioSnapshot.
          */
-        class RadioState {
-        public:
-            unsigned int Frequency;
+        struct RadioConfig {
+            unsigned int Frequency = 0;
             float Gain = 1.0;
-            std::shared_ptr<audio::RecordedSampleSource> Click;
-            std::shared_ptr<audio::RecordedSampleSource> Crackle;
-            std::shared_ptr<audio::RecordedSampleSource> AcBus;
-            std::shared_ptr<audio::RecordedSampleSource> VhfWhiteNoise;
-            std::shared_ptr<audio::RecordedSampleSource> HfWhiteNoise;
-            std::shared_ptr<audio::SineToneSource> BlockTone;
-            audio::SimpleCompressorEffect simpleCompressorEffect;
-            audio::VHFFilterSource vhfFilter;
-            int mLastRxCount;
-            bool mBypassEffects;
-            bool mHfSquelch;
-            bool mIsReceiving;
+            bool mBypassEffects = false;
+            bool mHfSquelch = false;
             bool onHeadset = true;
         };
 
-        /** CallsignMeta is the per-packetstream metadata stored within the RadioSimulation object.
+        /** RadioState is the renderer's working state for each radio within a RadioSimulation.
          *
-         * It's used to hold the RemoteVoiceSource object for that callsign+channel combination,
-         * and the list of transceivers that this packet stream relates to.
+         * It tracks the current playback position of the mixing effects.  The effects are set up
+         * once with the simulation, and only ever started and stopped after that, by the output
+         * holding mRendering (mLastRxCount may be read from anywhere).
          */
-        struct CallsignMeta {
-            std::shared_ptr<RemoteVoiceSource> source;
-            std::vector<dto::RxTransceiver> transceivers;
-            CallsignMeta();
+        class RadioState {
+        public:
+            RadioState();
+
+            audio::EffectVoice Click;
+            audio::EffectVoice Crackle;
+            audio::EffectVoice AcBus;
+            audio::EffectVoice VhfWhiteNoise;
+            audio::EffectVoice HfWhiteNoise;
+            audio::SineToneSource BlockTone;
+            audio::SimpleCompressorEffect simpleCompressorEffect;
+            audio::VHFFilterSource vhfFilter;
+            std::atomic<int> mLastRxCount;
+            /** mRenderedFrequency is the frequency the effects were last rendered for, so that they
+             * can be reset when the radio is retuned.
+             */
+            unsigned int mRenderedFrequency = 0;
+            bool mBlockTonePlaying = false;
+            bool mEffectsActive = false;
+            /** mRendering is held by the output rendering the radio, so that the two outputs can't
+             * both work on it while it's being moved between them.
+             */
+            std::atomic<bool> mRendering;
         };
 
         enum class RadioSimulationState
@@ -121,8 +135,7 @@ namespace afv_native {
          */
         class RadioSimulation:
                 public std::enable_shared_from_this<RadioSimulation>,
-                public audio::ISampleSink,
-                public ICompressedFrameSink {
+                public audio::ISampleSink {
         public:
             RadioSimulation(
                     struct event_base *evBase,
@@ -133,7 +146,12 @@ namespace afv_native {
 
             RadioSimulation(const RadioSimulation& copySrc) = delete;
 
-            void rxVoicePacket(const afv::dto::AudioRxOnTransceivers &pkt);
+            void rxVoicePacket(const afv::dto::AudioRxOnTransceiversView &pkt);
+            /** These overloads take the time the packet arrived at, for packets built up in memory
+             * rather than received, such as HeadlessRenderer's.
+             */
+            void rxVoicePacket(const afv::dto::AudioRxOnTransceiversView &pkt, util::monotime_t now);
+            void rxVoicePacket(const afv::dto::AudioRxOnTransceivers &pkt, util::monotime_t now);
 
             void setCallsign(const std::string &newCallsign);
             void setFrequency(unsigned int radio, unsigned int frequency);
@@ -163,6 +181,8 @@ namespace afv_native {
 
             void setOnHeadset(unsigned int radio, bool onHeadset);
             void setSplitAudioChannels(bool splitChannels);
+            /** getSplitAudioChannels returns true if both outputs render interleaved stereo. */
+            bool getSplitAudioChannels();
 
             void putAudioFrame(const audio::SampleType *bufferIn) override;
             audio::SourceStatus getAudioFrame(audio::SampleType *bufferOut, bool onHeadset);
@@ -176,6 +196,41 @@ namespace afv_native {
             std::shared_ptr<audio::ISampleSource> speakerDevice() { return mSpeakerDevice; }
             std::shared_ptr<audio::ISampleSource> headsetDevice() { return mHeadsetDevice; }
 
+            /** getRenderTimings returns how long the headset or speaker output has spent in each
+             * stage of getAudioFrame so far.
+             */
+            OutputDeviceState::RenderTimings getRenderTimings(bool onHeadset);
+
+            /** setJitterLatencyMode picks how the received streams' jitterbuffers trade delay
+             * against loss.  It applies to current and future streams alike.
+             */
+            void setJitterLatencyMode(JitterLatencyMode mode);
+
+            /** setEnableTransmitFec turns Opus in-band FEC on or off for the voice we send.  See
+             * VoiceCompressionSink::setInbandFec.
+             */
+            void setEnableTransmitFec(bool enable, int expectedLossPercent);
+
+            /** getStreamJitterStatistics fills statsOut with the playout counters for callsign's
+             * stream.
+             *
+             * @return false if nothing is being received from callsign.
+             */
+            bool getStreamJitterStatistics(const std::string &callsign, JitterStatistics &statsOut);
+
+            /** getFrequencyJitterStatistics sums the playout counters of the streams being received
+             * on frequency.
+             */
+            JitterStatistics getFrequencyJitterStatistics(unsigned int frequency);
+
+            /** setMaxReceiveStreams caps how many callsigns have a decoder at once, replacing the least
+             * recently active when a new one is heard.  0, the default, removes the cap.
+             */
+            void setMaxReceiveStreams(unsigned int maxStreams);
+
+            /** getStreamPoolStatistics returns the received stream and decoder pool counters. */
+            StreamPoolStatistics getStreamPoolStatistics();
+
         protected:
             /** maintenanceTimerIntervalMs is the internal in milliseconds between periodic cleanups
              * of the inbound audio frame objects.
@@ -195,18 +250,42 @@ namespace afv_native {
             cryptodto::UDPChannel *mChannel;
             std::string mCallsign;
 
-            std::mutex mStreamMapLock;
-            std::unordered_map<std::string, struct CallsignMeta> mHeadsetIncomingStreams;
-            std::unordered_map<std::string, struct CallsignMeta> mSpeakerIncomingStreams;
-
+            /** mIncomingStreams holds one decoder per callsign, shared by the headset and speaker
+             * outputs.  Decoded frames are cached per frame tick (see
+             * RemoteVoiceSource::getCachedAudioFrame) so each frame is only decoded once.
+             */
+            StreamRegistry mIncomingStreams;
+            /** mRenderStreams is the stream table for each output's render in progress, indexed by
+             * renderer number (see rendererFor).  Only valid during that output's getAudioFrame.
+             */
+            StreamRegistry::StreamTable *mRenderStreams[StreamRegistry::rendererCount] = {};
+            /** mLatestFrameTick is the newest frame tick rendered by either output. */
+            std::atomic<uint64_t> mLatestFrameTick{0};
+
+            /** RadioSnapshot is the renderer's view of the radio settings. */
+            struct RadioSnapshot {
+                std::vector<RadioConfig> radios;
+                bool splitChannels = false;
+            };
+
+            /** mRadioStateLock protects mRadioConfig and mSplitChannels, and serialises publishing
+             * them.  The renderer never takes it - it reads mRadioSnapshot instead.
+             */
             std::mutex mRadioStateLock;
             std::atomic<bool> mPtt;
+            /** mLastFramePtt is whether PTT was down for the previous captured frame.  Capture
+             * callback (and reset) only.
+             */
             bool mLastFramePtt;
-            unsigned int mTxRadio;
+            /** mTxRadio is the radio we transmit on.  It's atomic, as the transmit worker reads it
+             * for every frame it sends.
+             */
+            std::atomic<unsigned int> mTxRadio;
             std::atomic<uint32_t> mTxSequence;
-            std::vector<RadioState> mRadioState;
-
+            std::vector<RadioConfig> mRadioConfig;
             bool mSplitChannels = false;
+            util::SnapshotPointer<RadioSnapshot, StreamRegistry::rendererCount> mRadioSnapshot;
+            std::vector<RadioState> mRadioState;
 
             std::shared_ptr<OutputAudioDevice> mHeadsetDevice;
             std::shared_ptr<OutputAudioDevice> mSpeakerDevice;
@@ -224,40 +303,62 @@ namespace afv_native {
             event::EventCallbackTimer mMaintenanceTimer;
             RollingAverage<double> mVuMeter;
 
-            void resetRadioFx(unsigned int radio, bool except_click = false);
+            /** mTxEncoded and mTxDto are reused for every frame sent, so that sending doesn't
+             * allocate once they have grown to size.  Transmit worker only.
+             */
+            std::vector<unsigned char> mTxEncoded;
+            dto::AudioTxOnTransceivers mTxDto;
+
+            /** mTransmitPipeline is declared last, so its thread is stopped before anything it
+             * uses is destroyed.
+             */
+            TransmitPipeline mTransmitPipeline;
 
-            void set_radio_effects(size_t rxIter);
+            /** processCapturedFrame filters and meters one captured frame, then encodes and sends
+             * it if it's being transmitted.  Transmit worker only.
+             */
+            void processCapturedFrame(const TransmitPipeline::Frame &frame);
+
+            void resetRadioFx(RadioState &fx, bool except_click = false);
 
-            bool mix_effect(std::shared_ptr<audio::ISampleSource> effect, float gain, std::shared_ptr<OutputDeviceState> state);
+            void set_radio_effects(RadioState &fx);
 
-            void processCompressedFrame(std::vector<unsigned char> compressedData) override;
+            /** publishRadioState hands the renderer a new snapshot of mRadioConfig and
+             * mSplitChannels.  Must be called with mRadioStateLock held.
+             */
+            void publishRadioState();
 
-            static void dtoHandler(
-                    const std::string &dtoName, const unsigned char *bufIn, size_t bufLen, void *user_data);
-            void instDtoHandler(
-                    const std::string &dtoName, const unsigned char *bufIn, size_t bufLen);
+            void mix_effect(audio::EffectVoice &effect, float gain, const std::shared_ptr<OutputDeviceState> &state);
+            void mix_effect(audio::ISampleSource &effect, float gain, const std::shared_ptr<OutputDeviceState> &state);
+
+            /** processCompressedFrame sends one encoded frame on the transmitting radio.  Transmit
+             * worker only.
+             */
+            void processCompressedFrame(const std::vector<unsigned char> &compressedData, uint32_t sequence, bool lastPacket);
+
+            /** dtoHandler is the UDPChannel handler for received AudioRxOnTransceivers DTOs. */
+            static void dtoHandler(const unsigned char *bufIn, size_t bufLen, void *user_data);
+            void instDtoHandler(const unsigned char *bufIn, size_t bufLen);
 
             void maintainIncomingStreams();
         private:
             bool _process_radio(
-                    const std::map<void *, audio::SampleType[audio::frameSizeSamples]> &sampleCache,
+                    const RadioSnapshot &radios,
                     size_t rxIter,
                     bool onHeadset);
 
-            inline void interleave(audio::SampleType* leftChannel, audio::SampleType* rightChannel, audio::SampleType* outputBuffer, size_t numSamples) {
-                for (size_t i = 0; i < numSamples; i++) {
-                    outputBuffer[2 * i] = leftChannel[i]; // Interleave left channel data
-                    outputBuffer[2 * i + 1] = rightChannel[i]; // Interleave right channel data
-                }
-            }
+            /** gatherStreamFrames pulls every stream's frame for frameTick into renderer's frames
+             * in mRenderStreams[renderer].  Only from that output's getAudioFrame.
+             */
+            void gatherStreamFrames(uint64_t frameTick, size_t renderer);
+
 
             /** mix_buffers is a utility function that mixes two buffers of audio together.  The src_dst
              * buffer is assumed to be the final output buffer and is modified by the mixing in place.
              * src2 is read-only and will be scaled by the provided linear gain.
              *
-             * @note as this mixer has some really fundamental assumptions about buffer alignment which
-             * are required as it uses SSE2 intrinsics to perform the mixing.  These requirements are
-             * met inside elsewhere inside this class.
+             * @note the mixing itself is done by audio::kernels::mix, which picks the vector
+             * implementation for the running CPU.
              *
              * @param src_dst pointer to the source and destination buffer.
              * @param src2 pointer to the origin of the samples to mix in.
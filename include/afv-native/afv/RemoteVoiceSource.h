@@ -34,12 +34,16 @@
 #ifndef AFV_NATIVE_REMOTEVOICESOURCE_H
 #define AFV_NATIVE_REMOTEVOICESOURCE_H
 
-#include "afv-native/afv/dto/interfaces/IAudio.h"
+#include "afv-native/afv/dto/voice_server/AudioRxOnTransceiversView.h"
 #include "afv-native/audio/ISampleSource.h"
 #include "afv-native/audio/SourceStatus.h"
 #include "afv-native/audio/audio_params.h"
+#include "afv-native/jitterStatistics.h"
+#include "afv-native/util/PacketSlab.h"
+#include "afv-native/util/SpscQueue.h"
 #include "afv-native/util/monotime.h"
-#include <mutex>
+#include <atomic>
+#include <cstddef>
 #include <opus/opus.h>
 #include <speex/speex_jitter.h>
 
@@ -50,6 +54,36 @@ namespace afv_native { namespace afv {
      */
     const int frameTimeOut = 10;
 
+    /** decodedFrameCacheDepth is the number of decoded frames each RemoteVoiceSource keeps.
+     *
+     * The headset and speaker outputs are driven by independent device clocks, so one will
+     * usually trail the other by a frame or two.  Keeping a short history lets the trailing
+     * output reuse the frame the leading output already decoded instead of running a second
+     * jitterbuffer and decoder for the same stream.
+     */
+    const int decodedFrameCacheDepth = 4;
+
+    /** cachedFrameReaders is how many outputs may read a RemoteVoiceSource's decoded frames at once.
+     * Each one keeps at most one cached frame pinned, so decodedFrameCacheDepth must leave room for
+     * a frame to be decoded besides those.
+     */
+    const size_t cachedFrameReaders = 2;
+    static_assert(decodedFrameCacheDepth > static_cast<int>(cachedFrameReaders), "the decoded frame cache has no room to decode into");
+
+    /** packetQueueDepth is the number of received packets that can be waiting for the renderer to
+     * move them into the jitterbuffer.  The renderer drains the queue every frame, so this only
+     * needs to cover a burst of packets arriving at once.
+     */
+    const size_t packetQueueDepth = 64;
+
+    /** fecCacheDepth is the number of recently received packets each RemoteVoiceSource keeps a copy
+     * of, so that a lost frame can be rebuilt from the in-band FEC data in the packet after it.
+     */
+    const int fecCacheDepth = 8;
+
+    /** fecCachePacketBytes is the largest packet kept for FEC - the most Opus puts in one frame. */
+    const size_t fecCachePacketBytes = 1275;
+
     /** RemoveVoiceSource takes a stream of IAudio DTOs and stores them in an appropriately tuned jitterbuffer.
      *
      * These can then be demand polled by a consumer which will pull the packets from the jitterBuffer and run them
@@ -57,15 +91,56 @@ namespace afv_native { namespace afv {
      *
      * @note this is analogous to the GeoVR CallsignSampleProvider, but without the effects pass which is handled
      * elsewhere.
+     *
+     * Packets are handed over from the network thread through a wait-free queue.  The jitterbuffer
+     * and decoder are only ever touched by the renderer holding the decoder (see
+     * getCachedAudioFrame), which moves queued packets into the jitterbuffer before each frame it
+     * decodes, so the network thread never waits for a renderer or the other way around.
      */
     class RemoteVoiceSource: public audio::ISampleSource {
       protected:
+        /** QueuedPacket is a received packet on its way from the network thread to the renderer. */
+        struct QueuedPacket {
+            char    *data       = nullptr;
+            size_t   len        = 0;
+            uint32_t sequence   = 0;
+            bool     lastPacket = false;
+            /** flushFirst asks the renderer to flush the stream before this packet, as it's the
+             * first after a gap.
+             */
+            bool flushFirst = false;
+        };
+
         JitterBuffer *mJitterBuffer;
         OpusDecoder  *mDecoder;
 
-        std::mutex       mJitterBufferMutex;
-        bool             mIsActive;
-        util::monotime_t mLastActive;
+        util::SpscQueue<QueuedPacket, packetQueueDepth> mPacketQueue;
+
+        /** mPacketSlab holds the payloads of queued and jitterbuffered packets.  The network thread
+         * allocates from it, and the renderer - directly, or through the jitterbuffer's destroy
+         * callback - releases back to it.
+         */
+        util::PacketSlab mPacketSlab;
+
+        /** CachedPacket is a copy of a packet handed to the jitterbuffer, kept for its FEC data. */
+        struct CachedPacket {
+            bool          valid    = false;
+            uint32_t      sequence = 0;
+            size_t        len      = 0;
+            unsigned char data[fecCachePacketBytes];
+        };
+
+        /** mFecCache holds the latest packets by sequence.  Renderer side only. */
+        CachedPacket mFecCache[fecCacheDepth];
+
+        std::atomic<bool>             mIsActive;
+        std::atomic<util::monotime_t> mLastActive;
+
+        /** mLatencyMode is the mode asked for, and mAppliedLatencyMode the one the jitterbuffer is
+         * tuned for.  The renderer applies any change at the start of its next frame.
+         */
+        std::atomic<JitterLatencyMode> mLatencyMode;
+        JitterLatencyMode              mAppliedLatencyMode;
 
       protected:
         int mSilentFrames;
@@ -74,20 +149,143 @@ namespace afv_native { namespace afv {
         bool mEnding;
         int  mEndingSequence;
 
+        /** mDecodedFrames holds the latest decoded frames, each for the tick in the matching
+         * mDecodedFrameTicks entry, or 0 while that entry is empty or being decoded into.
+         */
+        audio::SampleType     mDecodedFrames[decodedFrameCacheDepth][audio::frameSizeSamples];
+        std::atomic<uint64_t> mDecodedFrameTicks[decodedFrameCacheDepth];
+        /** mLastDecodedTick is the newest tick any renderer has started decoding. */
+        std::atomic<uint64_t> mLastDecodedTick;
+        /** mDecoding is held by the renderer using the jitterbuffer and decoder. */
+        std::atomic<bool> mDecoding;
+        /** mPinnedFrames is the mDecodedFrames entry each reader is using, which the decoding
+         * renderer must not reuse.  -1 if none.
+         */
+        std::atomic<int> mPinnedFrames[cachedFrameReaders];
+
+        /** mPlaying is set once the jitterbuffer has played a packet since it was last flushed, and
+         * so has a playout position that later packets can be late for.
+         */
+        bool mPlaying;
+        /** mHighestSequence is the newest sequence queued since the last flush, if mHaveSequence. */
+        bool     mHaveSequence;
+        uint32_t mHighestSequence;
+        /** mMissingSequences is how many of PacketsLost were counted since the last flush, and
+         * so can still be filled in by an out of order packet.
+         */
+        uint32_t mMissingSequences;
+
+        /** maxCountedGap is the longest run of missing sequences counted as lost.  Anything
+         * longer is the sender starting over rather than packets going astray.
+         */
+        static const int32_t maxCountedGap = 50;
+
+        /** drainPacketQueue moves everything waiting in mPacketQueue into the jitterbuffer.
+         * Decoding renderer only.
+         */
+        void drainPacketQueue();
+
+        /** countPacket updates the late and lost counters for a packet about to be queued.
+         * Decoding renderer only.
+         */
+        void countPacket(uint32_t sequence);
+
+        /** isTooLateToBuffer returns true if the jitterbuffer would throw a packet with this
+         * sequence away, as its turn to play has long passed.  Speex doesn't pass those to the
+         * destroy callback, so their payloads have to be released by hand.  Decoding renderer only.
+         */
+        bool isTooLateToBuffer(uint32_t sequence);
+
+        /** cachePacket keeps a copy of packet in mFecCache.  Decoding renderer only. */
+        void cachePacket(const QueuedPacket &packet);
+
+        /** findCachedPacket returns the cached packet for sequence, or nullptr.  Decoding
+         * renderer only.
+         */
+        const CachedPacket *findCachedPacket(uint32_t sequence) const;
+
+        /** pinCachedFrame returns the cached frame for tick, pinned for reader, or nullptr if it
+         * isn't cached.
+         */
+        const audio::SampleType *pinCachedFrame(uint64_t tick, size_t reader);
+
+        /** decodeCachedFrame decodes the next frame into a free cache entry for tick, and pins it
+         * for reader.  Decoding renderer only.
+         */
+        const audio::SampleType *decodeCachedFrame(uint64_t tick, size_t reader);
+
+        /** applyLatencyMode tunes the jitterbuffer for mode.  Decoding renderer only. */
+        void applyLatencyMode(JitterLatencyMode mode);
+
       public:
         RemoteVoiceSource();
         virtual ~RemoteVoiceSource();
         RemoteVoiceSource(const RemoteVoiceSource &copySrc) = delete;
 
-        void                appendAudioDTO(const dto::IAudio &audio);
+        /** appendAudioDTO queues a packet received at now for the renderer, copying its audio out.
+         * This never blocks, but must only be called from one thread at a time.
+         */
+        void                appendAudioDTO(const dto::AudioRxOnTransceiversView &audio, util::monotime_t now);
         audio::SourceStatus getAudioFrame(audio::SampleType *bufferOut) override;
 
+        /** PacketQueueOverflows is a monotonic counter of packets dropped because the renderer
+         * hadn't drained the queue in time.
+         */
+        std::atomic<uint32_t> PacketQueueOverflows;
+
+        /** The playout counters below are described in JitterStatistics.  They're written by the
+         * renderer (PacketsReceived by the network thread) and may be read from anywhere.
+         */
+        std::atomic<uint32_t> PacketsReceived;
+        std::atomic<uint32_t> PacketsLate;
+        std::atomic<uint32_t> PacketsLost;
+        std::atomic<uint32_t> FramesRecovered;
+        std::atomic<uint32_t> FramesConcealed;
+        std::atomic<uint32_t> FramesInserted;
+        std::atomic<uint32_t> FramesSkipped;
+        /** BufferedFrames is how many frames the jitterbuffer held after the last frame played. */
+        std::atomic<uint32_t> BufferedFrames;
+
+        /** getJitterStatistics returns a snapshot of this stream's playout counters. */
+        JitterStatistics getJitterStatistics() const;
+
+        /** setLatencyMode retunes the jitterbuffer, from the renderer's next frame on.  This never
+         * blocks, and may be called from any thread.
+         */
+        void setLatencyMode(JitterLatencyMode mode);
+
+        /** getCachedAudioFrame returns the decoded frame for the nominated output frame tick.
+         *
+         * The first caller to ask for a tick newer than anything already decoded claims the
+         * decoder with an atomic flag, and pulls and decodes the next frame from the jitterbuffer.
+         * Any other output asking for the same tick gets the cached copy, so each frame is only
+         * decoded once.  No locks are taken, and nobody waits - an output that finds another one
+         * busy decoding plays the stream's previous frame again if it's still cached, or goes
+         * without the stream for the frame, and counts it in FramesSkipped.
+         *
+         * The frame returned stays pinned for reader - and so isn't reused for a later tick -
+         * until reader's next call.
+         *
+         * @param tick the frame tick being rendered (see OutputDeviceState::advanceFrameTick).
+         * @param reader the calling output's number, below cachedFrameReaders.
+         * @return a pointer to frameSizeSamples decoded samples (the previous tick's, if the
+         *      decoder was busy), or nullptr if the stream had no audio for that tick (or the tick
+         *      has already fallen out of the cache).
+         */
+        const audio::SampleType *getCachedAudioFrame(uint64_t tick, size_t reader);
+
         util::monotime_t getLastActivityTime() const;
 
         /** flush resets the stream, preserving any jitter adjustments, but otherwise clearing the
-         * codec state and jitter buffered packets.
+         * codec state and jitter buffered packets.  Renderer side only.
          */
         void flush();
+
+        /** recycle returns the stream to the state of a newly created one, keeping its decoder,
+         * jitterbuffer and packet storage for the next callsign.  Neither the network thread nor
+         * the renderer may be using the stream meanwhile.
+         */
+        void recycle();
         bool isActive() const;
     };
 }} // namespace afv_native::afv
@@ -0,0 +1,192 @@
+#pragma once
+#include "afv-native/afv/FrequencyRouteIndex.h"
+#include "afv-native/afv/RemoteVoiceSource.h"
+#include "afv-native/afv/dto/voice_server/AudioRxOnTransceiversView.h"
+#include "afv-native/audio/audio_params.h"
+#include "afv-native/jitterStatistics.h"
+#include "afv-native/util/SnapshotPointer.h"
+#include "afv-native/util/monotime.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace afv_native { namespace afv {
+    /** StreamRegistry owns the incoming voice streams and hands them to the renderer without the
+     * renderer ever taking a lock.
+     *
+     * Writers (the network thread delivering packets, and the maintenance timer purging idle
+     * streams) serialise among themselves on an internal mutex.  Whenever the set of streams or
+     * their frequencies change, they publish a new immutable StreamTable through an atomic
+     * pointer.  A stream's distance ratios change with almost every packet, so they're stored
+     * straight into atomics shared by every table instead.  Each renderer picks the current table up in beginRender and lets it go again in
+     * endRender.
+     *
+     * Superseded tables are reclaimed by the writers through a util::SnapshotPointer, so a table -
+     * and the decoders it refers to - is never freed out from under a renderer, and the renderers
+     * never free anything themselves.
+     *
+     * Purged streams hand their decoder and jitterbuffer to a small idle pool, and the next new
+     * stream recycles one from there rather than creating its own - but only once no table still
+     * refers to it, so the renderer never sees a source change callsign under it.  An optional cap
+     * on the number of streams makes room for a new stream by dropping the least recently active.
+     *
+     * Up to rendererCount outputs may render at once, each under its own renderer number.  They
+     * share the decoders through RemoteVoiceSource::getCachedAudioFrame.
+     */
+    class StreamRegistry {
+      public:
+        /** idleSourceDepth is the most decoders kept for reuse.  Any more are freed. */
+        static const size_t idleSourceDepth = 16;
+
+        /** rendererCount is how many outputs may render at once - the headset and the speaker. */
+        static const size_t rendererCount = 2;
+
+        /** DistanceRatios holds a stream's DistanceRatio for each frequency it's heard on, at each
+         * route's FrequencyRouteIndex::StreamRoute::ratio.
+         */
+        typedef std::vector<std::atomic<float>> DistanceRatios;
+
+        /** StreamTable is a snapshot of the streams, as seen by the renderer.
+         *
+         * Everything except frames is immutable once published.
+         */
+        struct StreamTable {
+            /** sources holds each stream's decoder, indexed by slot.  Free slots are empty. */
+            std::vector<std::shared_ptr<RemoteVoiceSource>> sources;
+            /** routes maps each frequency to the slots being heard on it. */
+            FrequencyRouteIndex routes;
+            /** distanceRatios holds each stream's distance ratios, indexed by slot.  They're
+             * updated in place as packets arrive.
+             */
+            std::vector<std::shared_ptr<const DistanceRatios>> distanceRatios;
+            /** frames is scratch space for each renderer, with one entry per slot, for the frame
+             * each stream decoded for the tick that renderer is rendering.
+             */
+            std::vector<const audio::SampleType *> frames[rendererCount];
+
+            /** distanceRatio returns the best DistanceRatio the stream on route has on its frequency. */
+            float distanceRatio(const FrequencyRouteIndex::StreamRoute &route) const {
+                return (*distanceRatios[route.slot])[route.ratio].load(std::memory_order_relaxed);
+            }
+        };
+
+        StreamRegistry();
+        StreamRegistry(const StreamRegistry &) = delete;
+        StreamRegistry &operator=(const StreamRegistry &) = delete;
+
+        /** rxVoicePacket queues pkt, received at now, on its stream, creating the stream if it's new. */
+        void rxVoicePacket(const dto::AudioRxOnTransceiversView &pkt, util::monotime_t now);
+
+        /** setMaxStreams caps the number of streams with a decoder at once.  A new stream over the
+         * cap replaces the least recently active one, and any streams already over it are dropped
+         * straight away.  0 removes the cap.
+         */
+        void setMaxStreams(size_t maxStreams);
+
+        /** purgeInactive drops every stream that hasn't received a packet for more than timeoutMs,
+         * and frees any superseded tables the renderer has finished with.
+         */
+        void purgeInactive(util::monotime_t now, util::monotime_t timeoutMs);
+
+        /** clear drops all streams. */
+        void clear();
+
+        /** beginRender returns the current table for renderer, which must be below rendererCount.
+         * The table stays valid until the same renderer calls endRender.  Renderer side only.
+         */
+        StreamTable *beginRender(size_t renderer);
+        void         endRender(size_t renderer);
+
+        /** getPacketQueueOverflows returns the number of packets dropped because a stream's packet
+         * queue was full, including those from streams that have since been purged.
+         */
+        uint32_t getPacketQueueOverflows();
+
+        /** setLatencyMode retunes every stream's jitterbuffer, and those of streams created later. */
+        void setLatencyMode(JitterLatencyMode mode);
+
+        /** getStreamStatistics fills statsOut with callsign's playout counters.
+         *
+         * @return false if there's no stream for callsign.
+         */
+        bool getStreamStatistics(const std::string &callsign, JitterStatistics &statsOut);
+
+        /** getFrequencyStatistics sums the playout counters of every stream currently being heard
+         * on frequency.  Streams that have been purged no longer count.
+         */
+        JitterStatistics getFrequencyStatistics(unsigned int frequency);
+
+        /** getPoolStatistics returns the stream count and decoder pool counters. */
+        StreamPoolStatistics getPoolStatistics();
+
+        /** getTablesPublished returns the number of tables published to the renderer so far. */
+        uint32_t getTablesPublished() const;
+
+        /** getTablesReclaimed returns the number of superseded tables freed so far. */
+        uint32_t getTablesReclaimed() const;
+
+      private:
+        struct StreamMeta {
+            std::shared_ptr<RemoteVoiceSource> source;
+            std::vector<dto::RxTransceiver>    transceivers;
+            std::shared_ptr<DistanceRatios>    distanceRatios;
+            size_t                             slot = 0;
+        };
+
+        /** StreamMap compares transparently, so that a packet's callsign can be looked up as it
+         * is, without building a std::string for it.
+         */
+        typedef std::map<std::string, StreamMeta, std::less<>> StreamMap;
+
+        std::mutex                                         mWriterLock;
+        StreamMap                                          mStreams;
+        std::vector<std::shared_ptr<RemoteVoiceSource>>    mSources;
+        std::vector<std::shared_ptr<const DistanceRatios>> mDistanceRatios;
+        std::vector<size_t>                                mFreeSlots;
+        FrequencyRouteIndex                                mRoutes;
+        uint32_t                                           mPurgedPacketQueueOverflows;
+        JitterLatencyMode                                  mLatencyMode;
+
+        /** mIdleSources holds the sources of removed streams until they're reused.  Some may still
+         * be in tables the renderer hasn't let go of yet.
+         */
+        std::vector<std::shared_ptr<RemoteVoiceSource>> mIdleSources;
+        size_t                                          mMaxStreams;
+        uint32_t                                        mPoolHits;
+        uint32_t                                        mPoolMisses;
+        uint32_t                                        mEvictions;
+
+        util::SnapshotPointer<StreamTable, rendererCount> mTable;
+
+        /** publish swaps in a new table built from the current streams.  Must be called with
+         * mWriterLock held.
+         */
+        void publish();
+
+        /** acquireSource returns a source for a new stream, recycled from mIdleSources if one is
+         * free.  Must be called with mWriterLock held.
+         */
+        std::shared_ptr<RemoteVoiceSource> acquireSource();
+
+        /** removeStream drops the stream at streamIter, keeping its source for reuse if there's
+         * room.  The caller must compact mRoutes and publish afterwards.  Must be called with
+         * mWriterLock held.
+         *
+         * @return the iterator following streamIter.
+         */
+        StreamMap::iterator removeStream(StreamMap::iterator streamIter);
+
+        /** evictLeastRecentlyActive removes the stream that has gone longest without a packet,
+         * other than keep.  Must be called with mWriterLock held.
+         *
+         * @return false if there was nothing to evict.
+         */
+        bool evictLeastRecentlyActive(StreamMap::const_iterator keep);
+    };
+}} // namespace afv_native::afv
@@ -0,0 +1,109 @@
+#pragma once
+#include "afv-native/audio/audio_params.h"
+#include "afv-native/util/Semaphore.h"
+#include "afv-native/util/SpscQueue.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace afv_native { namespace afv {
+    /** TransmitPipeline hands microphone frames from the capture callback to a worker thread, so
+     * that nothing but a copy of the samples happens on the audio device's thread.
+     *
+     * The capture callback pushes every frame it captures into a lock-free queue, which never
+     * blocks or allocates.  The worker pops frames in order and passes them to the handler, which
+     * preprocesses, encodes and sends them, reporting how long each stage took through
+     * addStageTime.  If the worker falls so far behind that the queue fills, new frames are
+     * dropped and counted rather than waited for.
+     */
+    class TransmitPipeline {
+      public:
+        /** queueCapacity is how many frames may wait for the worker - 1.28s of audio. */
+        static const size_t queueCapacity = 64;
+
+        struct Frame {
+            audio::SampleType samples[audio::frameSizeSamples];
+            uint32_t          sequence = 0;
+            /** transmit is false for frames that are only being metered, not sent. */
+            bool transmit   = false;
+            bool lastPacket = false;
+            /** queuedAt is when the capture callback pushed the frame. */
+            std::chrono::steady_clock::time_point queuedAt;
+        };
+
+        typedef std::function<void(const Frame &)> FrameHandler;
+
+        /** Stage names the steps the handler takes a frame through. */
+        enum class Stage {
+            /** Preprocess is filtering, gain and metering, done for every frame. */
+            Preprocess = 0,
+            /** Encode is the Opus encoder, for transmitted frames only. */
+            Encode,
+            /** Send is packing, encrypting and sending, for transmitted frames only. */
+            Send,
+            Count
+        };
+        static const size_t stageCount = static_cast<size_t>(Stage::Count);
+
+        /** The worker starts straight away, and calls handler for each frame pushed. */
+        explicit TransmitPipeline(FrameHandler handler);
+        ~TransmitPipeline();
+        TransmitPipeline(const TransmitPipeline &) = delete;
+        TransmitPipeline &operator=(const TransmitPipeline &) = delete;
+
+        /** push queues a frame for the worker.  Only one thread - the capture callback - may push.
+         *
+         * @return false if the queue was full and the frame was dropped.
+         */
+        bool push(const audio::SampleType *samples, uint32_t sequence, bool transmit, bool lastPacket);
+
+        /** clear drops every queued frame, waiting for the frame being handled, if any, to finish. */
+        void clear();
+
+        /** addStageTime records that one frame spent elapsed in stage.  Handler only. */
+        void addStageTime(Stage stage, std::chrono::steady_clock::duration elapsed);
+
+        /** logStatistics dumps the queue, latency and stage counters to the AFV log. */
+        void logStatistics();
+
+        /** FramesQueued counts the frames pushed successfully. */
+        std::atomic<uint32_t> FramesQueued;
+        /** FramesDropped counts the frames pushed while the queue was full. */
+        std::atomic<uint32_t> FramesDropped;
+        /** MaxQueueDepth is the most frames seen waiting at once, including the one pushed. */
+        std::atomic<uint32_t> MaxQueueDepth;
+        /** FramesHandled counts the frames the handler has finished with. */
+        std::atomic<uint32_t> FramesHandled;
+        /** FrameLatencyNs and MaxFrameLatencyNs measure from push to the handler returning. */
+        std::atomic<uint64_t> FrameLatencyNs;
+        std::atomic<uint64_t> MaxFrameLatencyNs;
+        /** StageFrames, StageNs and MaxStageNs are the addStageTime totals, indexed by Stage. */
+        std::atomic<uint32_t> StageFrames[stageCount];
+        std::atomic<uint64_t> StageNs[stageCount];
+        std::atomic<uint64_t> MaxStageNs[stageCount];
+
+      private:
+        FrameHandler                          mHandler;
+        util::SpscQueue<Frame, queueCapacity> mQueue;
+        /** mWake is posted once for every frame pushed, and for every clear or stop request. */
+        util::Semaphore   mWake;
+        std::atomic<bool> mStop;
+
+        /** mClearRequested counts the clears asked for, and mClearsDone the ones the worker has
+         * carried out, so clear can wait for its own.  mClearsDone is guarded by mLock.
+         */
+        std::atomic<uint32_t>   mClearRequested;
+        uint32_t                mClearsDone;
+        std::mutex              mLock;
+        std::condition_variable mClearDone;
+
+        std::thread mThread;
+
+        void run();
+    };
+}} // namespace afv_native::afv
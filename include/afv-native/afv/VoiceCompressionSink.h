@@ -35,6 +35,7 @@
 #define AFV_NATIVE_VOICECOMPRESSIONSINK_H
 
 #include "afv-native/audio/ISampleSink.h"
+#include <atomic>
 #include <opus/opus.h>
 #include <vector>
 
@@ -50,14 +51,51 @@ namespace afv_native { namespace afv {
     class VoiceCompressionSink: public audio::ISampleSink {
       protected:
         OpusEncoder          *mEncoder;
-        ICompressedFrameSink &mCompressedFrameSink;
+        ICompressedFrameSink *mCompressedFrameSink;
+
+        /** mFecLossPercent is the expected loss in-band FEC was asked for, or fecDisabled.
+         * mAppliedFecLossPercent is what the encoder is set to - encode applies any change, so
+         * the encoder is only ever touched by the thread encoding.
+         */
+        std::atomic<int> mFecLossPercent;
+        int              mAppliedFecLossPercent;
+
+        static const int fecDisabled = -1;
+
+        void applyFec(int lossPercent);
 
       public:
         VoiceCompressionSink(ICompressedFrameSink &sink);
+        /** This makes a sink for callers that only use encode, and so have nowhere for
+         * putAudioFrame to pass frames on to.
+         */
+        VoiceCompressionSink();
         virtual ~VoiceCompressionSink();
         int  open();
         void close();
         void reset();
+
+        /** setInbandFec turns Opus in-band forward error correction on or off.
+         *
+         * With FEC on, each packet also carries a low bitrate copy of the frame before it, which
+         * the receiver can use in place of a lost packet.  The copy is paid for out of the
+         * existing bitrate rather than on top of it.  The encoder picks up the change before the
+         * next frame it encodes, so this may be called from any thread.
+         *
+         * @param expectedLossPercent the packet loss to tune for.  Opus only spends bits on FEC
+         *      when this is above zero.
+         */
+        void setInbandFec(bool enable, int expectedLossPercent);
+
+        /** encode compresses one frame into encodedOut, without passing it on.
+         *
+         * @return false if the frame couldn't be encoded.
+         */
+        bool encode(const audio::SampleType *bufferIn, std::vector<unsigned char> &encodedOut);
+
+        /** putAudioFrame encodes the frame and passes it on to the compressed frame sink, if
+         * there is one.
+         */
         void putAudioFrame(const audio::SampleType *bufferIn) override;
     };
 }} // namespace afv_native::afv
@@ -0,0 +1,50 @@
+#pragma once
+#include "afv-native/afv/dto/domain/RxTransceiver.h"
+#include "afv-native/afv/dto/voice_server/AudioRxOnTransceivers.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace afv_native { namespace afv { namespace dto {
+    /** AudioRxOnTransceiversView is an AudioRxOnTransceivers decoded in place.
+     *
+     * decode() reads the packet without allocating or throwing.  Callsign and Audio point into
+     * the buffer it was decoded from, so the view is only valid for as long as that is.  The
+     * transceivers are copied into a fixed array, and a packet with more than maxTransceivers of
+     * them is rejected.
+     */
+    class AudioRxOnTransceiversView {
+      public:
+        static constexpr size_t maxTransceivers = 128;
+
+        std::string_view     Callsign;
+        uint32_t             SequenceCounter = 0;
+        const unsigned char *Audio           = nullptr;
+        size_t               AudioLength     = 0;
+        bool                 LastPacket      = false;
+        RxTransceiver        Transceivers[maxTransceivers];
+        size_t               TransceiverCount = 0;
+
+        AudioRxOnTransceiversView() = default;
+
+        /** This views pkt, which must outlive it. */
+        explicit AudioRxOnTransceiversView(const AudioRxOnTransceivers &pkt);
+
+        /** decode reads a msgpack encoded AudioRxOnTransceivers out of buf.
+         *
+         * As with msgpack-c, fields missing from the end of a short array are left at their
+         * defaults, and extra fields are skipped.
+         *
+         * @return false if buf doesn't hold a well formed packet, in which case the view is left
+         *          partly filled in.
+         */
+        bool decode(const unsigned char *buf, size_t len);
+
+        const RxTransceiver *transceiversBegin() const {
+            return Transceivers;
+        }
+        const RxTransceiver *transceiversEnd() const {
+            return Transceivers + TransceiverCount;
+        }
+    };
+}}} // namespace afv_native::afv::dto
@@ -41,8 +41,19 @@ namespace afv_native {
          * (It's used for some tear-down operations which must run to completion
          * after the client is shut-down if possible.)
          *
+         * Received voice packets are read off the socket by this loop too, so
+         * it must be left blocked waiting for events (event_base_dispatch) the
+         * whole time, not polled with EVLOOP_NONBLOCK between sleeps - any
+         * sleep holds received audio back, and it then arrives in bursts.  A
+         * host whose own loop can't do that should give the client an
+         * event_base of its own, dispatched on a thread of its own, as
+         * api::atcClient does.
+         *
          * @param evBase an initialised libevent event_base to register the
-         * client's asynchronous IO and deferred operations against.
+         * client's asynchronous IO and deferred operations against.  The audio
+         * callbacks wake it to report receive events, so it must have been
+         * made after evthread_use_pthreads() (or evthread_use_windows_threads())
+         * was called.
          * @param resourceBasePath A relative or absolute path to where the
          * AFV-native resource files are located.
          * @param baseUrl The baseurl for the AFV API server to connect to.  The
@@ -208,6 +219,41 @@ namespace afv_native {
          */
         void logAudioStatistics();
 
+        /** setJitterLatencyMode picks how received voice is buffered: MinimumLatency for the
+         * shortest mouth-to-ear delay, Robust to ride out a poor link, or Balanced in between.
+         */
+        void setJitterLatencyMode(JitterLatencyMode mode);
+
+        /** setEnableTransmitFec turns Opus in-band forward error correction on or off for the voice
+         * we send, so that receivers can rebuild lost packets without raising the bitrate.
+         *
+         * @param expectedLossPercent the packet loss to tune for - FEC only kicks in above zero.
+         */
+        void setEnableTransmitFec(bool enable, int expectedLossPercent);
+
+        /** getStreamJitterStatistics fills statsOut with the playout counters for the voice being
+         * received from callsign.
+         *
+         * @return false if nothing is being received from callsign.
+         */
+        bool getStreamJitterStatistics(const std::string &callsign, JitterStatistics &statsOut);
+
+        /** getFrequencyJitterStatistics sums the playout counters of every stream being received
+         * on freq.
+         */
+        JitterStatistics getFrequencyJitterStatistics(unsigned int freq);
+
+        /** setMaxReceiveStreams caps how many callsigns have a decoder at once, to bound memory in
+         * busy airspace.  A new callsign over the cap replaces the one heard least recently.  0,
+         * the default, removes the cap.
+         */
+        void setMaxReceiveStreams(unsigned int maxStreams);
+
+        /** getStreamPoolStatistics returns how many callsigns are being decoded, and how often
+         * decoders have been reused or evicted.
+         */
+        StreamPoolStatistics getStreamPoolStatistics();
+
         std::shared_ptr<const audio::AudioDevice> getAudioDevice() const;
 
         /** getRxActive returns if the nominated radio is currently Receiving
@@ -244,7 +290,7 @@ namespace afv_native {
         void setManualTransceivers(unsigned int freq, std::vector<afv::dto::StationTransceiver> transceivers);
         void linkTransceivers(std::string callsign, unsigned int freq);
 
-        std::map<unsigned int, afv::AtcRadioState> getRadioState();
+        std::shared_ptr<const afv::AtcRadioStateMap> getRadioState();
 
         void reset();
 
@@ -70,6 +70,12 @@ extern "C" {
     AFV_NATIVE_API void ATCClient_SetEnableInputFilters(ATCClientHandle handle, bool enableInputFilters);
     AFV_NATIVE_API void ATCClient_SetEnableOutputEffects(ATCClientHandle handle, bool enableEffects);
     AFV_NATIVE_API bool ATCClient_GetEnableInputFilters(ATCClientHandle handle);
+    AFV_NATIVE_API void ATCClient_SetJitterLatencyMode(ATCClientHandle handle, afv_native::JitterLatencyMode mode);
+    AFV_NATIVE_API void ATCClient_SetEnableTransmitFec(ATCClientHandle handle, bool enable, int expectedLossPercent);
+    AFV_NATIVE_API bool ATCClient_GetStreamJitterStatistics(ATCClientHandle handle, char *callsign, afv_native::JitterStatistics *statsOut);
+    AFV_NATIVE_API void ATCClient_GetFrequencyJitterStatistics(ATCClientHandle handle, unsigned int freq, afv_native::JitterStatistics *statsOut);
+    AFV_NATIVE_API void ATCClient_SetMaxReceiveStreams(ATCClientHandle handle, unsigned int maxStreams);
+    AFV_NATIVE_API void ATCClient_GetStreamPoolStatistics(ATCClientHandle handle, afv_native::StreamPoolStatistics *statsOut);
     AFV_NATIVE_API void ATCClient_StartAudio(ATCClientHandle handle);
     AFV_NATIVE_API void ATCClient_StopAudio(ATCClientHandle handle);
     AFV_NATIVE_API bool ATCClient_IsAudioRunning(ATCClientHandle handle);
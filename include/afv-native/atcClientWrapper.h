@@ -3,6 +3,7 @@
 #include "afv_native_export.h"
 #include "event.h"
 #include "hardwareType.h"
+#include "jitterStatistics.h"
 #include <functional>
 #include <map>
 #include <string>
@@ -96,6 +97,17 @@ namespace afv_native::api {
         AFV_NATIVE_API void SetEnableOutputEffects(bool enableEffects);
         AFV_NATIVE_API bool GetEnableInputFilters() const;
 
+        // Picks how received voice is buffered: MinimumLatency, Robust for poor links, or Balanced
+        AFV_NATIVE_API void SetJitterLatencyMode(JitterLatencyMode mode);
+        // Turns Opus in-band FEC on or off for transmitted voice, tuned for the expected packet loss
+        AFV_NATIVE_API void SetEnableTransmitFec(bool enable, int expectedLossPercent);
+        AFV_NATIVE_API bool GetStreamJitterStatistics(std::string callsign, JitterStatistics &statsOut);
+        AFV_NATIVE_API bool GetStreamJitterStatistics(char *callsign, JitterStatistics &statsOut);
+        AFV_NATIVE_API JitterStatistics GetFrequencyJitterStatistics(unsigned int freq);
+        // Caps how many callsigns are decoded at once, replacing the least recently heard; 0 for no cap
+        AFV_NATIVE_API void SetMaxReceiveStreams(unsigned int maxStreams);
+        AFV_NATIVE_API StreamPoolStatistics GetStreamPoolStatistics();
+
         AFV_NATIVE_API void StartAudio();
         AFV_NATIVE_API void StopAudio();
         AFV_NATIVE_API bool IsAudioRunning();
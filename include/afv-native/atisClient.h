@@ -46,6 +46,11 @@ namespace afv_native {
          * (It's used for some tear-down operations which must run to completion
          * after the client is shut-down if possible.)
          *
+         * The voice channel's socket is watched by this loop as well, so it
+         * must be left blocked waiting for events (event_base_dispatch) rather
+         * than polled between sleeps - or given an event_base of its own,
+         * dispatched on a thread of its own.
+         *
          * @param evBase an initialised libevent event_base to register the client's
          *      asynchronous IO and deferred operations against.
          * @param resourceBasePath A relative or absolute path to where the AFV-native
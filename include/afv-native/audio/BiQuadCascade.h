@@ -0,0 +1,180 @@
+#pragma once
+#include "afv-native/audio/Kernels.h"
+#include "afv-native/audio/audio_params.h"
+#include <cstddef>
+
+namespace afv_native { namespace audio {
+    /** BiQuadSection is one second order section, normalised so that a0 is 1. */
+    struct BiQuadSection {
+        double b0, b1, b2, a1, a2;
+    };
+
+    /** biquad holds constexpr versions of the RBJ Audio EQ Cookbook designs in BiQuadFilter, so
+     * that fixed filter chains can be built by the compiler rather than at runtime.
+     */
+    namespace biquad {
+        namespace detail {
+            // <cmath> isn't constexpr in C++17, so these are series expansions that converge to
+            // full double precision over the ranges the designs use.
+            constexpr double pi   = 3.14159265358979323846;
+            constexpr double ln10 = 2.30258509299404568402;
+
+            constexpr double wrapPhase(double x) {
+                while (x > pi) {
+                    x -= 2.0 * pi;
+                }
+                while (x < -pi) {
+                    x += 2.0 * pi;
+                }
+                return x;
+            }
+
+            constexpr double sin(double x) {
+                x           = wrapPhase(x);
+                double term = x, sum = x;
+                for (int n = 1; n < 24; n++) {
+                    term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+                    sum += term;
+                }
+                return sum;
+            }
+
+            constexpr double cos(double x) {
+                x           = wrapPhase(x);
+                double term = 1.0, sum = 1.0;
+                for (int n = 1; n < 24; n++) {
+                    term *= -x * x / ((2.0 * n - 1.0) * (2.0 * n));
+                    sum += term;
+                }
+                return sum;
+            }
+
+            constexpr double exp(double x) {
+                // halve the argument until the series converges quickly, then square back up.
+                int halvings = 0;
+                while (x > 0.5 || x < -0.5) {
+                    x /= 2.0;
+                    halvings++;
+                }
+                double term = 1.0, sum = 1.0;
+                for (int n = 1; n < 24; n++) {
+                    term *= x / n;
+                    sum += term;
+                }
+                for (int i = 0; i < halvings; i++) {
+                    sum *= sum;
+                }
+                return sum;
+            }
+
+            constexpr double sqrt(double x) {
+                if (x <= 0.0) {
+                    return 0.0;
+                }
+                double root = x > 1.0 ? x : 1.0;
+                for (int i = 0; i < 64; i++) {
+                    const double next = 0.5 * (root + x / root);
+                    if (next == root) {
+                        break;
+                    }
+                    root = next;
+                }
+                return root;
+            }
+
+            /** shelfGain is the RBJ cookbook's A for a gain of dbGain decibels. */
+            constexpr double shelfGain(double dbGain) {
+                return exp(dbGain / 40.0 * ln10);
+            }
+        } // namespace detail
+
+        /** custom normalises a section given in the same order as BiQuadFilter::customBuild. */
+        constexpr BiQuadSection custom(double aa0, double aa1, double aa2, double b0, double b1, double b2) {
+            return BiQuadSection{b0 / aa0, b1 / aa0, b2 / aa0, aa1 / aa0, aa2 / aa0};
+        }
+
+        constexpr BiQuadSection lowPass(double sampleRate, double cutoffFrequency, double q) {
+            const double w0    = 2.0 * detail::pi * cutoffFrequency / sampleRate;
+            const double cosw0 = detail::cos(w0);
+            const double alpha = detail::sin(w0) / (2.0 * q);
+            return custom(1.0 + alpha, -2.0 * cosw0, 1.0 - alpha, (1.0 - cosw0) / 2.0, 1.0 - cosw0, (1.0 - cosw0) / 2.0);
+        }
+
+        constexpr BiQuadSection highPass(double sampleRate, double cutoffFrequency, double q) {
+            const double w0    = 2.0 * detail::pi * cutoffFrequency / sampleRate;
+            const double cosw0 = detail::cos(w0);
+            const double alpha = detail::sin(w0) / (2.0 * q);
+            return custom(1.0 + alpha, -2.0 * cosw0, 1.0 - alpha, (1.0 + cosw0) / 2.0, -(1.0 + cosw0), (1.0 + cosw0) / 2.0);
+        }
+
+        constexpr BiQuadSection peakingEQ(double sampleRate, double centreFrequency, double q, double dbGain) {
+            const double w0    = 2.0 * detail::pi * centreFrequency / sampleRate;
+            const double cosw0 = detail::cos(w0);
+            const double alpha = detail::sin(w0) / (2.0 * q);
+            const double a     = detail::shelfGain(dbGain);
+            return custom(1.0 + alpha / a, -2.0 * cosw0, 1.0 - alpha / a, 1.0 + alpha * a, -2.0 * cosw0, 1.0 - alpha * a);
+        }
+
+        constexpr BiQuadSection lowShelf(double sampleRate, double centreFrequency, double q, double dbGain) {
+            const double w0    = 2.0 * detail::pi * centreFrequency / sampleRate;
+            const double cosw0 = detail::cos(w0);
+            const double alpha = detail::sin(w0) / (2.0 * q);
+            const double a     = detail::shelfGain(dbGain);
+            const double k     = 2.0 * detail::sqrt(a) * alpha;
+            return custom((a + 1.0) + (a - 1.0) * cosw0 + k,
+                          -2.0 * ((a - 1.0) + (a + 1.0) * cosw0),
+                          (a + 1.0) + (a - 1.0) * cosw0 - k,
+                          a * ((a + 1.0) - (a - 1.0) * cosw0 + k),
+                          2.0 * a * ((a - 1.0) - (a + 1.0) * cosw0),
+                          a * ((a + 1.0) - (a - 1.0) * cosw0 - k));
+        }
+
+        constexpr BiQuadSection highShelf(double sampleRate, double centreFrequency, double q, double dbGain) {
+            const double w0    = 2.0 * detail::pi * centreFrequency / sampleRate;
+            const double cosw0 = detail::cos(w0);
+            const double alpha = detail::sin(w0) / (2.0 * q);
+            const double a     = detail::shelfGain(dbGain);
+            const double k     = 2.0 * detail::sqrt(a) * alpha;
+            return custom((a + 1.0) - (a - 1.0) * cosw0 + k,
+                          2.0 * ((a - 1.0) - (a + 1.0) * cosw0),
+                          (a + 1.0) - (a - 1.0) * cosw0 - k,
+                          a * ((a + 1.0) + (a - 1.0) * cosw0 + k),
+                          -2.0 * a * ((a - 1.0) + (a + 1.0) * cosw0),
+                          a * ((a + 1.0) + (a - 1.0) * cosw0 - k));
+        }
+    } // namespace biquad
+
+    /** BiQuadCascade filters whole frames through a fixed chain of up to
+     * kernels::biquadMaxSections second order sections, in transposed direct form II.
+     *
+     * The sections are run side by side in vector lanes, each one a sample behind the one before
+     * it, so the chain costs about as much as a single section would.  See
+     * kernels::biquadCascade.
+     */
+    class BiQuadCascade {
+      public:
+        BiQuadCascade();
+        BiQuadCascade(const BiQuadSection *sections, size_t count);
+
+        template <size_t N>
+        explicit BiQuadCascade(const BiQuadSection (&sections)[N]):
+            BiQuadCascade(sections, N) {
+            static_assert(N > 0 && N <= kernels::biquadMaxSections, "too many sections for one cascade");
+        }
+
+        /** process filters count samples of buf in place, carrying the filter state over from the
+         * previous call.
+         */
+        void process(SampleType *buf, size_t count);
+
+        /** reset clears the filter state, as if the cascade had only ever seen silence. */
+        void reset();
+
+        size_t size() const {
+            return mLanes.sections;
+        }
+
+      private:
+        kernels::BiQuadLanes mLanes;
+    };
+}} // namespace afv_native::audio
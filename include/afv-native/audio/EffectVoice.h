@@ -0,0 +1,45 @@
+#pragma once
+#include "afv-native/audio/ISampleStorage.h"
+#include "afv-native/audio/audio_params.h"
+#include <cstddef>
+#include <memory>
+
+namespace afv_native { namespace audio {
+    /** EffectVoice plays a recorded effect, such as a click or a noise bed, straight out of its
+     * ISampleStorage.
+     *
+     * A voice is just a read-only pointer to the samples and a cursor, set up once with setSample
+     * and then started and stopped as often as needed.  Neither start, stop nor mixFrame allocate,
+     * so a radio can keep one voice per effect and re-arm it from the audio thread.
+     */
+    class EffectVoice {
+      public:
+        EffectVoice();
+
+        /** setSample sets what the voice plays, and stops it.  sample may be empty, in which case
+         * the voice never plays.
+         */
+        void setSample(std::shared_ptr<ISampleStorage> sample, bool loop);
+
+        /** start plays the sample from the beginning. */
+        void start();
+        void stop();
+
+        bool isPlaying() const {
+            return mPlaying;
+        }
+
+        /** mixFrame adds the next frame of the sample, scaled by gain, into bufferOut.  A voice
+         * that isn't looping stops by itself once it runs out of samples.
+         */
+        void mixFrame(SampleType *bufferOut, float gain);
+
+      private:
+        std::shared_ptr<ISampleStorage> mStorage;
+        const SampleType               *mSamples;
+        size_t                          mLength;
+        size_t                          mPosition;
+        bool                            mLoop;
+        bool                            mPlaying;
+    };
+}} // namespace afv_native::audio
@@ -0,0 +1,96 @@
+#pragma once
+#include "afv-native/audio/audio_params.h"
+#include "afv-native/utility.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace afv_native { namespace audio { namespace kernels {
+    /** kernels are the inner sample loops shared by the mixers and the voice pipeline.
+     *
+     * Each kernel has a scalar implementation and, where the target supports it, SSE2, AVX2 or
+     * NEON versions.  The best implementation for the running CPU is picked by selectImplementation,
+     * so there is no per-sample dispatch cost.
+     *
+     * None of the kernels require aligned buffers, but buffers from allocateAligned avoid
+     * straddling cache lines on the wider vector units.
+     */
+
+    /** bufferAlignment is the alignment, in bytes, of buffers from allocateAligned. */
+    const size_t bufferAlignment = 32;
+
+    /** mix adds src, scaled by gain, into dst. */
+    void mix(SampleType *RESTRICT dst, const SampleType *RESTRICT src, float gain, size_t count);
+
+    /** scale multiplies buf by gain in place. */
+    void scale(SampleType *buf, float gain, size_t count);
+
+    /** gainClamp multiplies buf by gain in place, and then clamps it to the range -1.0 to 1.0.
+     * NaN samples come out as 0.0.
+     */
+    void gainClamp(SampleType *buf, float gain, size_t count);
+
+    /** clamp limits buf to the range -1.0 to 1.0 in place, as gainClamp does. */
+    inline void clamp(SampleType *buf, size_t count) {
+        gainClamp(buf, 1.0f, count);
+    }
+
+    /** peak returns the largest absolute sample value in buf. count must be at least 1. */
+    SampleType peak(const SampleType *buf, size_t count);
+
+    /** interleave combines count samples from left and right into 2*count stereo samples. */
+    void interleave(const SampleType *RESTRICT left, const SampleType *RESTRICT right, SampleType *RESTRICT out, size_t count);
+
+    /** floatToInt16 converts to 16-bit PCM, scaling by 32767 and truncating, saturating at the
+     * int16 limits.
+     */
+    void floatToInt16(int16_t *RESTRICT dst, const SampleType *RESTRICT src, size_t count);
+
+    /** int16ToFloat converts from 16-bit PCM, scaling by 1/32768. */
+    void int16ToFloat(SampleType *RESTRICT dst, const int16_t *RESTRICT src, size_t count);
+
+    /** biquadMaxSections is the longest chain of second order sections biquadCascade can run. */
+    const size_t biquadMaxSections = 8;
+
+    /** BiQuadLanes is a chain of second order sections laid out for biquadCascade, with section k
+     * of the chain in lane k of each array.
+     *
+     * b0-b2, a1 and a2 are the coefficients, normalised so that a0 is 1, and s1 and s2 are the
+     * transposed direct form II state.  Lanes from sections onwards are computed but otherwise
+     * ignored, so they must still hold finite values.
+     */
+    struct BiQuadLanes {
+        alignas(bufferAlignment) double b0[biquadMaxSections];
+        alignas(bufferAlignment) double b1[biquadMaxSections];
+        alignas(bufferAlignment) double b2[biquadMaxSections];
+        alignas(bufferAlignment) double a1[biquadMaxSections];
+        alignas(bufferAlignment) double a2[biquadMaxSections];
+        alignas(bufferAlignment) double s1[biquadMaxSections];
+        alignas(bufferAlignment) double s2[biquadMaxSections];
+        size_t sections;
+    };
+
+    /** biquadCascade filters buf in place through each section of lanes in turn, updating the
+     * section state as it goes.  lanes.sections must be between 1 and biquadMaxSections.
+     *
+     * A single section's recursion can't be vectorised, so the sections are run side by side
+     * instead: each step of the loop advances every section by one sample, with section k working
+     * on the sample section k-1 finished in the step before.  The first and last few steps, where
+     * the chain is filling and draining, are done without vectors.
+     */
+    void biquadCascade(BiQuadLanes &lanes, SampleType *buf, size_t count);
+
+    /** selectImplementation picks the kernel implementation for the running CPU and logs it.  The
+     * radio simulations call it when they are constructed, so the audio threads never do the CPU
+     * probing or logging themselves.  Calling it again does nothing.
+     */
+    void selectImplementation();
+
+    /** implementationName returns the name of the kernel implementation in use. */
+    const char *implementationName();
+
+    /** allocateAligned allocates a zeroed buffer of count samples, aligned to bufferAlignment.
+     * It must be released with freeAligned.
+     */
+    SampleType *allocateAligned(size_t count);
+    void        freeAligned(SampleType *buf);
+}}} // namespace afv_native::audio::kernels
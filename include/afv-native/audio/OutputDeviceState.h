@@ -1,9 +1,14 @@
 #pragma once
 #include <afv-native/audio/audio_params.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 
 namespace afv_native {
     class OutputDeviceState {
       public:
+        /* All of the sample buffers are allocated with kernels::allocateAligned. */
+
         /** mChannelBuffer is our single-radio/channel workbuffer - we do our per-channel fx mixing
          * in here before we mix into the mMixingBuffer
          */
@@ -18,7 +23,50 @@ namespace afv_native {
         audio::SampleType *mRightMixingBuffer;
         audio::SampleType *mFetchBuffer;
 
+        /** mFrameTick is the tick of the frame this output last rendered, on the timeline shared
+         * by all of the outputs reading from the same streams.  Only touched by this output.
+         */
+        uint64_t mFrameTick = 0;
+
+        /** RenderTimings accumulates the time this output has spent in each stage of rendering
+         * its frames, in nanoseconds.
+         */
+        struct RenderTimings {
+            uint64_t frames = 0;
+            /** decodeNs is spent pulling every stream's frame for the tick. */
+            uint64_t decodeNs = 0;
+            /** radiosNs is spent filtering, adding effects to and mixing the radios on this output. */
+            uint64_t radiosNs = 0;
+            /** outputNs is spent copying or interleaving the mix into the device's buffer. */
+            uint64_t outputNs = 0;
+        };
+
         OutputDeviceState();
         virtual ~OutputDeviceState();
+
+        /** addRenderTimings adds one frame's stage times to the totals.  This output only. */
+        void addRenderTimings(std::chrono::steady_clock::duration decode, std::chrono::steady_clock::duration radios, std::chrono::steady_clock::duration output);
+
+        /** getRenderTimings returns the totals so far.  This may be called from any thread. */
+        RenderTimings getRenderTimings() const;
+
+        /** advanceFrameTick moves this output on to its next frame tick.
+         *
+         * Outputs run from independent device clocks, so whichever output is furthest ahead
+         * sets latestTick and does the decoding.  If this output has fallen further behind than
+         * the decoded frame cache covers (or has only just started), it is resynchronised to the
+         * leading output.
+         *
+         * @param latestTick the newest tick rendered by any output.  Updated if this output leads.
+         * @param maxLag how many ticks the decoded frame cache holds.
+         * @return the tick to render.
+         */
+        uint64_t advanceFrameTick(std::atomic<uint64_t> &latestTick, uint64_t maxLag);
+
+      private:
+        std::atomic<uint64_t> mTimedFrames{0};
+        std::atomic<uint64_t> mDecodeNs{0};
+        std::atomic<uint64_t> mRadiosNs{0};
+        std::atomic<uint64_t> mOutputNs{0};
     };
 } // namespace afv_native
@@ -12,12 +12,14 @@ namespace afv_native::audio
         explicit SimpleCompressorEffect();
         virtual ~SimpleCompressorEffect();
 
+        /** transformFrame compresses a mono frame.  bufferOut may be the same buffer as bufferIn.
+         *
+         * The compressor works on the samples directly, so nothing is allocated per frame.
+         */
         void transformFrame(SampleType *bufferOut, SampleType const bufferIn[]);
 
     private:
         sf_compressor_state_st m_simpleCompressor;
-        sf_snd m_inputSound;
-        sf_snd m_outputSound;
     };
 }
 
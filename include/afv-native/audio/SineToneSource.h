@@ -51,6 +51,9 @@ namespace afv_native { namespace audio {
       public:
         explicit SineToneSource(double freqHz, float gain = 1.0);
         SourceStatus getAudioFrame(SampleType *bufferOut) override;
+
+        /** reset restarts the tone from the beginning of its first cycle. */
+        void reset();
     };
 }} // namespace afv_native::audio
 
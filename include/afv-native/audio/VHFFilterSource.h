@@ -34,11 +34,10 @@
 #ifndef AFV_NATIVE_VHFFILTERSOURCE_H
 #define AFV_NATIVE_VHFFILTERSOURCE_H
 
-#include <afv-native/audio/BiQuadFilter.h>
+#include <afv-native/audio/BiQuadCascade.h>
 #include <afv-native/audio/ISampleSource.h>
 #include <afv-native/hardwareType.h>
 #include <memory>
-#include <vector>
 
 namespace chunkware_simple {
     class SimpleComp;
@@ -50,13 +49,16 @@ namespace afv_native { namespace audio {
      *
      * If you want a more generic filter wrapper, look at FilterSource.
      *
-     * @note VHFFilterSource is defined inline and staticly to encourage the compiler to inline and unroll/vectorise as
-     *       much as possible.  Because we run these on every incoming sample, we actually want it to be fairly fast.
+     * @note Because we run these on every incoming sample, we actually want it to be fairly fast, so each stage runs
+     *       over the whole frame before the next starts, and the filters for each HardwareType are a constexpr
+     *       BiQuadCascade built by the compiler.
      */
     class VHFFilterSource {
       public:
         explicit VHFFilterSource(HardwareType hd = HardwareType::Schmid_ED_137B);
         virtual ~VHFFilterSource();
+        VHFFilterSource(const VHFFilterSource &) = delete;
+        VHFFilterSource &operator=(const VHFFilterSource &) = delete;
 
         /** transformFrame lets use apply this filter to a normal buffer, without following the sink/source flow.
          *
@@ -64,14 +66,24 @@ namespace afv_native { namespace audio {
          */
         void transformFrame(SampleType *bufferOut, SampleType const bufferIn[]);
 
+        /** reset returns the compressor, filters and limiter to their starting state, as if the
+         * source had just been created, without reallocating anything.
+         */
+        void reset();
+
       protected:
         void setupPresets();
 
         chunkware_simple::SimpleComp  *compressor;
         chunkware_simple::SimpleLimit *limiter;
         float compressorPostGain;
-        std::vector<BiQuadFilter> mFilters;
+        BiQuadCascade mFilters;
         HardwareType hardware = HardwareType::Schmid_ED_137B;
+
+        /** mLimiterKey holds the compressed frame from before the filters, which the limiter
+         * uses alongside the filtered frame to decide how much to limit.
+         */
+        SampleType mLimiterKey[frameSizeSamples];
     };
 }} // namespace afv_native::audio
 
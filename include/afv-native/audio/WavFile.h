@@ -76,6 +76,13 @@ namespace afv_native { namespace audio {
     };
 
     AudioSampleData *LoadWav(const char *fileName);
+
+    /** SaveWav writes frameCount frames of channelCount interleaved channels to fileName as a
+     * 32-bit float WAV file at sampleRate.
+     *
+     * @return true if the whole file was written.
+     */
+    bool SaveWav(const char *fileName, const float *samples, size_t frameCount, int channelCount, int sampleRate);
 }} // namespace afv_native::audio
 
 #endif /* AFV_NATIVE_WAVFILE_H */
@@ -35,13 +35,16 @@
 #define AFV_NATIVE_CHANNEL_H
 
 #include "afv-native/Log.h"
+#include "afv-native/cryptodto/DatagramBuffer.h"
 #include "afv-native/cryptodto/SequenceTest.h"
 #include "afv-native/cryptodto/dto/ICryptoDTO.h"
 #include "afv-native/cryptodto/params.h"
 #include <cstdint>
 #include <msgpack.hpp>
+#include <mutex>
 #include <openssl/evp.h>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace afv_native { namespace cryptodto {
@@ -51,57 +54,81 @@ namespace afv_native { namespace cryptodto {
         class Header;
     } // namespace dto
 
+    /** DecapsulatedDto is a DTO decoded in place by Channel::Decapsulate.  Everything in it
+     * points into the datagram it was decoded from, and is only valid for as long as that is.
+     */
+    struct DecapsulatedDto {
+        std::string_view channelTag;
+        sequence_t       sequence = 0;
+        CryptoDtoMode    mode     = CryptoModeUndefined;
+        std::string_view dtoName;
+        /** body is the encoded DTO, preceded by its 16 bit length. */
+        const unsigned char *body    = nullptr;
+        size_t               bodyLen = 0;
+    };
+
     class Channel {
       protected:
         unsigned char aeadTransmitKey[aeadModeKeySize];
         unsigned char aeadReceiveKey[aeadModeKeySize];
 
+        /** mTransmitContext and mReceiveContext are keyed once, whenever the keys change, so
+         * that each packet only has to set its nonce.
+         *
+         * Packets are sent from both the audio and event threads, so the transmit context is
+         * guarded by mTransmitLock.  mReceiveLock only keeps the receive context from being rekeyed
+         * while a packet is being decrypted.
+         */
+        EVP_CIPHER_CTX *mTransmitContext;
+        EVP_CIPHER_CTX *mReceiveContext;
+        std::mutex      mTransmitLock;
+        std::mutex      mReceiveLock;
+
         static void make_aead_key(unsigned char keyBuffer[]);
 
-        size_t decryptChaCha20Poly1305(unsigned char *bodyOut, const unsigned char *cipherIn, size_t cipherLen, const dto::Header &header, const unsigned char *aadIn, size_t aadLen);
+        /** keyChaCha20Poly1305 sets context up for ChaCha20-Poly1305 with key, ready for
+         * encryption if encrypt is 1, or decryption if it's 0.
+         */
+        static bool keyChaCha20Poly1305(EVP_CIPHER_CTX *context, const unsigned char *key, int encrypt);
+
+        /** decryptChaCha20Poly1305 may decrypt in place, with bodyOut the same as cipherIn. */
+        size_t decryptChaCha20Poly1305(unsigned char *bodyOut, const unsigned char *cipherIn, size_t cipherLen, sequence_t sequence, const unsigned char *aadIn, size_t aadLen);
 
-        size_t encryptChaCha20Poly1305(unsigned char *cipherOut, const unsigned char *plainIn, size_t plainLen, const dto::Header &header, const unsigned char *aadIn, size_t aadLen);
+        /** encryptChaCha20Poly1305 may encrypt in place, with cipherOut the same as plainIn.  The
+         * tag is written after the ciphertext.
+         */
+        size_t encryptChaCha20Poly1305(unsigned char *cipherOut, const unsigned char *plainIn, size_t plainLen, sequence_t sequence, const unsigned char *aadIn, size_t aadLen);
 
         static void makeChaCha20Poly1305Nonce(uint64_t sequence, unsigned char *nonceBuffer);
 
       protected:
-        /** encodeDto takes the DTO provided as dto and encodes it into dtoBuf.
-         *
-         * This forms the ciphertext portion of an encrypted DTO message.
-         *
-         * @tparam T type of the DTO.  T must provide a getName() method that
-         *          returns the DTO name, and be encodable by msgpack-c.
-         * @param dtoBuf the sbuffer object to pass the encoded dto out in.
-         * @param dto the dto to encode
-         * @return true if the message was successfully encoded, false otherwise.
+        /** HeaderTemplate is the length-prefixed header for one mode, serialised ahead of time.
+         * The sequence is packed as a fixed width uint64 at sequenceOffset, so that each
+         * datagram only has to patch it in.
          */
-        template <class T>
-        static bool encodeDto(msgpack::sbuffer &dtoBuf, const T &dto) {
-            // assemble the body and pack it.
-            std::string dtoName = dto.getName();
-            uint16_t    nLen =
-                static_cast<uint16_t>(dtoName.length());
-            dtoBuf.write(reinterpret_cast<char *>(&nLen), 2);
-            dtoBuf.write(dtoName.data(), nLen);
-
-            // because we don't know the dto size in advance, pack it into it's own
-            // temp buffer, then copy it into the actual payload buffer.
-            msgpack::sbuffer dtoTempBuf;
-            msgpack::pack(dtoTempBuf, dto);
-            nLen =
-                static_cast<uint16_t>(dtoTempBuf.size());
-                if (dtoTempBuf.size() > UINT16_MAX) {
-                    return false;
-            }
+        struct HeaderTemplate {
+            std::vector<unsigned char> bytes;
+            size_t                     sequenceOffset = 0;
+        };
 
-            dtoBuf.write(reinterpret_cast<char *>(&nLen), 2);
-            dtoBuf.write(dtoTempBuf.data(),
-                         dtoTempBuf.size());
+        /** mHeaderTemplates are indexed by mode, and rebuilt whenever ChannelTag changes.  They
+         * aren't locked, so datagrams mustn't be built while setChannelConfig is running.
+         */
+        HeaderTemplate mHeaderTemplates[CryptoModeLast];
 
-            assert(dtoBuf.size() == (dtoTempBuf.size() + 2 +
-                                     dtoName.size() + 2));
-            return true;
-        }
+        void buildHeaderTemplates();
+
+        /** beginDatagram starts datagramOut with the length-prefixed header for sequence and
+         * mode, copied from its template.
+         *
+         * @return the offset the body starts at, or 0 if there's no header for mode.
+         */
+        size_t beginDatagram(DatagramBuffer &datagramOut, sequence_t sequence, CryptoDtoMode mode);
+
+        /** sealDatagram encrypts the body, from bodyStart to the end of datagramOut, in place and
+         * appends the tag, as mode requires.
+         */
+        bool sealDatagram(DatagramBuffer &datagramOut, size_t bodyStart, sequence_t sequence, CryptoDtoMode mode);
 
       public:
         std::string ChannelTag;
@@ -109,24 +136,54 @@ namespace afv_native { namespace cryptodto {
         time_t      LastReceive;
 
         explicit Channel();
+        virtual ~Channel();
+
+        Channel(const Channel &) = delete;
+        Channel &operator=(const Channel &) = delete;
 
         virtual void setChannelConfig(const dto::ChannelConfig &config);
 
+        /** Encapsulate builds the datagram carrying dto in datagramOut, in a single pass.
+         *
+         * The DTO is packed straight in after the header and its name, its length is patched in
+         * once it's known, and the body is then encrypted where it lies.
+         *
+         * @tparam T type of the DTO.  T must provide a getName() method that
+         *          returns the DTO name, and be encodable by msgpack-c.
+         * @return true if the datagram was built, false if the DTO was too large or couldn't be
+         *          encrypted.
+         */
         template <class T>
-        size_t Encapsulate(unsigned char *bufOut, size_t bufOutLen, sequence_t sequence, cryptodto::CryptoDtoMode mode, const T &dto) {
-            msgpack::sbuffer dtoBuf;
-                if (!encodeDto(dtoBuf, dto)) {
-                    return 0;
+        bool Encapsulate(DatagramBuffer &datagramOut, sequence_t sequence, cryptodto::CryptoDtoMode mode, const T &dto) {
+            datagramOut.clear();
+            const size_t bodyStart = beginDatagram(datagramOut, sequence, mode);
+            if (bodyStart == 0) {
+                return false;
             }
-            // use the generic encapsulate method.
-            return Encapsulate(reinterpret_cast<const unsigned char *>(
-                                   dtoBuf.data()),
-                               dtoBuf.size(), sequence, mode, bufOut, bufOutLen);
-        }
 
-        size_t Encapsulate(const unsigned char *plainTextBuf, size_t plainTextLen, sequence_t sequence, cryptodto::CryptoDtoMode mode, unsigned char *cipherTextBufOut, size_t cipherTextLen);
+            const std::string dtoName = dto.getName();
+            const uint16_t    nameLen = static_cast<uint16_t>(dtoName.length());
+            datagramOut.write(reinterpret_cast<const char *>(&nameLen), 2);
+            datagramOut.write(dtoName.data(), nameLen);
+
+            // we don't know the dto size until it's packed, so leave room for it and fill it in after.
+            const size_t dtoLenOffset = datagramOut.skip(2);
+            msgpack::pack(datagramOut, dto);
+            const size_t dtoLen = datagramOut.size() - dtoLenOffset - 2;
+            if (dtoLen > UINT16_MAX) {
+                return false;
+            }
+            datagramOut.patchUint16(dtoLenOffset, static_cast<uint16_t>(dtoLen));
+
+            return sealDatagram(datagramOut, bodyStart, sequence, mode);
+        }
 
-        bool Decapsulate(const unsigned char *cipherTextIn, size_t cipherTextLen, std::string &channelTag, sequence_t &sequence, CryptoDtoMode &modeOut, std::string &dtoNameOut, msgpack::sbuffer &dtoOut);
+        /** Decapsulate decodes the datagram in datagramIn without copying it, decrypting the body
+         * in place over the ciphertext.  dtoOut is left pointing into datagramIn.
+         *
+         * @return true if the datagram was well formed and, if encrypted, authentic.
+         */
+        bool Decapsulate(unsigned char *datagramIn, size_t datagramLen, DecapsulatedDto &dtoOut);
     };
 }} // namespace afv_native::cryptodto
 
@@ -0,0 +1,59 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace afv_native { namespace cryptodto {
+    /** DatagramBuffer is a reusable buffer that a datagram is assembled in, front to back.
+     *
+     * It is a msgpack-c stream, so DTOs can be packed straight into it.  Clearing it keeps the
+     * storage, so once it has grown to fit the largest datagram sent, building a datagram never
+     * allocates.
+     */
+    class DatagramBuffer {
+      public:
+        explicit DatagramBuffer(size_t initialCapacity): mData(initialCapacity), mSize(0) {
+        }
+
+        void clear() {
+            mSize = 0;
+        }
+
+        void write(const char *buf, size_t len) {
+            ::memcpy(grow(len), buf, len);
+        }
+
+        /** skip leaves len bytes to be filled in later with patch, and returns their offset. */
+        size_t skip(size_t len) {
+            grow(len);
+            return mSize - len;
+        }
+
+        void patchUint16(size_t offset, uint16_t value) {
+            ::memcpy(mData.data() + offset, &value, sizeof(value));
+        }
+
+        unsigned char *data() {
+            return mData.data();
+        }
+        size_t size() const {
+            return mSize;
+        }
+
+      private:
+        std::vector<unsigned char> mData;
+        size_t                     mSize;
+
+        /** grow extends the datagram by len bytes, and returns where they start. */
+        unsigned char *grow(size_t len) {
+            if (mSize + len > mData.size()) {
+                mData.resize(std::max(mData.size() * 2, mSize + len));
+            }
+            unsigned char *start = mData.data() + mSize;
+            mSize += len;
+            return start;
+        }
+    };
+}} // namespace afv_native::cryptodto
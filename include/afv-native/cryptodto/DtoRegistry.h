@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace afv_native { namespace cryptodto {
+    /** DtoId numbers the DTOs the voice server can send over a UDPChannel, so that handlers can
+     * be kept in a flat table rather than looked up by name.
+     */
+    enum class DtoId : uint8_t {
+        Unknown = 0,
+        AudioRxOnTransceivers,
+        AudioTxOnTransceivers,
+        AudioOnDirect,
+        Heartbeat,
+        HeartbeatAck,
+        Count
+    };
+
+    const size_t dtoIdCount = static_cast<size_t>(DtoId::Count);
+
+    namespace detail {
+        /** dtoKey packs a DTO name of up to two characters into one integer, so that names can be
+         * told apart with a single switch.  Longer names all map to 0, which no name uses.
+         */
+        constexpr uint16_t dtoKey(std::string_view name) {
+            if (name.empty() || name.size() > 2) {
+                return 0;
+            }
+            return static_cast<uint16_t>(static_cast<unsigned char>(name[0]) | (name.size() == 2 ? static_cast<unsigned char>(name[1]) << 8 : 0));
+        }
+    } // namespace detail
+
+    /** dtoIdFromName maps a wire name to its DtoId, or DtoId::Unknown.  It's usable at compile
+     * time, so every name in the table is checked against the others when it's built.
+     */
+    constexpr DtoId dtoIdFromName(std::string_view name) {
+        switch (detail::dtoKey(name)) {
+            case detail::dtoKey("AR"):
+                return DtoId::AudioRxOnTransceivers;
+            case detail::dtoKey("AT"):
+                return DtoId::AudioTxOnTransceivers;
+            case detail::dtoKey("AD"):
+                return DtoId::AudioOnDirect;
+            case detail::dtoKey("H"):
+                return DtoId::Heartbeat;
+            case detail::dtoKey("HA"):
+                return DtoId::HeartbeatAck;
+            default:
+                return DtoId::Unknown;
+        }
+    }
+
+    static_assert(dtoIdFromName("AR") == DtoId::AudioRxOnTransceivers && dtoIdFromName("HA") == DtoId::HeartbeatAck, "DTO names must map to their ids");
+    static_assert(dtoIdFromName("A") == DtoId::Unknown && dtoIdFromName("ARX") == DtoId::Unknown, "unknown DTO names mustn't map to an id");
+
+    /** DtoHandler is called with the encoded DTO, and the user_data it was registered with. */
+    typedef void (*DtoHandler)(const unsigned char *bufIn, size_t bufLen, void *user_data);
+}} // namespace afv_native::cryptodto
@@ -35,7 +35,9 @@
 #define AFV_NATIVE_SEQUENCETEST_H
 
 #include "afv-native/cryptodto/params.h"
+#include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 
 namespace afv_native { namespace cryptodto {
@@ -48,12 +50,38 @@ namespace afv_native { namespace cryptodto {
         Overflow,
     };
 
+    /** maxSequenceWindow is the widest replay window SequenceTest supports. */
+    const unsigned maxSequenceWindow = 1024;
+
+    /** SequenceTest is the replay window for received sequence numbers.
+     *
+     * It tracks the oldest sequence not yet received, and which of the window's worth of
+     * sequences after it have been.  The received flags are kept in a ring of 64 bit words,
+     * indexed by sequence number, so moving the window along never shifts the bitmap - the
+     * flags it passes over are cleared a word at a time, and the next gap is found with a bit
+     * scan per word.
+     */
     class SequenceTest {
       private:
-        sequence_bitfield_t _bitfield;
+        /** ringBits is more than the widest window, so that the flags for a full window never
+         * wrap round onto each other.
+         */
+        static const size_t ringBits  = 2 * maxSequenceWindow;
+        static const size_t ringWords = ringBits / (sizeof(sequence_bitfield_t) * 8);
+
+        sequence_bitfield_t _ring[ringWords];
         sequence_t          _min;
         unsigned            _window;
 
+        bool isReceived(sequence_t sequence) const;
+        void markReceived(sequence_t sequence);
+
+        /** clearRange clears the flags for count sequences from first on. */
+        void clearRange(sequence_t first, sequence_t count);
+
+        /** advanceWindow moves _min on past any sequences from it on that have already been
+         * received, clearing their flags, so that it's left on the first one that hasn't.
+         */
         void advanceWindow();
 
       public:
@@ -70,8 +98,20 @@ namespace afv_native { namespace cryptodto {
         ReceiveOutcome Received(sequence_t newSequence);
 
         sequence_t GetNext() const;
+        unsigned   GetWindow() const;
 
         void reset();
+
+        /** Duplicates counts packets rejected because they'd already been received within the
+         * window.
+         */
+        std::atomic<uint32_t> Duplicates;
+        /** Late counts packets rejected because the window had already moved past them. */
+        std::atomic<uint32_t> Late;
+        /** Overflows counts packets so far ahead that the window had to jump forward over
+         * sequences that hadn't arrived yet.
+         */
+        std::atomic<uint32_t> Overflows;
     };
 }} // namespace afv_native::cryptodto
 
@@ -36,23 +36,28 @@
 
 #include "afv-native/Log.h"
 #include "afv-native/cryptodto/Channel.h"
-#include <Poco/NObserver.h>
-#include <Poco/Net/DatagramSocket.h>
-#include <Poco/Net/NetException.h>
-#include <Poco/Net/SocketAddress.h>
-#include <Poco/Net/SocketNotification.h>
-#include <Poco/Net/SocketReactor.h>
-#include <Poco/Thread.h>
+#include "afv-native/cryptodto/DtoRegistry.h"
 #include <atomic>
 #include <event2/event.h>
-#include <functional>
-#include <unordered_map>
+#include <event2/util.h>
+#include <mutex>
 
 namespace afv_native { namespace cryptodto {
-    typedef void (*DtoHandlerFunc)(const std::string &dtoName, const unsigned char *bufIn, size_t bufLen, void *user_data);
-
+    /** UDPChannel carries DTOs to and from the voice server over UDP.
+     *
+     * The socket is watched by the client's event loop, so datagrams are received and their
+     * handlers run on the event loop's thread.  sendDto may be called from any thread.
+     *
+     * Nothing is received while that loop isn't running, so the host has to keep it dispatching
+     * continuously rather than polling it between sleeps (see Client and ATCClient).
+     */
     class UDPChannel: public Channel {
       private:
+        struct event_base *mEvBase;
+        struct event      *mReadEvent;
+        /** mSocket is only changed with mTxLock held, as sendDto uses it from other threads. */
+        evutil_socket_t mSocket;
+
         std::string mAddress;
 
         /** mDatagramRxBuffer is the channel-internal holding buffer for a
@@ -62,19 +67,52 @@ namespace afv_native { namespace cryptodto {
          */
         unsigned char *mDatagramRxBuffer;
 
-        Poco::Net::DatagramSocket mPocoUDPSocket;
-        Poco::Net::SocketReactor  mPocoSocketReactor;
-        Poco::Thread              mReactorThread;
-        bool mIsOpen = false;
-        std::atomic<sequence_t>   mTxSequence;
-        SequenceTest              receiveSequence;
+#ifdef __linux__
+        /** mRxBatchBuffers holds rxBatchSize datagram buffers (mDatagramRxBuffer being the first),
+         * so that a whole batch can be received with one recvmmsg.
+         */
+        unsigned char *mRxBatchBuffers;
+        /** mKernelDropsSeen is the socket's running total of datagrams dropped by the kernel, as
+         * last reported by SO_RXQ_OVFL.
+         */
+        uint32_t mKernelDropsSeen;
+
+        /** receiveBatches drains the socket a batch at a time and processes everything received. */
+        void receiveBatches();
+#endif
+
+        /** mReceiveBufferSize and mSendBufferSize are the SO_RCVBUF and SO_SNDBUF sizes to open
+         * the socket with, or 0 to leave the system defaults.
+         */
+        int mReceiveBufferSize;
+        int mSendBufferSize;
+        /** mRxTimestampNs is the kernel's receive time for the datagram being handled. */
+        int64_t mRxTimestampNs;
+
+        bool                    mIsOpen = false;
+        std::atomic<sequence_t> mTxSequence;
+        /** mTxBuffer is where outgoing datagrams are built, under mTxLock. */
+        DatagramBuffer mTxBuffer;
+        std::mutex     mTxLock;
+        SequenceTest   receiveSequence;
 
         unsigned int mAcceptableCiphers;
 
-        void readCallback(const Poco::AutoPtr<Poco::Net::ReadableNotification> &notification);
+        /** isRetriableSocketError returns true if err only means the socket would have blocked. */
+        static bool isRetriableSocketError(int err);
+        static void evReadCallback(evutil_socket_t fd, short events, void *arg);
+        void        readCallback();
+
+        /** processDatagram decapsulates one received datagram and passes it to its handler. */
+        void processDatagram(unsigned char *datagram, int dgSize);
 
       protected:
-        std::unordered_map<std::string, std::function<void(const unsigned char *data, size_t len)>> mDtoHandlers;
+        struct DtoHandlerSlot {
+            DtoHandler handler   = nullptr;
+            void      *user_data = nullptr;
+        };
+        /** mDtoHandlers is indexed by DtoId.  DtoId::Unknown never has a handler. */
+        DtoHandlerSlot mDtoHandlers[dtoIdCount];
         int mLastErrno;
 
         void enableRxMode(CryptoDtoMode mode);
@@ -84,7 +122,25 @@ namespace afv_native { namespace cryptodto {
         bool RxModeEnabled(CryptoDtoMode mode) const;
 
       public:
-        explicit UDPChannel(int receiveSequenceHistorySize = 10);
+        /** rxBatchSize is the most datagrams read from the socket at a time. */
+        static const int rxBatchSize = 16;
+        /** rxBatchSizeBuckets is the number of power of two buckets batch sizes are counted in:
+         * 1, 2-3, 4-7, 8-15 and 16.
+         */
+        static const int rxBatchSizeBuckets = 5;
+
+        /** RxBatches is a monotonic counter of the reads done from the socket. */
+        std::atomic<uint32_t> RxBatches;
+        /** RxDatagrams is a monotonic counter of the datagrams received. */
+        std::atomic<uint32_t> RxDatagrams;
+        /** RxBatchSizes counts the reads by how many datagrams they returned. */
+        std::atomic<uint32_t> RxBatchSizes[rxBatchSizeBuckets];
+        /** RxKernelDrops is a monotonic counter of the datagrams the kernel dropped because the
+         * socket's receive buffer was full.  Only counted on Linux.
+         */
+        std::atomic<uint32_t> RxKernelDrops;
+
+        explicit UDPChannel(struct event_base *evBase, int receiveSequenceHistorySize = maxSequenceWindow);
         virtual ~UDPChannel();
 
         bool open();
@@ -93,42 +149,58 @@ namespace afv_native { namespace cryptodto {
 
         template <typename T>
         void sendDto(const T &pkt) {
-            if (!mPocoUDPSocket.impl()) {
+            // packets are sent from both the audio and event threads, and share the one buffer.
+            std::lock_guard<std::mutex> txGuard(mTxLock);
+            if (mSocket == EVUTIL_INVALID_SOCKET) {
                 LOG("UDPChannel", "tried to send on closed socket");
                 return;
             }
-            std::vector<unsigned char> dgBuffer(maxPermittedDatagramSize);
             sequence_t thisSeq = std::atomic_fetch_add(&mTxSequence, static_cast<sequence_t>(1));
 
-            size_t dgSize = Encapsulate<T>(dgBuffer.data(), maxPermittedDatagramSize, thisSeq, CryptoDtoMode::CryptoModeChaCha20Poly1305, pkt);
-            dgBuffer.resize(dgSize);
-            if (dgSize > 0) {
-                try {
-                    int sent = mPocoUDPSocket.sendBytes(
-                        reinterpret_cast<char *>(dgBuffer.data()), dgBuffer.size());
-                    if (sent < dgBuffer.size()) {
-                        LOG("udpchannel", "short write sending datagram - sent %d of %d bytes", sent,
-                            dgBuffer.size());
-                    }
-                } catch (const Poco::Exception &ex) {
-                    if (ex.code() == POCO_EWOULDBLOCK) {
-                        LOG("udpchannel", "UDP packet dropped on send due to TxBuffer being full");
-                    } else {
-                        LOG("udpchannel", "error sending datagram: %s",
-                            ex.displayText().c_str());
-                    }
+            if (!Encapsulate<T>(mTxBuffer, thisSeq, CryptoDtoMode::CryptoModeChaCha20Poly1305, pkt) || mTxBuffer.size() > maxPermittedDatagramSize) {
+                LOG("udpchannel", "couldn't encapsulate %s datagram", pkt.getName().c_str());
+                return;
+            }
+            const auto sent = ::send(mSocket, reinterpret_cast<const char *>(mTxBuffer.data()), static_cast<int>(mTxBuffer.size()), 0);
+            if (sent < 0) {
+                const int err = EVUTIL_SOCKET_ERROR();
+                if (isRetriableSocketError(err)) {
+                    LOG("udpchannel", "UDP packet dropped on send due to TxBuffer being full");
+                } else {
+                    LOG("udpchannel", "error sending datagram: %s", evutil_socket_error_to_string(err));
                 }
+            } else if (static_cast<size_t>(sent) < mTxBuffer.size()) {
+                LOG("udpchannel", "short write sending datagram - sent %d of %d bytes", static_cast<int>(sent),
+                    static_cast<int>(mTxBuffer.size()));
             }
         }
 
-        void registerDtoHandler(const std::string &dtoName, std::function<void(const unsigned char *data, size_t len)> callback);
-        void unregisterDtoHandler(const std::string &dtoName);
+        /** registerDtoHandler has handler called, with user_data, for every DTO of type id
+         * received.  It replaces any handler already registered for id.
+         */
+        void registerDtoHandler(DtoId id, DtoHandler handler, void *user_data);
+        void unregisterDtoHandler(DtoId id);
 
         void setAddress(const std::string &address);
 
+        /** setSocketBufferSizes sets the kernel's receive and send buffer sizes (SO_RCVBUF and
+         * SO_SNDBUF) for the socket, in bytes, from the next open().  0 leaves the system default.
+         */
+        void setSocketBufferSizes(int receiveBytes, int sendBytes);
+
+        /** getRxTimestampNs returns when the kernel received the datagram currently being handled,
+         * in nanoseconds of wall clock time, for measuring arrival jitter.  It's only meaningful
+         * from within a DTO handler, and is 0 where the platform doesn't provide it (anywhere but
+         * Linux).
+         */
+        int64_t getRxTimestampNs() const;
+
         int getLastErrno() const;
 
         void setChannelConfig(const dto::ChannelConfig &config) override;
+
+        /** logStatistics dumps the receive counters to the AFV log. */
+        void logStatistics();
     };
 }} // namespace afv_native::cryptodto
 
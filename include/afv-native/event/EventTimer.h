@@ -57,6 +57,12 @@ namespace afv_native { namespace event {
         bool pending();
         void enable(unsigned int delayMs);
         void disable();
+
+        /** activate fires the timer straight away, from the event loop.  It may be called from
+         * other threads if the event base was made after evthread_use_pthreads (or
+         * evthread_use_windows_threads).
+         */
+        void activate();
     };
 }} // namespace afv_native::event
 
@@ -0,0 +1,86 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+
+namespace afv_native {
+    /** JitterLatencyMode picks how the receive jitter buffers trade delay against loss. */
+    enum class JitterLatencyMode {
+        /** Balanced is the Speex jitter buffer's own tuning. */
+        Balanced,
+        /** MinimumLatency tolerates more late packets - concealed by the decoder - in return for
+         * the shortest buffering delay.  Best for quick exchanges on a good link.
+         */
+        MinimumLatency,
+        /** Robust buffers an extra 40ms and targets fewer late packets, for poor links. */
+        Robust
+    };
+
+    /** JitterStatistics describes how well one or more received voice streams are being played
+     * out.  The counters are totals since each stream started.
+     */
+    struct JitterStatistics {
+        /** streams is the number of streams the statistics were gathered from. */
+        uint32_t streams = 0;
+        uint32_t packetsReceived = 0;
+        /** packetsLate counts packets that arrived after their turn to play had passed. */
+        uint32_t packetsLate = 0;
+        /** packetsLost counts gaps in the sequence that were never filled. */
+        uint32_t packetsLost = 0;
+        /** packetQueueOverflows counts packets dropped before reaching the jitter buffer. */
+        uint32_t packetQueueOverflows = 0;
+        /** framesRecovered counts missing frames decoded from the in-band FEC data in the packet
+         * after them.  Built against libopus older than 1.5, which can't tell whether that packet
+         * had any, it also counts the frames Opus had to conceal instead.
+         */
+        uint32_t framesRecovered = 0;
+        /** framesConcealed counts frames the decoder made up in place of a missing packet, with no
+         * FEC data to go on.
+         */
+        uint32_t framesConcealed = 0;
+        /** framesInserted counts silent frames the jitter buffer added to grow its delay. */
+        uint32_t framesInserted = 0;
+        /** framesSkipped counts frames an output didn't get because another output was busy
+         * decoding, and so repeated the stream's previous frame or left it out.
+         */
+        uint32_t framesSkipped = 0;
+        /** bufferingDelayMs is the audio waiting in the jitter buffer - the longest of any
+         * stream, when gathered from several.
+         */
+        uint32_t bufferingDelayMs = 0;
+
+        JitterStatistics &operator+=(const JitterStatistics &other) {
+            streams += other.streams;
+            packetsReceived += other.packetsReceived;
+            packetsLate += other.packetsLate;
+            packetsLost += other.packetsLost;
+            packetQueueOverflows += other.packetQueueOverflows;
+            framesRecovered += other.framesRecovered;
+            framesConcealed += other.framesConcealed;
+            framesInserted += other.framesInserted;
+            framesSkipped += other.framesSkipped;
+            bufferingDelayMs = std::max(bufferingDelayMs, other.bufferingDelayMs);
+            return *this;
+        }
+    };
+
+    /** StreamPoolStatistics describes how the decoders and jitterbuffers behind the received voice
+     * streams are being recycled.  The counters are totals since the client was created.
+     */
+    struct StreamPoolStatistics {
+        /** liveStreams is the number of callsigns with a decoder right now. */
+        uint32_t liveStreams = 0;
+        /** idleDecoders is the number of decoders kept for reuse by the next new callsign. */
+        uint32_t idleDecoders = 0;
+        /** maxStreams is the cap on liveStreams, or 0 if there isn't one. */
+        uint32_t maxStreams = 0;
+        /** poolHits counts new streams that reused an idle decoder, and poolMisses those that
+         * had to create one.
+         */
+        uint32_t poolHits   = 0;
+        uint32_t poolMisses = 0;
+        /** evictions counts streams dropped early, least recently active first, to stay within
+         * maxStreams.
+         */
+        uint32_t evictions = 0;
+    };
+} // namespace afv_native
@@ -0,0 +1,315 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace afv_native { namespace util {
+    /** MsgpackReader reads msgpack values one at a time straight out of a buffer, without
+     * allocating or throwing.
+     *
+     * Each read either consumes a whole value of the expected type and returns true, or returns
+     * false.  Once a read has failed the reader's position is unspecified, so the caller should
+     * give up on the buffer.  Strings and binaries are returned as views into the buffer, and either
+     * is accepted where the other is expected, as msgpack-c's convert does.
+     */
+    class MsgpackReader {
+      public:
+        MsgpackReader(const unsigned char *buf, size_t len):
+            mPos(buf), mEnd(buf + len) {
+        }
+
+        /** position returns where the next value starts. */
+        const unsigned char *position() const {
+            return mPos;
+        }
+
+        bool atEnd() const {
+            return mPos >= mEnd;
+        }
+
+        bool readArray(uint32_t &countOut) {
+            if (mPos >= mEnd) {
+                return false;
+            }
+            const unsigned char marker = *mPos++;
+            if ((marker & 0xf0) == 0x90) {
+                countOut = marker & 0x0f;
+                return true;
+            }
+            uint64_t count = 0;
+            switch (marker) {
+                case 0xdc:
+                    if (!readBigEndian(2, count)) {
+                        return false;
+                    }
+                    break;
+                case 0xdd:
+                    if (!readBigEndian(4, count)) {
+                        return false;
+                    }
+                    break;
+                default:
+                    return false;
+            }
+            countOut = static_cast<uint32_t>(count);
+            return true;
+        }
+
+        /** readUint reads a non-negative integer of any width. */
+        bool readUint(uint64_t &valueOut) {
+            if (mPos >= mEnd) {
+                return false;
+            }
+            const unsigned char marker = *mPos++;
+            if (marker <= 0x7f) {
+                valueOut = marker;
+                return true;
+            }
+            switch (marker) {
+                case 0xcc:
+                    return readBigEndian(1, valueOut);
+                case 0xcd:
+                    return readBigEndian(2, valueOut);
+                case 0xce:
+                    return readBigEndian(4, valueOut);
+                case 0xcf:
+                    return readBigEndian(8, valueOut);
+                case 0xd0:
+                case 0xd1:
+                case 0xd2:
+                case 0xd3: {
+                    // a signed encoding is fine, so long as the value isn't negative.
+                    const size_t width = size_t(1) << (marker - 0xd0);
+                    if (!readBigEndian(width, valueOut)) {
+                        return false;
+                    }
+                    return (valueOut >> (width * 8 - 1)) == 0;
+                }
+                default:
+                    return false;
+            }
+        }
+
+        bool readBool(bool &valueOut) {
+            if (mPos >= mEnd) {
+                return false;
+            }
+            switch (*mPos++) {
+                case 0xc2:
+                    valueOut = false;
+                    return true;
+                case 0xc3:
+                    valueOut = true;
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        /** readFloat reads a float32 or float64, or an integer, as msgpack-c's convert would. */
+        bool readFloat(float &valueOut) {
+            if (mPos >= mEnd) {
+                return false;
+            }
+            const unsigned char marker = *mPos;
+            uint64_t            bits   = 0;
+            switch (marker) {
+                case 0xca: {
+                    mPos++;
+                    if (!readBigEndian(4, bits)) {
+                        return false;
+                    }
+                    const uint32_t bits32 = static_cast<uint32_t>(bits);
+                    ::memcpy(&valueOut, &bits32, sizeof(valueOut));
+                    return true;
+                }
+                case 0xcb: {
+                    mPos++;
+                    if (!readBigEndian(8, bits)) {
+                        return false;
+                    }
+                    double value;
+                    ::memcpy(&value, &bits, sizeof(value));
+                    valueOut = static_cast<float>(value);
+                    return true;
+                }
+                default:
+                    if (marker >= 0xe0) {
+                        // negative fixint.
+                        mPos++;
+                        valueOut = static_cast<float>(static_cast<int8_t>(marker));
+                        return true;
+                    }
+                    if (!readUint(bits)) {
+                        return false;
+                    }
+                    valueOut = static_cast<float>(bits);
+                    return true;
+            }
+        }
+
+        /** readStr reads a str.  Like msgpack-c's convert to std::string, it takes a bin too. */
+        bool readStr(std::string_view &strOut) {
+            const unsigned char *start  = nullptr;
+            size_t               length = 0;
+            if (!readRaw(start, length)) {
+                return false;
+            }
+            strOut = std::string_view(reinterpret_cast<const char *>(start), length);
+            return true;
+        }
+
+        /** readBin reads a bin.  Like msgpack-c's convert to std::vector<unsigned char>, it takes a
+         * str too.
+         */
+        bool readBin(const unsigned char *&dataOut, size_t &lenOut) {
+            return readRaw(dataOut, lenOut);
+        }
+
+        /** skip steps over the next value, whatever it is, nesting at most maxDepth deep. */
+        bool skip(int maxDepth = 8) {
+            if (mPos >= mEnd || maxDepth < 0) {
+                return false;
+            }
+            const unsigned char  marker = *mPos;
+            uint64_t             length = 0;
+            const unsigned char *ignored;
+            if (marker <= 0x7f || marker >= 0xe0 || marker == 0xc0 || marker == 0xc2 || marker == 0xc3) {
+                mPos++;
+                return true;
+            }
+            if ((marker & 0xe0) == 0xa0 || (marker >= 0xd9 && marker <= 0xdb) || (marker >= 0xc4 && marker <= 0xc6)) {
+                size_t rawLen = 0;
+                return readRaw(ignored, rawLen);
+            }
+            if ((marker & 0xf0) == 0x90 || marker == 0xdc || marker == 0xdd) {
+                uint32_t count = 0;
+                if (!readArray(count)) {
+                    return false;
+                }
+                for (uint32_t i = 0; i < count; i++) {
+                    if (!skip(maxDepth - 1)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            if ((marker & 0xf0) == 0x80 || marker == 0xde || marker == 0xdf) {
+                mPos++;
+                if ((marker & 0xf0) == 0x80) {
+                    length = marker & 0x0f;
+                } else if (!readBigEndian(marker == 0xde ? 2 : 4, length)) {
+                    return false;
+                }
+                for (uint64_t i = 0; i < length * 2; i++) {
+                    if (!skip(maxDepth - 1)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            mPos++;
+            switch (marker) {
+                case 0xcc:
+                case 0xd0:
+                    return take(1, ignored);
+                case 0xcd:
+                case 0xd1:
+                    return take(2, ignored);
+                case 0xca:
+                case 0xce:
+                case 0xd2:
+                    return take(4, ignored);
+                case 0xcb:
+                case 0xcf:
+                case 0xd3:
+                    return take(8, ignored);
+                case 0xd4:
+                    return take(2, ignored);
+                case 0xd5:
+                    return take(3, ignored);
+                case 0xd6:
+                    return take(5, ignored);
+                case 0xd7:
+                    return take(9, ignored);
+                case 0xd8:
+                    return take(17, ignored);
+                case 0xc7:
+                case 0xc8:
+                case 0xc9:
+                    // ext: length, then a type byte, then the data.
+                    if (!readBigEndian(size_t(1) << (marker - 0xc7), length)) {
+                        return false;
+                    }
+                    return take(length + 1, ignored);
+                default:
+                    return false;
+            }
+        }
+
+      private:
+        const unsigned char *mPos;
+        const unsigned char *mEnd;
+
+        /** readRaw reads a str or a bin, returning where its bytes start. */
+        bool readRaw(const unsigned char *&dataOut, size_t &lenOut) {
+            if (mPos >= mEnd) {
+                return false;
+            }
+            const unsigned char marker = *mPos++;
+            uint64_t            length = 0;
+            if ((marker & 0xe0) == 0xa0) {
+                length = marker & 0x1f;
+            } else {
+                // str8/16/32 are 0xd9-0xdb, and bin8/16/32 0xc4-0xc6.
+                switch (marker) {
+                    case 0xd9:
+                    case 0xc4:
+                        if (!readBigEndian(1, length)) {
+                            return false;
+                        }
+                        break;
+                    case 0xda:
+                    case 0xc5:
+                        if (!readBigEndian(2, length)) {
+                            return false;
+                        }
+                        break;
+                    case 0xdb:
+                    case 0xc6:
+                        if (!readBigEndian(4, length)) {
+                            return false;
+                        }
+                        break;
+                    default:
+                        return false;
+                }
+            }
+            lenOut = static_cast<size_t>(length);
+            return take(length, dataOut);
+        }
+
+        /** readBigEndian reads a width byte unsigned integer.  msgpack is big endian. */
+        bool readBigEndian(size_t width, uint64_t &valueOut) {
+            if (static_cast<size_t>(mEnd - mPos) < width) {
+                return false;
+            }
+            valueOut = 0;
+            for (size_t i = 0; i < width; i++) {
+                valueOut = (valueOut << 8) | *mPos++;
+            }
+            return true;
+        }
+
+        /** take consumes len bytes, returning where they start. */
+        bool take(uint64_t len, const unsigned char *&startOut) {
+            if (static_cast<uint64_t>(mEnd - mPos) < len) {
+                return false;
+            }
+            startOut = mPos;
+            mPos += len;
+            return true;
+        }
+    };
+}} // namespace afv_native::util
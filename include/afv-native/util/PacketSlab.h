@@ -0,0 +1,85 @@
+#pragma once
+#include "afv-native/util/SpscQueue.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace afv_native { namespace util {
+    /** PacketSlab recycles a fixed set of small packet buffers between one allocating thread and
+     * one releasing thread, so neither has to go to the global allocator.
+     *
+     * Every buffer carries a pointer back to the slab it came from, so release can be handed to C
+     * code that only knows the buffer - such as a Speex jitterbuffer destroy callback.  A packet
+     * too big for a block, or one allocated while every block is in use, comes from malloc
+     * instead and release frees it again.
+     *
+     * Only one thread may allocate and only one may release at a time.  Every buffer must have
+     * been released before the slab is destroyed.
+     */
+    class PacketSlab {
+      public:
+        /** blockPayloadBytes covers a 20ms Opus voice frame with room to spare - our own are
+         * around 40 bytes.
+         */
+        static const size_t blockPayloadBytes = 128;
+        static const size_t blockCount        = 128;
+
+        PacketSlab():
+            FallbackAllocations(0), mStorage(blockCount * blockStride), mFreeBlocks() {
+            for (size_t i = 0; i < blockCount; i++) {
+                auto *block  = reinterpret_cast<BlockHeader *>(mStorage.data() + i * blockStride);
+                block->owner = this;
+                mFreeBlocks.push(std::move(block));
+            }
+        }
+        PacketSlab(const PacketSlab &) = delete;
+        PacketSlab &operator=(const PacketSlab &) = delete;
+
+        /** allocate returns a buffer of at least len bytes.  Allocating thread only.
+         *
+         * @return nullptr only if the slab is exhausted and malloc fails too.
+         */
+        void *allocate(size_t len) {
+            BlockHeader *block = nullptr;
+            if (len > blockPayloadBytes || !mFreeBlocks.pop(block)) {
+                FallbackAllocations++;
+                block = static_cast<BlockHeader *>(::malloc(sizeof(BlockHeader) + len));
+                if (block == nullptr) {
+                    return nullptr;
+                }
+                block->owner = nullptr;
+            }
+            return block + 1;
+        }
+
+        /** release gives back a buffer from allocate, to whichever slab it came from.  Releasing
+         * thread only.  Does nothing with nullptr.
+         */
+        static void release(void *data) {
+            if (data == nullptr) {
+                return;
+            }
+            auto *block = static_cast<BlockHeader *>(data) - 1;
+            if (block->owner == nullptr) {
+                ::free(block);
+                return;
+            }
+            // the free list has room for every block, so this can't fail.
+            block->owner->mFreeBlocks.push(std::move(block));
+        }
+
+        /** FallbackAllocations counts the buffers that had to come from malloc. */
+        std::atomic<uint32_t> FallbackAllocations;
+
+      private:
+        struct BlockHeader {
+            PacketSlab *owner;
+        };
+        static const size_t blockStride = sizeof(BlockHeader) + blockPayloadBytes;
+
+        std::vector<unsigned char>          mStorage;
+        SpscQueue<BlockHeader *, blockCount> mFreeBlocks;
+    };
+}} // namespace afv_native::util
@@ -0,0 +1,29 @@
+#pragma once
+#include <memory>
+
+namespace afv_native { namespace util {
+    /** Semaphore is a counting semaphore over the platform's own, for waking a worker thread from
+     * a thread that must not block.
+     *
+     * post never takes a lock, so it is safe to call from an audio callback, and a post made just
+     * before the waiter goes to sleep is never lost, which a condition variable notified without
+     * its mutex can't promise.
+     */
+    class Semaphore {
+      public:
+        Semaphore();
+        ~Semaphore();
+        Semaphore(const Semaphore &) = delete;
+        Semaphore &operator=(const Semaphore &) = delete;
+
+        /** post adds one to the count, waking a waiter if there is one. */
+        void post();
+
+        /** wait blocks until the count is above zero, and then takes one from it. */
+        void wait();
+
+      private:
+        struct Impl;
+        std::unique_ptr<Impl> mImpl;
+    };
+}} // namespace afv_native::util
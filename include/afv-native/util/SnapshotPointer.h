@@ -0,0 +1,122 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace afv_native { namespace util {
+    /** SnapshotPointer publishes immutable snapshots from writer threads to a fixed set of reader
+     * threads, without a reader ever blocking, allocating or freeing.
+     *
+     * Writers must serialise among themselves.  Each publish swaps in a new snapshot; the one it
+     * replaces is retired, and freed by a later publish or reclaim once every reader has been seen
+     * outside a read since it was retired (quiescent state based reclamation).
+     *
+     * Readers are numbered from 0 to Readers-1, and bracket every use of a snapshot with beginRead
+     * and endRead under their own number.  Each number may only be used by one thread at a time,
+     * but different readers may read at once.
+     */
+    template <typename T, size_t Readers = 1>
+    class SnapshotPointer {
+      public:
+        static const size_t readerCount = Readers;
+
+        explicit SnapshotPointer(T *initial):
+            Published(0), Reclaimed(0), mRetired(), mCurrent(initial) {
+            for (size_t reader = 0; reader < Readers; reader++) {
+                mReaderActive[reader].store(false);
+                mReaderPasses[reader].store(0);
+            }
+        }
+        SnapshotPointer(const SnapshotPointer &) = delete;
+        SnapshotPointer &operator=(const SnapshotPointer &) = delete;
+
+        ~SnapshotPointer() {
+            // by now there's nobody left reading, so everything can go.
+            for (const auto &retired: mRetired) {
+                delete retired.snapshot;
+            }
+            delete mCurrent.load();
+        }
+
+        /** beginRead returns the current snapshot, which stays valid until the same reader calls
+         * endRead.  Reader side only.
+         */
+        T *beginRead(size_t reader = 0) {
+            // this must be visible before we load the snapshot - see reclaim().
+            mReaderActive[reader].store(true, std::memory_order_seq_cst);
+            return mCurrent.load(std::memory_order_seq_cst);
+        }
+
+        void endRead(size_t reader = 0) {
+            mReaderPasses[reader].fetch_add(1, std::memory_order_release);
+            mReaderActive[reader].store(false, std::memory_order_release);
+        }
+
+        /** current returns the newest snapshot.  Writer side only. */
+        T *current() const {
+            return mCurrent.load(std::memory_order_relaxed);
+        }
+
+        /** publish replaces the current snapshot with next, taking ownership of it.  Writer side only. */
+        void publish(T *next) {
+            T *previous = mCurrent.exchange(next, std::memory_order_seq_cst);
+            Published++;
+
+            // a reader that wasn't reading when we swapped the snapshot can't have the old one.
+            // Otherwise, it's done with it as soon as it finishes the read it's in.
+            Retired retired;
+            retired.snapshot = previous;
+            for (size_t reader = 0; reader < Readers; reader++) {
+                retired.readerWasActive[reader] = mReaderActive[reader].load(std::memory_order_seq_cst);
+                retired.readerPasses[reader]    = mReaderPasses[reader].load(std::memory_order_acquire);
+            }
+            mRetired.push_back(retired);
+
+            reclaim();
+        }
+
+        /** reclaim frees the retired snapshots no reader can still be using.  Writer side only. */
+        void reclaim() {
+            bool     readerActive[Readers];
+            uint64_t readerPasses[Readers];
+            for (size_t reader = 0; reader < Readers; reader++) {
+                readerActive[reader] = mReaderActive[reader].load(std::memory_order_seq_cst);
+                readerPasses[reader] = mReaderPasses[reader].load(std::memory_order_acquire);
+            }
+
+            auto firstKept = std::remove_if(mRetired.begin(), mRetired.end(), [&](const Retired &retired) {
+                for (size_t reader = 0; reader < Readers; reader++) {
+                    if (retired.readerWasActive[reader] && readerActive[reader] && readerPasses[reader] == retired.readerPasses[reader]) {
+                        return false;
+                    }
+                }
+                delete retired.snapshot;
+                Reclaimed++;
+                return true;
+            });
+            mRetired.erase(firstKept, mRetired.end());
+        }
+
+        /** Published is a monotonic counter of the snapshots published so far. */
+        std::atomic<uint32_t> Published;
+
+        /** Reclaimed is a monotonic counter of the retired snapshots freed so far. */
+        std::atomic<uint32_t> Reclaimed;
+
+      private:
+        /** Retired is a superseded snapshot, and each reader's state at the time it was superseded. */
+        struct Retired {
+            T       *snapshot;
+            bool     readerWasActive[Readers];
+            uint64_t readerPasses[Readers];
+        };
+
+        std::vector<Retired> mRetired;
+
+        std::atomic<T *>      mCurrent;
+        std::atomic<bool>     mReaderActive[Readers];
+        std::atomic<uint64_t> mReaderPasses[Readers];
+    };
+}} // namespace afv_native::util
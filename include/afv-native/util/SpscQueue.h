@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace afv_native { namespace util {
+    /** SpscQueue is a fixed-size, wait-free, single-producer single-consumer queue.
+     *
+     * One thread may call push and another may call pop, concurrently, without either ever
+     * blocking or allocating.  If more than one thread needs to push (or pop), they must serialise
+     * among themselves.
+     *
+     * @tparam T the element type.  It must be default constructible and movable.
+     * @tparam Capacity the number of elements the queue can hold.  Must be a power of two.
+     */
+    template <typename T, size_t Capacity>
+    class SpscQueue {
+        static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+      public:
+        SpscQueue():
+            mHead(0), mHeadPadding(), mTail(0) {
+        }
+        SpscQueue(const SpscQueue &) = delete;
+        SpscQueue &operator=(const SpscQueue &) = delete;
+
+        /** push adds item to the queue.  Producer side only.
+         *
+         * @return false (leaving item untouched) if the queue is full.
+         */
+        bool push(T &&item) {
+            const size_t tail = mTail.load(std::memory_order_relaxed);
+            if (tail - mHead.load(std::memory_order_acquire) >= Capacity) {
+                return false;
+            }
+            mItems[tail & (Capacity - 1)] = std::move(item);
+            mTail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /** pop removes the oldest item from the queue into itemOut.  Consumer side only.
+         *
+         * @return false if the queue is empty.
+         */
+        bool pop(T &itemOut) {
+            const size_t head = mHead.load(std::memory_order_relaxed);
+            if (head == mTail.load(std::memory_order_acquire)) {
+                return false;
+            }
+            itemOut = std::move(mItems[head & (Capacity - 1)]);
+            mHead.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /** empty is only a snapshot - the other side may change it at any time. */
+        bool empty() const {
+            return mHead.load(std::memory_order_acquire) == mTail.load(std::memory_order_acquire);
+        }
+
+        /** size is only a snapshot, as with empty. */
+        size_t size() const {
+            return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+        }
+
+      private:
+        T mItems[Capacity];
+
+        // head and tail are padded onto separate cache lines so the producer and consumer don't
+        // contend.  (Padding rather than alignas keeps the queue free of over-aligned allocation
+        // requirements when it's embedded in heap objects.)
+        std::atomic<size_t> mHead;
+        char                mHeadPadding[64 - sizeof(std::atomic<size_t>)];
+        std::atomic<size_t> mTail;
+    };
+}} // namespace afv_native::util
@@ -3,10 +3,11 @@
 
 #include <algorithm>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace afv_native { namespace util {
-    inline bool vectorContains(const std::string &key, const std::vector<std::string> &data) {
+    inline bool vectorContains(std::string_view key, const std::vector<std::string> &data) {
         return std::find(data.begin(), data.end(), key) != data.end();
     }
 
@@ -19,7 +20,7 @@ namespace afv_native { namespace util {
         return data.end();
     }
 
-    inline bool removeIfExists(const std::string key, std::vector<std::string> &data) {
+    inline bool removeIfExists(std::string_view key, std::vector<std::string> &data) {
         auto it = std::find(data.begin(), data.end(), key);
         if (it != data.end()) {
             data.erase(it);
@@ -34,10 +34,13 @@
  */
 
 #include "afv-native/afv/ATCRadioSimulation.h"
+#include "afv-native/audio/Kernels.h"
 #include "afv-native/audio/VHFFilterSource.h"
 #include "afv-native/event.h"
 #include "afv-native/util/other.h"
+#include <chrono>
 #include <cstddef>
+#include <cstring>
 #include <memory>
 
 using namespace afv_native;
@@ -52,8 +55,13 @@ const float  fxHfWhiteNoiseGain  = 0.16f;
 const double minDb               = -40.0;
 const double maxDb               = 0.0;
 
-AtcCallsignMeta::AtcCallsignMeta(): source(), transceivers() {
-    source = std::make_shared<RemoteVoiceSource>();
+AtcRadioFx::AtcRadioFx(const EffectResources &resources, HardwareType hardware):
+    Click(), Crackle(), AcBus(), VhfWhiteNoise(), HfWhiteNoise(), BlockTone(fxBlockToneFreq), simpleCompressorEffect(), vhfFilter(hardware) {
+    Click.setSample(resources.mClick, false);
+    Crackle.setSample(resources.mCrackle, true);
+    AcBus.setSample(resources.mAcBus, true);
+    VhfWhiteNoise.setSample(resources.mVhfWhiteNoise, true);
+    HfWhiteNoise.setSample(resources.mHfWhiteNoise, true);
 }
 
 AtcOutputAudioDevice::AtcOutputAudioDevice(std::weak_ptr<ATCRadioSimulation> radio, bool onHeadset):
@@ -65,8 +73,9 @@ audio::SourceStatus AtcOutputAudioDevice::getAudioFrame(audio::SampleType *buffe
 }
 
 ATCRadioSimulation::ATCRadioSimulation(struct event_base *evBase, std::shared_ptr<EffectResources> resources, cryptodto::UDPChannel *channel):
-    IncomingAudioStreams(0), mEvBase(evBase), mResources(std::move(resources)), mChannel(), mStreamMapLock(), mHeadsetIncomingStreams(), mSpeakerIncomingStreams(), mRadioStateLock(), mPtt(false), mLastFramePtt(false), mTxSequence(0), mVoiceSink(std::make_shared<VoiceCompressionSink>(*this)), mVoiceFilter(std::make_shared<audio::SpeexPreprocessor>(mVoiceSink)), mMaintenanceTimer(mEvBase, std::bind(&ATCRadioSimulation::maintainIncomingStreams, this)), mVoiceTimeoutTimer(mEvBase, std::bind(&ATCRadioSimulation::maintainVoiceTimeout, this)), mVuMeter(300 / audio::frameLengthMs) // VU is a 300ms zero to peak response...
+    IncomingAudioStreams(0), mEvBase(evBase), mResources(std::move(resources)), mChannel(), mIncomingStreams(), mRadioStateLock(), mPtt(false), mLastFramePtt(false), mTxSequence(0), mRadioState(std::make_shared<AtcRadioStateMap>()), mTxTransceivers(std::make_shared<std::vector<uint16_t>>()), mRadioFx(), mRadioActivity(), mRadioSnapshot(new RadioSnapshot()), mVoiceSink(std::make_shared<VoiceCompressionSink>()), mVoiceFilter(std::make_shared<audio::SpeexPreprocessor>(mVoiceSink)), mMaintenanceTimer(mEvBase, std::bind(&ATCRadioSimulation::maintainIncomingStreams, this)), mVoiceTimeoutTimer(mEvBase, std::bind(&ATCRadioSimulation::maintainVoiceTimeout, this)), mRxEventTimer(mEvBase, std::bind(&ATCRadioSimulation::reportRxEvents, this)), mVuMeter(300 / audio::frameLengthMs), mTransmitPipeline(std::bind(&ATCRadioSimulation::processCapturedFrame, this, std::placeholders::_1)) // VU is a 300ms zero to peak response...
 {
+    audio::kernels::selectImplementation();
     setUDPChannel(channel);
     mMaintenanceTimer.enable(maintenanceTimerIntervalMs);
     mVoiceTimeoutTimer.enable(voiceTimeoutIntervalMs);
@@ -80,33 +89,32 @@ void ATCRadioSimulation::putAudioFrame(const audio::SampleType *bufferIn) {
         mTick->tick();
     }
 
+    // the sequence ticks over with every frame, whether we're transmitting it or not.
+    const bool     ptt      = mPtt.load();
+    const uint32_t sequence = std::atomic_fetch_add<uint32_t>(&mTxSequence, 1);
+    const bool     transmit = ptt || mLastFramePtt;
+    mLastFramePtt           = ptt;
+
+    // everything else happens on the transmit pipeline's worker (see processCapturedFrame).
+    mTransmitPipeline.push(bufferIn, sequence, transmit, !ptt);
+}
+
+void ATCRadioSimulation::processCapturedFrame(const TransmitPipeline::Frame &frame) {
+    const auto preprocessStart = std::chrono::steady_clock::now();
+
     audio::SampleType samples[audio::frameSizeSamples];
-    if (static_cast<bool>(mVoiceFilter)) {
-        mVoiceFilter->transformFrame(samples, bufferIn);
+    const auto        voiceFilter = std::atomic_load(&mVoiceFilter);
+    if (voiceFilter) {
+        voiceFilter->transformFrame(samples, frame.samples);
     } else {
-        ::memcpy(samples, bufferIn, sizeof(samples));
+        ::memcpy(samples, frame.samples, sizeof(samples));
     }
 
-    float value = 0;
-    for (int i = 0; i < audio::frameSizeSamples; i++) {
-        value = samples[i] * mMicVolume;
-        if (value > 1.0f) {
-            value = 1.0f;
-        }
-        if (value < -1.0f) {
-            value = -1.0f;
-        }
-        samples[i] = value;
-    }
+    audio::kernels::gainClamp(samples, mMicVolume, audio::frameSizeSamples);
 
     // do the peak/Vu calcs
     {
-        auto             *b    = samples;
-        int               i    = audio::frameSizeSamples - 1;
-        audio::SampleType peak = fabs(*(b++));
-        while (i-- > 0) {
-            peak = std::max<audio::SampleType>(peak, fabs(*(b++)));
-        }
+        audio::SampleType peak = audio::kernels::peak(samples, audio::frameSizeSamples);
         double peakDb = 20.0 * log10(peak);
         peakDb        = std::max(minDb, peakDb);
         peakDb        = std::min(maxDb, peakDb);
@@ -120,59 +128,51 @@ void ATCRadioSimulation::putAudioFrame(const audio::SampleType *bufferIn) {
         mVuMeter.addDatum(ratio);
     }
 
-    if (!mPtt.load() && !mLastFramePtt) {
-        // Tick the sequence over when we have no Ptt as the compressed endpoint wont' get called to do that.
-        std::atomic_fetch_add<uint32_t>(&mTxSequence, 1);
+    const auto encodeStart = std::chrono::steady_clock::now();
+    mTransmitPipeline.addStageTime(TransmitPipeline::Stage::Preprocess, encodeStart - preprocessStart);
+    if (!frame.transmit) {
+        return;
+    }
+
+    if (!mVoiceSink->encode(samples, mTxEncoded)) {
         return;
     }
+    const auto sendStart = std::chrono::steady_clock::now();
+    mTransmitPipeline.addStageTime(TransmitPipeline::Stage::Encode, sendStart - encodeStart);
 
-    mVoiceSink->putAudioFrame(samples);
+    processCompressedFrame(mTxEncoded, frame.sequence, frame.lastPacket);
+    mTransmitPipeline.addStageTime(TransmitPipeline::Stage::Send, std::chrono::steady_clock::now() - sendStart);
 }
 
-void ATCRadioSimulation::processCompressedFrame(std::vector<unsigned char> compressedData) {
+void ATCRadioSimulation::processCompressedFrame(const std::vector<unsigned char> &compressedData, uint32_t sequence, bool lastPacket) {
     if (mChannel != nullptr && mChannel->isOpen()) {
-        dto::AudioTxOnTransceivers audioOutDto;
-        {
-            std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
-
-            if (!mPtt.load()) {
-                audioOutDto.LastPacket = true;
-                mLastFramePtt          = false;
-            } else {
-                audioOutDto.LastPacket = false;
-                mLastFramePtt          = true;
-            }
+        const auto txTransceivers = std::atomic_load(&mTxTransceivers);
 
-            for (auto &[_, radio]: mRadioState) {
-                if (!radio.tx) {
-                    continue;
-                }
-
-                for (const auto trans: radio.transceivers) {
-                    audioOutDto.Transceivers.emplace_back(trans.ID);
-                }
-            }
+        // everything is assigned in place, so the DTO's buffers are reused from frame to frame.
+        mTxDto.Transceivers.clear();
+        for (const auto id: *txTransceivers) {
+            mTxDto.Transceivers.emplace_back(id);
         }
-        audioOutDto.SequenceCounter = std::atomic_fetch_add<uint32_t>(&mTxSequence, 1);
-        audioOutDto.Callsign = mCallsign;
-        audioOutDto.Audio    = std::move(compressedData);
-        mChannel->sendDto(audioOutDto);
+        mTxDto.SequenceCounter = sequence;
+        mTxDto.LastPacket      = lastPacket;
+        mTxDto.Callsign        = mCallsign;
+        mTxDto.Audio.assign(compressedData.begin(), compressedData.end());
+        mChannel->sendDto(mTxDto);
     }
 }
 
 void ATCRadioSimulation::mix_buffers(audio::SampleType *RESTRICT src_dst, const audio::SampleType *RESTRICT src2, float src2_gain) {
-    for (int i = 0; i < audio::frameSizeSamples; i++) {
-        src_dst[i] += (src2_gain * src2[i]);
-    }
+    audio::kernels::mix(src_dst, src2, src2_gain, audio::frameSizeSamples);
 }
 
 bool ATCRadioSimulation::getTxActive(unsigned int radio) {
     std::lock_guard<std::mutex> mRadioStateGuard(mRadioStateLock);
-    if (!isFrequencyActive(radio)) {
+    auto                        radioIter = mRadioState->find(radio);
+    if (radioIter == mRadioState->end()) {
         return false;
     }
 
-    if (!mRadioState[radio].tx) {
+    if (!radioIter->second.tx) {
         return false;
     }
     return mPtt.load();
@@ -180,35 +180,46 @@ bool ATCRadioSimulation::getTxActive(unsigned int radio) {
 
 bool ATCRadioSimulation::getRxActive(unsigned int radio) {
     std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
-    if (!isFrequencyActive(radio)) {
+    auto                        radioIter = mRadioState->find(radio);
+    if (radioIter == mRadioState->end()) {
         return false;
     }
 
-    if (!mRadioState[radio].rx) {
+    if (!radioIter->second.rx) {
         return false;
     }
 
-    return (mRadioState[radio].mLastRxCount > 0);
+    return (mRadioFx[radio]->mLastRxCount > 0);
 }
 
 inline bool freqIsHF(unsigned int freq) {
     return freq < 30000000;
 }
 
-bool ATCRadioSimulation::_process_radio(const std::map<void *, audio::SampleType[audio::frameSizeSamples]> &sampleCache, unsigned int rxIter, bool onHeadset) {
-    if (!isFrequencyActive(rxIter)) {
-        resetRadioFx(rxIter);
+/** rendererFor returns the StreamRegistry renderer number for the headset or speaker output. */
+static inline size_t rendererFor(bool onHeadset) {
+    return onHeadset ? 0 : 1;
+}
+
+bool ATCRadioSimulation::_process_radio(const RadioSnapshot::Radio &radio, bool onHeadset) {
+    const AtcRadioState &config = *radio.state;
+    AtcRadioFx          &fx     = *radio.fx;
+
+    // if the radio has just moved outputs, the other one may still be finishing with it.
+    if (fx.mRendering.exchange(true, std::memory_order_acquire)) {
         return false;
     }
 
     bool ignoreaudio = false;
     std::shared_ptr<OutputDeviceState> state = onHeadset ? mHeadsetState : mSpeakerState;
+    StreamRegistry::StreamTable       *streams = mRenderStreams[rendererFor(onHeadset)];
+    auto                              &frames  = streams->frames[rendererFor(onHeadset)];
 
     ::memset(state->mChannelBuffer, 0, audio::frameSizeBytes);
-    if (mPtt.load() && mRadioState[rxIter].tx) {
+    if (mPtt.load() && config.tx) {
         // don't analyze and mix-in the radios transmitting, but suppress the
         // effects.
-        resetRadioFx(rxIter, true);
+        resetRadioFx(fx, true);
         ignoreaudio = true;
         // return true;
     }
@@ -218,38 +229,26 @@ bool ATCRadioSimulation::_process_radio(const std::map<void *, audio::SampleType
     float    vhfGain           = 0.0f;
     float    acBusGain         = 0.0f;
     uint32_t concurrentStreams = 0;
-    for (auto &srcPair: (onHeadset ? mHeadsetIncomingStreams : mSpeakerIncomingStreams)) {
-        if (!srcPair.second.source || !srcPair.second.source->isActive() ||
-            (sampleCache.find(srcPair.second.source.get()) == sampleCache.end())) {
-            continue;
-        }
-        bool  mUseStream = false;
-        float voiceGain  = 1.0f;
-
-        std::vector<afv::dto::RxTransceiver> matchingTransceivers;
-        std::copy_if(srcPair.second.transceivers.begin(),
-                     srcPair.second.transceivers.end(), std::back_inserter(matchingTransceivers), [&](afv::dto::RxTransceiver k) {
-                         return k.Frequency == mRadioState[rxIter].Frequency;
-                     });
-
-        if (matchingTransceivers.size() > 0) {
-            mUseStream = true;
-
-            auto closestTransceiver = *std::max_element(matchingTransceivers.begin(),
-                                                        matchingTransceivers.end(), [](afv::dto::RxTransceiver a, afv::dto::RxTransceiver b) {
-                                                            return (a.DistanceRatio < b.DistanceRatio);
-                                                        });
+    const auto *routes = streams->routes.find(config.Frequency);
+    if (routes != nullptr) {
+        for (const auto &route: *routes) {
+            const audio::SampleType *streamFrame = frames[route.slot];
+            if (streamFrame == nullptr) {
+                continue;
+            }
+            float voiceGain = 1.0f;
 
             float crackleFactor = 0.0f;
-            if (!mRadioState[rxIter].mBypassEffects) {
-                crackleFactor = static_cast<float>((exp(closestTransceiver.DistanceRatio) *
-                                                    pow(closestTransceiver.DistanceRatio, -4.0) / 350.0) -
+            if (!config.mBypassEffects) {
+                const float distanceRatio = streams->distanceRatio(route);
+                crackleFactor = static_cast<float>((exp(distanceRatio) *
+                                                    pow(distanceRatio, -4.0) / 350.0) -
                                                    0.00776652);
                 crackleFactor = fmax(0.0f, crackleFactor);
                 crackleFactor = fmin(0.20f, crackleFactor);
 
-                if (freqIsHF(rxIter)) {
-                    if (!mRadioState[rxIter].mHfSquelch) {
+                if (freqIsHF(config.Frequency)) {
+                    if (!config.mHfSquelch) {
                         hfGain = fxHfWhiteNoiseGain;
                     } else {
                         hfGain = 0.0f;
@@ -265,114 +264,64 @@ bool ATCRadioSimulation::_process_radio(const std::map<void *, audio::SampleType
                     voiceGain = 1.0 - crackleFactor * 3.7;
                 }
             }
-        }
 
-        if (mUseStream) {
             // then include this stream.
-            try {
-                if (!ignoreaudio) {
-                    mix_buffers(state->mChannelBuffer,
-                                sampleCache.at(srcPair.second.source.get()),
-                                voiceGain * mRadioState[rxIter].Gain);
-                }
-
-                concurrentStreams++;
-            } catch (const std::out_of_range &) {
-                LOG("ATCRadioSimulation", "internal error:  Tried to mix uncached stream");
+            if (!ignoreaudio) {
+                mix_buffers(state->mChannelBuffer, streamFrame, voiceGain * config.Gain);
             }
+            concurrentStreams++;
         }
     }
 
     if (concurrentStreams > 0) {
-        if (mRadioState[rxIter].mLastRxCount == 0 && !ignoreaudio) {
+        if (fx.mLastRxCount == 0 && !ignoreaudio) {
             // Post Begin Voice Receiving Notfication
-            unsigned int freq = rxIter;
-            mRadioState[rxIter].liveTransmittingCallsigns = {}; // We know for sure nobody is transmitting yet
-            ClientEventCallback->invokeAll(ClientEventType::FrequencyRxBegin, &freq, nullptr);
-            LOG("ATCRadioSimulation", "FrequencyRxBegin event: %i", freq);
+            raiseRxEvent(fx, AtcRadioFx::RxBeginPending);
         }
-        if (!mRadioState[rxIter].mBypassEffects) {
+        if (!config.mBypassEffects) {
             // limiter effect
-            for (unsigned int i = 0; i < audio::frameSizeSamples; i++) {
-                if (state->mChannelBuffer[i] > 1.0f) {
-                    state->mChannelBuffer[i] = 1.0f;
-                }
-                if (state->mChannelBuffer[i] < -1.0f) {
-                    state->mChannelBuffer[i] = -1.0f;
-                }
-            }
-
-            set_radio_effects(rxIter);
-            mRadioState[rxIter].vhfFilter->transformFrame(state->mChannelBuffer,
-                                                          state->mChannelBuffer);
-            mRadioState[rxIter].simpleCompressorEffect.transformFrame(state->mChannelBuffer,
-                                                                      state->mChannelBuffer);
-            if (!mix_effect(mRadioState[rxIter].Crackle,
-                            crackleGain * mRadioState[rxIter].Gain, state)) {
-                mRadioState[rxIter].Crackle.reset();
-            }
-            if (!mix_effect(mRadioState[rxIter].HfWhiteNoise,
-                            hfGain * mRadioState[rxIter].Gain, state)) {
-                mRadioState[rxIter].HfWhiteNoise.reset();
-            }
-            if (!mix_effect(mRadioState[rxIter].VhfWhiteNoise,
-                            vhfGain * mRadioState[rxIter].Gain, state)) {
-                mRadioState[rxIter].VhfWhiteNoise.reset();
-            }
-            if (!mix_effect(mRadioState[rxIter].AcBus,
-                            acBusGain * mRadioState[rxIter].Gain, state)) {
-                mRadioState[rxIter].AcBus.reset();
-            }
+            audio::kernels::clamp(state->mChannelBuffer, audio::frameSizeSamples);
+
+            set_radio_effects(fx);
+            fx.vhfFilter.transformFrame(state->mChannelBuffer, state->mChannelBuffer);
+            fx.simpleCompressorEffect.transformFrame(state->mChannelBuffer, state->mChannelBuffer);
+            mix_effect(fx.Crackle, crackleGain * config.Gain, state);
+            mix_effect(fx.HfWhiteNoise, hfGain * config.Gain, state);
+            mix_effect(fx.VhfWhiteNoise, vhfGain * config.Gain, state);
+            mix_effect(fx.AcBus, acBusGain * config.Gain, state);
         } // bypass effects
         if (concurrentStreams > 1) {
-            if (!mRadioState[rxIter].BlockTone) {
-                mRadioState[rxIter].BlockTone = std::make_shared<audio::SineToneSource>(fxBlockToneFreq);
-            }
-            if (!mix_effect(mRadioState[rxIter].BlockTone,
-                            fxBlockToneGain * mRadioState[rxIter].Gain, state)) {
-                mRadioState[rxIter].BlockTone.reset();
+            if (!fx.mBlockTonePlaying) {
+                fx.BlockTone.reset();
+                fx.mBlockTonePlaying = true;
             }
+            mix_effect(fx.BlockTone, fxBlockToneGain * config.Gain, state);
         } else {
-            if (mRadioState[rxIter].BlockTone) {
-                mRadioState[rxIter].BlockTone.reset();
-            }
+            fx.mBlockTonePlaying = false;
         }
     } else {
-        resetRadioFx(rxIter, true);
-        if (mRadioState[rxIter].mLastRxCount > 0) {
-            mRadioState[rxIter].Click =
-                std::make_shared<audio::RecordedSampleSource>(mResources->mClick, false);
-
-            for (const auto &c: mRadioState[rxIter].liveTransmittingCallsigns) {
-                ClientEventCallback->invokeAll(ClientEventType::StationRxEnd, &rxIter,
-                                               (void *) c.c_str());
-                LOG("ATCRadioSimulation", "StationRxEnd Forced event: %i: %s", rxIter, c.c_str());
-            }
-
-            mRadioState[rxIter].liveTransmittingCallsigns = {}; // We know for sure nobody is transmitting anymore
-            ClientEventCallback->invokeAll(ClientEventType::FrequencyRxEnd, &rxIter, nullptr);
-            mRadioState[rxIter].lastVoiceTime = 0;
-            LOG("ATCRadioSimulation", "FrequencyRxEnd event: %i", rxIter);
+        resetRadioFx(fx, true);
+        if (fx.mLastRxCount > 0) {
+            fx.Click.start();
+            raiseRxEvent(fx, AtcRadioFx::RxEndPending);
         }
     }
 
-    mRadioState[rxIter].mLastRxCount = concurrentStreams;
+    fx.mLastRxCount = concurrentStreams;
 
     // if we have a pending click, play it.
-    if (!mix_effect(mRadioState[rxIter].Click, fxClickGain * mRadioState[rxIter].Gain, state)) {
-        mRadioState[rxIter].Click.reset();
-    }
+    mix_effect(fx.Click, fxClickGain * config.Gain, state);
 
     // now, finally, mix the channel buffer into the mixing buffer.
     if (onHeadset) {
         if (!ignoreaudio) {
-            if (mRadioState[rxIter].playbackChannel == PlaybackChannel::Left ||
-                mRadioState[rxIter].playbackChannel == PlaybackChannel::Both) {
+            if (config.playbackChannel == PlaybackChannel::Left ||
+                config.playbackChannel == PlaybackChannel::Both) {
                 mix_buffers(state->mLeftMixingBuffer, state->mChannelBuffer);
             }
 
-            if (mRadioState[rxIter].playbackChannel == PlaybackChannel::Right ||
-                mRadioState[rxIter].playbackChannel == PlaybackChannel::Both) {
+            if (config.playbackChannel == PlaybackChannel::Right ||
+                config.playbackChannel == PlaybackChannel::Both) {
                 mix_buffers(state->mRightMixingBuffer, state->mChannelBuffer);
             }
         }
@@ -383,123 +332,117 @@ bool ATCRadioSimulation::_process_radio(const std::map<void *, audio::SampleType
         }
     }
 
+    fx.mRendering.store(false, std::memory_order_release);
     return false;
 }
 
 audio::SourceStatus ATCRadioSimulation::getAudioFrame(audio::SampleType *bufferOut, bool onHeadset) {
-    std::shared_ptr<OutputDeviceState> state = onHeadset ? mHeadsetState : mSpeakerState;
-
-    std::lock_guard<std::mutex> streamGuard(mStreamMapLock);
-
-    std::map<void *, audio::SampleType[audio::frameSizeSamples]> sampleCache;
-    for (auto &src: (onHeadset ? mHeadsetIncomingStreams : mSpeakerIncomingStreams)) {
-        if (src.second.source && src.second.source->isActive() &&
-            (sampleCache.find(src.second.source.get()) == sampleCache.end())) {
-            const auto rv =
-                src.second.source->getAudioFrame(sampleCache[src.second.source.get()]);
-            if (rv != audio::SourceStatus::OK) {
-                sampleCache.erase(src.second.source.get());
-            }
-        }
-    }
+    std::shared_ptr<OutputDeviceState> state    = onHeadset ? mHeadsetState : mSpeakerState;
+    const size_t                       renderer = rendererFor(onHeadset);
+
+    // Every stream has to be pulled once per tick, routed or not, so that its jitterbuffer keeps
+    // ticking.  Whichever output gets to a tick first does the decode - the other output picks the
+    // same frame up from the cache.  Neither output takes a lock to do so.
+    const uint64_t frameTick = state->advanceFrameTick(mLatestFrameTick, decodedFrameCacheDepth);
+    const auto decodeStart = std::chrono::steady_clock::now();
+    mRenderStreams[renderer] = mIncomingStreams.beginRender(renderer);
+    gatherStreamFrames(frameTick, renderer);
+    const auto radiosStart = std::chrono::steady_clock::now();
 
     ::memset(state->mLeftMixingBuffer, 0, sizeof(audio::SampleType) * audio::frameSizeSamples);
     ::memset(state->mRightMixingBuffer, 0, sizeof(audio::SampleType) * audio::frameSizeSamples);
     ::memset(state->mMixingBuffer, 0, sizeof(audio::SampleType) * audio::frameSizeSamples);
 
-    {
-        std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
-        for (auto &[freq, radio]: mRadioState) {
-            if (radio.onHeadset == onHeadset) {
-                _process_radio(sampleCache, freq, onHeadset);
-            }
+    RadioSnapshot *radioSnapshot = mRadioSnapshot.beginRead(renderer);
+    for (const auto &radio: radioSnapshot->radios) {
+        if (radio.state->onHeadset == onHeadset) {
+            _process_radio(radio, onHeadset);
         }
     }
+    mRadioSnapshot.endRead(renderer);
 
+    const auto outputStart = std::chrono::steady_clock::now();
     if (onHeadset) {
-        audio::SampleType interleavedSamples[audio::frameSizeSamples * 2];
-        interleave(state->mLeftMixingBuffer, state->mRightMixingBuffer, interleavedSamples, audio::frameSizeSamples);
-        ::memcpy(bufferOut, interleavedSamples, sizeof(audio::SampleType) * audio::frameSizeSamples * 2);
+        audio::kernels::interleave(state->mLeftMixingBuffer, state->mRightMixingBuffer, bufferOut, audio::frameSizeSamples);
     } else {
         ::memcpy(bufferOut, state->mMixingBuffer, sizeof(audio::SampleType) * audio::frameSizeSamples);
     }
 
+    mIncomingStreams.endRender(renderer);
+    mRenderStreams[renderer] = nullptr;
+
+    state->addRenderTimings(radiosStart - decodeStart, outputStart - radiosStart, std::chrono::steady_clock::now() - outputStart);
+
     return audio::SourceStatus::OK;
 }
 
-void ATCRadioSimulation::set_radio_effects(unsigned int rxIter) {
-    if (!mRadioState[rxIter].VhfWhiteNoise) {
-        mRadioState[rxIter].VhfWhiteNoise =
-            std::make_shared<audio::RecordedSampleSource>(mResources->mVhfWhiteNoise, true);
-    }
-    if (!mRadioState[rxIter].HfWhiteNoise) {
-        mRadioState[rxIter].HfWhiteNoise =
-            std::make_shared<audio::RecordedSampleSource>(mResources->mHfWhiteNoise, true);
-    }
-    if (!mRadioState[rxIter].Crackle) {
-        mRadioState[rxIter].Crackle =
-            std::make_shared<audio::RecordedSampleSource>(mResources->mCrackle, true);
-    }
-    if (!mRadioState[rxIter].AcBus) {
-        mRadioState[rxIter].AcBus =
-            std::make_shared<audio::RecordedSampleSource>(mResources->mAcBus, true);
+void ATCRadioSimulation::set_radio_effects(AtcRadioFx &fx) {
+    if (fx.mEffectsActive) {
+        return;
     }
-    if (!mRadioState[rxIter].vhfFilter) {
-        mRadioState[rxIter].vhfFilter =
-            std::make_shared<audio::VHFFilterSource>(mRadioState[rxIter].simulatedHardware);
+    fx.VhfWhiteNoise.start();
+    fx.HfWhiteNoise.start();
+    fx.Crackle.start();
+    fx.AcBus.start();
+    fx.vhfFilter.reset();
+    fx.mEffectsActive = true;
+}
+
+void ATCRadioSimulation::mix_effect(audio::EffectVoice &effect, float gain, const std::shared_ptr<OutputDeviceState> &state) {
+    if (gain > 0.0f) {
+        effect.mixFrame(state->mChannelBuffer, gain);
     }
 }
 
-bool ATCRadioSimulation::mix_effect(std::shared_ptr<audio::ISampleSource> effect, float gain, std::shared_ptr<OutputDeviceState> state) {
-    if (effect && gain > 0.0f) {
-        auto rv = effect->getAudioFrame(state->mFetchBuffer);
-        if (rv == audio::SourceStatus::OK) {
-            ATCRadioSimulation::mix_buffers(state->mChannelBuffer, state->mFetchBuffer, gain);
-        } else {
-            return false;
-        }
+void ATCRadioSimulation::mix_effect(audio::ISampleSource &effect, float gain, const std::shared_ptr<OutputDeviceState> &state) {
+    if (gain > 0.0f && effect.getAudioFrame(state->mFetchBuffer) == audio::SourceStatus::OK) {
+        ATCRadioSimulation::mix_buffers(state->mChannelBuffer, state->mFetchBuffer, gain);
     }
-    return true;
 }
 
-bool ATCRadioSimulation::_packetListening(const afv::dto::AudioRxOnTransceivers &pkt) {
+bool ATCRadioSimulation::_packetListening(const afv::dto::AudioRxOnTransceiversView &pkt) {
+    // the callsign is only copied when a transmission starts or ends, not for every packet.
+    const std::string_view      callsign = pkt.Callsign;
     std::lock_guard<std::mutex> radioStateLock(mRadioStateLock);
-    for (auto trans: pkt.Transceivers) {
-        if (!isFrequencyActive(trans.Frequency)) {
+    for (size_t i = 0; i < pkt.TransceiverCount; i++) {
+        auto trans = pkt.Transceivers[i];
+        auto radioIter = mRadioState->find(trans.Frequency);
+        if (radioIter == mRadioState->end()) {
             continue;
         }
 
-        if (!mRadioState[trans.Frequency].rx) {
+        if (!radioIter->second.rx) {
             continue;
         }
 
-        mRadioState[trans.Frequency].lastTransmitCallsign = pkt.Callsign;
-        mRadioState[trans.Frequency].lastVoiceTime        = time(0);
+        // the radio state is only republished when a different station starts transmitting.
+        if (radioIter->second.lastTransmitCallsign != callsign) {
+            auto radioState = editRadioState();
+            (*radioState)[trans.Frequency].lastTransmitCallsign = callsign;
+            publishRadioState(std::move(radioState));
+        }
+
+        auto &activity         = mRadioActivity[trans.Frequency];
+        activity.lastVoiceTime = time(0);
 
         if (pkt.LastPacket) {
-            bool hasBeenDeleted = afv_native::util::removeIfExists(
-                pkt.Callsign, mRadioState[trans.Frequency].liveTransmittingCallsigns);
+            bool hasBeenDeleted = afv_native::util::removeIfExists(callsign, activity.liveTransmittingCallsigns);
             if (hasBeenDeleted) {
-                // There is a risk that the pointer to lastTransmitCallsign might already change
-                // or be invalid by the event handler receives it, needs to be checked in real conditions
-                ClientEventCallback->invokeAll(
-                    ClientEventType::StationRxEnd, &trans.Frequency,
-                    (void *) mRadioState[trans.Frequency].lastTransmitCallsign.c_str());
+                const std::string endedCallsign(callsign);
+                ClientEventCallback->invokeAll(ClientEventType::StationRxEnd, &trans.Frequency,
+                                               (void *) endedCallsign.c_str());
                 LOG("ATCRadioSimulation", "StationRxEnd event: %i: %s", trans.Frequency,
-                    mRadioState[trans.Frequency].lastTransmitCallsign.c_str());
+                    endedCallsign.c_str());
             }
         } else {
-            if (!afv_native::util::vectorContains(pkt.Callsign,
-                                                  mRadioState[trans.Frequency].liveTransmittingCallsigns)) {
+            if (!afv_native::util::vectorContains(callsign, activity.liveTransmittingCallsigns)) {
+                const auto &startedCallsign = activity.liveTransmittingCallsigns.emplace_back(callsign);
                 LOG("ATCRadioSimulation", "StationRxBegin event: %i: %s", trans.Frequency,
-                    mRadioState[trans.Frequency].lastTransmitCallsign.c_str());
+                    startedCallsign.c_str());
 
                 // Need to emit that we have a new pilot that started transmitting
-                ClientEventCallback->invokeAll(
-                    ClientEventType::StationRxBegin, &trans.Frequency,
-                    (void *) mRadioState[trans.Frequency].lastTransmitCallsign.c_str());
-
-                mRadioState[trans.Frequency].liveTransmittingCallsigns.emplace_back(pkt.Callsign);
+                ClientEventCallback->invokeAll(ClientEventType::StationRxBegin, &trans.Frequency,
+                                               (void *) startedCallsign.c_str());
             }
         }
 
@@ -509,18 +452,21 @@ bool ATCRadioSimulation::_packetListening(const afv::dto::AudioRxOnTransceivers
     return false;
 }
 
-void ATCRadioSimulation::rxVoicePacket(const afv::dto::AudioRxOnTransceivers &pkt) {
+void ATCRadioSimulation::rxVoicePacket(const afv::dto::AudioRxOnTransceiversView &pkt) {
+    rxVoicePacket(pkt, util::monotime_get());
+}
+
+void ATCRadioSimulation::rxVoicePacket(const afv::dto::AudioRxOnTransceiversView &pkt, util::monotime_t now) {
     // FIXME:  Deal with the case of a single-callsign transmitting multiple different voicestreams simultaneously.
     if (_packetListening(pkt)) {
-        std::lock_guard<std::mutex> streamMapLock(mStreamMapLock);
-        mHeadsetIncomingStreams[pkt.Callsign].source->appendAudioDTO(pkt);
-        mHeadsetIncomingStreams[pkt.Callsign].transceivers = pkt.Transceivers;
-
-        mSpeakerIncomingStreams[pkt.Callsign].source->appendAudioDTO(pkt);
-        mSpeakerIncomingStreams[pkt.Callsign].transceivers = pkt.Transceivers;
+        mIncomingStreams.rxVoicePacket(pkt, now);
     }
 }
 
+void ATCRadioSimulation::rxVoicePacket(const afv::dto::AudioRxOnTransceivers &pkt, util::monotime_t now) {
+    rxVoicePacket(afv::dto::AudioRxOnTransceiversView(pkt), now);
+}
+
 bool ATCRadioSimulation::addFrequency(unsigned int radio, bool onHeadset, std::string stationName, HardwareType hardware, PlaybackChannel channel) {
     std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
     bool                        isUnused = isFrequencyActiveButUnused(radio);
@@ -533,37 +479,135 @@ bool ATCRadioSimulation::addFrequency(unsigned int radio, bool onHeadset, std::s
         LOG("ATCRadioSimulation", "addFrequency overriding unused: %i", radio);
     }
 
-    mRadioState[radio] = AtcRadioState();
+    auto  radioState = editRadioState();
+    auto &newRadio   = (*radioState)[radio];
+    newRadio         = AtcRadioState();
 
-    mRadioState[radio].Frequency         = radio;
-    mRadioState[radio].onHeadset         = onHeadset;
-    mRadioState[radio].playbackChannel   = channel;
-    mRadioState[radio].stationName       = stationName;
-    mRadioState[radio].simulatedHardware = hardware;
-    mRadioState[radio].mBypassEffects    = mDefaultBypassEffects;
-    mRadioState[radio].mHfSquelch        = mDefaultEnableHfSquelch;
+    newRadio.Frequency         = radio;
+    newRadio.onHeadset         = onHeadset;
+    newRadio.playbackChannel   = channel;
+    newRadio.stationName       = stationName;
+    newRadio.simulatedHardware = hardware;
+    newRadio.mBypassEffects    = mDefaultBypassEffects;
+    newRadio.mHfSquelch        = mDefaultEnableHfSquelch;
 
     if (stationName.find("_ATIS") != std::string::npos) {
-        mRadioState[radio].isATIS = true;
+        newRadio.isATIS = true;
     }
-    // reset all of the effects, except the click which should be audiable due to the Squelch-gate kicking in on the new frequency
-    resetRadioFx(radio, true);
+    // start from fresh effects.  The renderer keeps using the old ones until it picks up the new
+    // snapshot.
+    mRadioFx[radio]       = std::make_shared<AtcRadioFx>(*mResources, hardware);
+    mRadioActivity[radio] = AtcRadioActivity();
+    publishRadioState(std::move(radioState));
     LOG("ATCRadioSimulation", "addFrequency: %s: %i", stationName.c_str(), radio);
 
     return true;
 }
 
-void ATCRadioSimulation::resetRadioFx(unsigned int radio, bool except_click) {
+void ATCRadioSimulation::resetRadioFx(AtcRadioFx &fx, bool except_click) {
     if (!except_click) {
-        mRadioState[radio].Click.reset();
-        mRadioState[radio].mLastRxCount = 0;
+        fx.Click.stop();
+        fx.mLastRxCount = 0;
+    }
+    fx.mBlockTonePlaying = false;
+    fx.Crackle.stop();
+    fx.VhfWhiteNoise.stop();
+    fx.HfWhiteNoise.stop();
+    fx.AcBus.stop();
+    fx.mEffectsActive = false;
+}
+
+std::shared_ptr<AtcRadioStateMap> ATCRadioSimulation::editRadioState() {
+    return std::make_shared<AtcRadioStateMap>(*mRadioState);
+}
+
+void ATCRadioSimulation::publishRadioState(std::shared_ptr<const AtcRadioStateMap> radioState) {
+    mRadioState = std::move(radioState);
+
+    auto txTransceivers = std::make_shared<std::vector<uint16_t>>();
+    for (const auto &[_, radio]: *mRadioState) {
+        if (!radio.tx) {
+            continue;
+        }
+        for (const auto &trans: radio.transceivers) {
+            txTransceivers->push_back(trans.ID);
+        }
+    }
+    std::atomic_store(&mTxTransceivers, std::shared_ptr<const std::vector<uint16_t>>(std::move(txTransceivers)));
+
+    auto *snapshot   = new RadioSnapshot();
+    snapshot->states = mRadioState;
+    snapshot->radios.reserve(mRadioState->size());
+    for (const auto &[freq, radio]: *mRadioState) {
+        auto &fx = mRadioFx[freq];
+        if (!fx) {
+            fx = std::make_shared<AtcRadioFx>(*mResources, radio.simulatedHardware);
+        }
+        snapshot->radios.push_back({&radio, fx});
+    }
+    mRadioSnapshot.publish(snapshot);
+}
+
+void ATCRadioSimulation::raiseRxEvent(AtcRadioFx &fx, uint8_t event) {
+    uint8_t pending = fx.mRxEvents.load(std::memory_order_relaxed);
+    uint8_t raised;
+    do {
+        raised = pending | event;
+        if (event == AtcRadioFx::RxBeginPending) {
+            raised = (pending & AtcRadioFx::RxEndPending) ? (raised | AtcRadioFx::RxEndFirst) : (raised & ~AtcRadioFx::RxEndFirst);
+        } else if (pending & AtcRadioFx::RxBeginPending) {
+            raised &= ~AtcRadioFx::RxEndFirst;
+        }
+    } while (!fx.mRxEvents.compare_exchange_weak(pending, raised, std::memory_order_release, std::memory_order_relaxed));
+
+    // if anything was already pending, the event loop has been woken for it and will take this
+    // too.
+    if (pending == 0) {
+        mRxEventTimer.activate();
+    }
+}
+
+void ATCRadioSimulation::reportRxEvents() {
+    std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
+    for (const auto &[freq, fx]: mRadioFx) {
+        const uint8_t events = fx->mRxEvents.exchange(0, std::memory_order_acquire);
+        if (events != 0) {
+            flushRxEvents(freq, events);
+        }
+    }
+}
+
+void ATCRadioSimulation::flushRxEvents(unsigned int freq, uint8_t events) {
+    auto activityIter = mRadioActivity.find(freq);
+    if (activityIter == mRadioActivity.end()) {
+        return;
+    }
+    auto &activity = activityIter->second;
+
+    auto reportRxEnd = [&]() {
+        for (const auto &c: activity.liveTransmittingCallsigns) {
+            ClientEventCallback->invokeAll(ClientEventType::StationRxEnd, &freq, (void *) c.c_str());
+            LOG("ATCRadioSimulation", "StationRxEnd Forced event: %i: %s", freq, c.c_str());
+        }
+
+        activity.liveTransmittingCallsigns = {}; // We know for sure nobody is transmitting anymore
+        ClientEventCallback->invokeAll(ClientEventType::FrequencyRxEnd, &freq, nullptr);
+        activity.lastVoiceTime = 0;
+        LOG("ATCRadioSimulation", "FrequencyRxEnd event: %i", freq);
+    };
+
+    const bool rxEnd = (events & AtcRadioFx::RxEndPending) != 0;
+    if (rxEnd && (events & AtcRadioFx::RxEndFirst)) {
+        reportRxEnd();
+    }
+    if (events & AtcRadioFx::RxBeginPending) {
+        activity.liveTransmittingCallsigns = {}; // We know for sure nobody is transmitting yet
+        ClientEventCallback->invokeAll(ClientEventType::FrequencyRxBegin, &freq, nullptr);
+        LOG("ATCRadioSimulation", "FrequencyRxBegin event: %i", freq);
+    }
+    if (rxEnd && !(events & AtcRadioFx::RxEndFirst)) {
+        reportRxEnd();
     }
-    mRadioState[radio].BlockTone.reset();
-    mRadioState[radio].Crackle.reset();
-    mRadioState[radio].VhfWhiteNoise.reset();
-    mRadioState[radio].HfWhiteNoise.reset();
-    mRadioState[radio].AcBus.reset();
-    mRadioState[radio].vhfFilter.reset();
 }
 
 void ATCRadioSimulation::setPtt(bool pressed) {
@@ -572,7 +616,13 @@ void ATCRadioSimulation::setPtt(bool pressed) {
 
 void ATCRadioSimulation::setGain(unsigned int radio, float gain) {
     std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
-    mRadioState[radio].Gain = gain;
+    if (!isFrequencyActive(radio)) {
+        LOG("ATCRadioSimulation", "setGain failed, frequency inactive: %i", radio);
+        return;
+    }
+    auto radioState = editRadioState();
+    (*radioState)[radio].Gain = gain;
+    publishRadioState(std::move(radioState));
     LOG("ATCRadioSimulation", "setGain: %i: %f", radio, gain);
 }
 
@@ -580,101 +630,116 @@ void ATCRadioSimulation::setMicrophoneVolume(float volume) {
     mMicVolume = volume;
 }
 
-void ATCRadioSimulation::dtoHandler(const std::string &dtoName, const unsigned char *bufIn, size_t bufLen, void *user_data) {
+void ATCRadioSimulation::dtoHandler(const unsigned char *bufIn, size_t bufLen, void *user_data) {
     auto *thisRs = reinterpret_cast<ATCRadioSimulation *>(user_data);
-    thisRs->instDtoHandler(dtoName, bufIn, bufLen);
-}
-
-void ATCRadioSimulation::instDtoHandler(const std::string &dtoName, const unsigned char *bufIn, size_t bufLen) {
-    if (dtoName == "AR") {
-        try {
-            dto::AudioRxOnTransceivers audioIn;
-            auto unpacker = msgpack::unpack(reinterpret_cast<const char *>(bufIn), bufLen);
-            auto msgpackObj = unpacker.get();
-            msgpackObj.convert(audioIn);
-            rxVoicePacket(audioIn);
-        } catch (msgpack::type_error &e) {
-            LOG("radiosimulation", "Error unmarshalling %s packet: %s", dtoName.c_str(), e.what());
-        }
+    thisRs->instDtoHandler(bufIn, bufLen);
+}
+
+void ATCRadioSimulation::instDtoHandler(const unsigned char *bufIn, size_t bufLen) {
+    // decoded in place - the audio is only copied out once the packet is queued.
+    dto::AudioRxOnTransceiversView audioIn;
+    if (!audioIn.decode(bufIn, bufLen)) {
+        LOG("ATCRadioSimulation", "unable to unpack audio data received");
+        LOGDUMPHEX("ATCRadioSimulation", bufIn, bufLen);
+        return;
     }
+    rxVoicePacket(audioIn);
 }
 
 void ATCRadioSimulation::setUDPChannel(cryptodto::UDPChannel *newChannel) {
     if (mChannel != nullptr) {
-        mChannel->unregisterDtoHandler("AR");
+        mChannel->unregisterDtoHandler(cryptodto::DtoId::AudioRxOnTransceivers);
     }
     mChannel = newChannel;
     if (mChannel != nullptr) {
-        mChannel->registerDtoHandler("AR", [this](const unsigned char *data, size_t len) {
-            try {
-                dto::AudioRxOnTransceivers rxAudio;
-                auto objHdl = msgpack::unpack(reinterpret_cast<const char *>(data), len);
-                objHdl.get().convert(rxAudio);
-                this->rxVoicePacket(rxAudio);
-            } catch (const msgpack::type_error &e) {
-                LOG("ATCRadioSimulation", "unable to unpack audio data received: %s", e.what());
-                LOGDUMPHEX("ATCRadioSimulation", data, len);
-            }
-        });
+        mChannel->registerDtoHandler(cryptodto::DtoId::AudioRxOnTransceivers, &ATCRadioSimulation::dtoHandler, this);
     }
 }
 
 void ATCRadioSimulation::maintainVoiceTimeout() {
     std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
-    std::map<unsigned int, AtcRadioState>::iterator it;
 
-    for (it = mRadioState.begin(); it != mRadioState.end(); it++) {
-        if (it->second.lastVoiceTime == 0) {
+    for (auto &[freq, activity]: mRadioActivity) {
+        if (activity.lastVoiceTime == 0) {
             continue;
         }
-        LOG("ATCRadioSimulation", "Potential VoiceTimeout.. %i %i", it->second.lastVoiceTime,
-            time(0) - it->second.lastVoiceTime);
+        LOG("ATCRadioSimulation", "Potential VoiceTimeout.. %i %i", activity.lastVoiceTime,
+            time(0) - activity.lastVoiceTime);
 
-        if (time(0) - it->second.lastVoiceTime >= voiceTimeoutIntervalS) {
-            LOG("ATCRadioSimulation", "Found VoiceTimeout.. %i", it->second.Frequency);
+        if (time(0) - activity.lastVoiceTime >= voiceTimeoutIntervalS) {
+            unsigned int frequency = freq;
+            LOG("ATCRadioSimulation", "Found VoiceTimeout.. %i", frequency);
             // Voice channel rx has timed out.. update things.
-            it->second.lastVoiceTime = 0;
-            for (const auto &c: it->second.liveTransmittingCallsigns) {
-                ClientEventCallback->invokeAll(ClientEventType::StationRxEnd,
-                                               &it->second.Frequency, (void *) c.c_str());
-                LOG("ATCRadioSimulation", "StationRxEnd TIMEOUT event: %i: %s",
-                    it->second.Frequency, c.c_str());
+            activity.lastVoiceTime = 0;
+            for (const auto &c: activity.liveTransmittingCallsigns) {
+                ClientEventCallback->invokeAll(ClientEventType::StationRxEnd, &frequency,
+                                               (void *) c.c_str());
+                LOG("ATCRadioSimulation", "StationRxEnd TIMEOUT event: %i: %s", frequency, c.c_str());
             }
 
-            ClientEventCallback->invokeAll(ClientEventType::FrequencyRxEnd,
-                                           &it->second.Frequency, nullptr);
-            LOG("ATCRadioSimulation", "FrequencyRxEnd TIMEOUT event: %i",
-                it->second.Frequency);
+            ClientEventCallback->invokeAll(ClientEventType::FrequencyRxEnd, &frequency, nullptr);
+            LOG("ATCRadioSimulation", "FrequencyRxEnd TIMEOUT event: %i", frequency);
         }
     }
 
+    // free any radio snapshots the renderer has finished with since the radios last changed.
+    mRadioSnapshot.reclaim();
+
     mVoiceTimeoutTimer.enable(voiceTimeoutIntervalMs);
 }
 
 void ATCRadioSimulation::maintainIncomingStreams() {
-    std::lock_guard<std::mutex> ml(mStreamMapLock);
-    std::vector<std::string>    callsignsToPurge;
-    std::vector<std::string>    speakerCallsignsToPurge;
-    util::monotime_t            now = util::monotime_get();
-    for (const auto &streamPair: mHeadsetIncomingStreams) {
-        if ((now - streamPair.second.source->getLastActivityTime()) > audio::compressedSourceCacheTimeoutMs) {
-            callsignsToPurge.emplace_back(streamPair.first);
-        }
-    }
-    for (const auto &streamPair: mSpeakerIncomingStreams) {
-        if ((now - streamPair.second.source->getLastActivityTime()) > audio::compressedSourceCacheTimeoutMs) {
-            speakerCallsignsToPurge.emplace_back(streamPair.first);
-        }
-    }
-    for (const auto &callsign: callsignsToPurge) {
-        mHeadsetIncomingStreams.erase(callsign);
-    }
-    for (const auto &callsign: speakerCallsignsToPurge) {
-        mSpeakerIncomingStreams.erase(callsign);
-    }
+    mIncomingStreams.purgeInactive(util::monotime_get(), audio::compressedSourceCacheTimeoutMs);
     mMaintenanceTimer.enable(maintenanceTimerIntervalMs);
 }
 
+void ATCRadioSimulation::gatherStreamFrames(uint64_t frameTick, size_t renderer) {
+    auto &sources = mRenderStreams[renderer]->sources;
+    auto &frames  = mRenderStreams[renderer]->frames[renderer];
+    for (size_t slot = 0; slot < sources.size(); slot++) {
+        frames[slot] = sources[slot] ? sources[slot]->getCachedAudioFrame(frameTick, renderer) : nullptr;
+    }
+}
+
+void ATCRadioSimulation::logAudioStatistics() {
+    LOG("ATCRadioSimulation", "Stream Tables Published: %d, Reclaimed: %d, Packet Queue Overflows: %d",
+        mIncomingStreams.getTablesPublished(), mIncomingStreams.getTablesReclaimed(),
+        mIncomingStreams.getPacketQueueOverflows());
+    const auto pool = mIncomingStreams.getPoolStatistics();
+    LOG("ATCRadioSimulation", "Receive Streams: %u (max %u), Idle Decoders: %u, Pool Hits: %u, Misses: %u, Evictions: %u",
+        pool.liveStreams, pool.maxStreams, pool.idleDecoders, pool.poolHits, pool.poolMisses, pool.evictions);
+    mTransmitPipeline.logStatistics();
+}
+
+OutputDeviceState::RenderTimings ATCRadioSimulation::getRenderTimings(bool onHeadset) {
+    const auto &state = onHeadset ? mHeadsetState : mSpeakerState;
+    return state ? state->getRenderTimings() : OutputDeviceState::RenderTimings();
+}
+
+void ATCRadioSimulation::setJitterLatencyMode(JitterLatencyMode mode) {
+    mIncomingStreams.setLatencyMode(mode);
+}
+
+void ATCRadioSimulation::setEnableTransmitFec(bool enable, int expectedLossPercent) {
+    mVoiceSink->setInbandFec(enable, expectedLossPercent);
+}
+
+bool ATCRadioSimulation::getStreamJitterStatistics(const std::string &callsign, JitterStatistics &statsOut) {
+    return mIncomingStreams.getStreamStatistics(callsign, statsOut);
+}
+
+JitterStatistics ATCRadioSimulation::getFrequencyJitterStatistics(unsigned int frequency) {
+    return mIncomingStreams.getFrequencyStatistics(frequency);
+}
+
+void ATCRadioSimulation::setMaxReceiveStreams(unsigned int maxStreams) {
+    mIncomingStreams.setMaxStreams(maxStreams);
+}
+
+StreamPoolStatistics ATCRadioSimulation::getStreamPoolStatistics() {
+    return mIncomingStreams.getPoolStatistics();
+}
+
 void ATCRadioSimulation::setCallsign(const std::string &newCallsign) {
     mCallsign = newCallsign;
     LOG("ATCRadioSimulation", "setCallsign: %s", newCallsign.c_str());
@@ -688,19 +753,18 @@ void ATCRadioSimulation::setClientPosition(double lat, double lon, double amslm,
 }
 
 void ATCRadioSimulation::reset() {
-    {
-        std::lock_guard<std::mutex> ml(mStreamMapLock);
-        mHeadsetIncomingStreams.clear();
-        mSpeakerIncomingStreams.clear();
-    }
+    mIncomingStreams.clear();
     {
         std::lock_guard<std::mutex> ml(mRadioStateLock);
-        mRadioState.clear();
+        mRadioFx.clear();
+        mRadioActivity.clear();
+        publishRadioState(std::make_shared<AtcRadioStateMap>());
     }
     mTxSequence.store(0);
     mPtt.store(false);
     mLastFramePtt = false;
-    // reset the voice compression codec state.
+    // drop anything still waiting to be sent, then reset the voice compression codec state.
+    mTransmitPipeline.clear();
     mVoiceSink->reset();
 }
 
@@ -713,34 +777,40 @@ double ATCRadioSimulation::getPeak() const {
 }
 
 bool ATCRadioSimulation::getEnableInputFilters() const {
-    return static_cast<bool>(mVoiceFilter);
+    return static_cast<bool>(std::atomic_load(&mVoiceFilter));
 }
 
 void ATCRadioSimulation::setEnableInputFilters(bool enableInputFilters) {
+    // the transmit worker picks the filter up with atomic_load, and keeps it alive until it's
+    // done with the frame.
     if (enableInputFilters) {
-        if (!mVoiceFilter) {
-            mVoiceFilter = std::make_shared<audio::SpeexPreprocessor>(mVoiceSink);
+        if (!std::atomic_load(&mVoiceFilter)) {
+            std::atomic_store(&mVoiceFilter, std::make_shared<audio::SpeexPreprocessor>(mVoiceSink));
         }
     } else {
-        mVoiceFilter.reset();
+        std::atomic_store(&mVoiceFilter, std::shared_ptr<audio::SpeexPreprocessor>());
     }
     LOG("ATCRadioSimulation", "setEnableInputFilters: %i", enableInputFilters);
 }
 
 void ATCRadioSimulation::setEnableOutputEffects(bool enableEffects) {
     std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
-    for (auto &[_, thisRadio]: mRadioState) {
+    auto                        radioState = editRadioState();
+    for (auto &[_, thisRadio]: *radioState) {
         thisRadio.mBypassEffects = !enableEffects;
     }
+    publishRadioState(std::move(radioState));
     mDefaultBypassEffects = !enableEffects;
     LOG("ATCRadioSimulation", "setEnableOutputEffects: %i", enableEffects);
 }
 
 void ATCRadioSimulation::setEnableHfSquelch(bool enableSquelch) {
     std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
-    for (auto &[_, thisRadio]: mRadioState) {
+    auto                        radioState = editRadioState();
+    for (auto &[_, thisRadio]: *radioState) {
         thisRadio.mHfSquelch = enableSquelch;
     }
+    publishRadioState(std::move(radioState));
     mDefaultEnableHfSquelch = enableSquelch;
     LOG("ATCRadioSimulation", "setEnableHfSquelch: %i", enableSquelch);
 }
@@ -761,7 +831,9 @@ void ATCRadioSimulation::setOnHeadset(unsigned int radio, bool onHeadset) {
         LOG("ATCRadioSimulation", "setOnHeadset failed, frequency inactive: %i", radio);
         return;
     }
-    mRadioState[radio].onHeadset = onHeadset;
+    auto radioState = editRadioState();
+    (*radioState)[radio].onHeadset = onHeadset;
+    publishRadioState(std::move(radioState));
 }
 
 void afv_native::afv::ATCRadioSimulation::setRx(unsigned int freq, bool rx) {
@@ -774,16 +846,19 @@ void afv_native::afv::ATCRadioSimulation::setRx(unsigned int freq, bool rx) {
         // Emit client callback for the end of station transmission
         ClientEventCallback->invokeAll(ClientEventType::FrequencyRxEnd, &freq, nullptr);
         LOG("ATCRadioSimulation", "FrequencyRxEnd event: %i", freq);
-        for (auto callsign: mRadioState[freq].liveTransmittingCallsigns) {
+        auto &activity = mRadioActivity[freq];
+        for (auto callsign: activity.liveTransmittingCallsigns) {
             ClientEventCallback->invokeAll(ClientEventType::StationRxEnd, &freq,
                                            (void *) callsign.c_str());
             LOG("ATCRadioSimulation", "SetRx false StationRxEnd event: %i: %s", freq,
                 callsign.c_str());
         }
-        mRadioState[freq].liveTransmittingCallsigns = {};
-        mRadioState[freq].lastVoiceTime             = 0;
+        activity.liveTransmittingCallsigns = {};
+        activity.lastVoiceTime             = 0;
     }
-    mRadioState[freq].rx = rx;
+    auto radioState = editRadioState();
+    (*radioState)[freq].rx = rx;
+    publishRadioState(std::move(radioState));
     LOG("ATCRadioSimulation", "setRxRadio: %i", freq);
 }
 
@@ -793,7 +868,9 @@ void afv_native::afv::ATCRadioSimulation::setTx(unsigned int freq, bool tx) {
         LOG("ATCRadioSimulation", "setTxRadio failed, frequency inactive: %i", freq);
         return;
     }
-    mRadioState[freq].tx = tx;
+    auto radioState = editRadioState();
+    (*radioState)[freq].tx = tx;
+    publishRadioState(std::move(radioState));
     LOG("ATCRadioSimulation", "setTxRadio: %i", freq);
 };
 
@@ -803,7 +880,9 @@ void afv_native::afv::ATCRadioSimulation::setXc(unsigned int freq, bool xc) {
         LOG("ATCRadioSimulation", "setXcRadio failed, frequency inactive: %i", freq);
         return;
     }
-    mRadioState[freq].xc = xc;
+    auto radioState = editRadioState();
+    (*radioState)[freq].xc = xc;
+    publishRadioState(std::move(radioState));
     LOG("ATCRadioSimulation", "setXcRadio: %i", freq);
 };
 
@@ -813,38 +892,45 @@ void afv_native::afv::ATCRadioSimulation::setCrossCoupleAcross(unsigned int freq
         LOG("ATCRadioSimulation", "setXcRadio failed, frequency inactive: %i", freq);
         return;
     }
-    mRadioState[freq].xc                = crossCoupleAcross;
-    mRadioState[freq].crossCoupleAcross = crossCoupleAcross;
+    auto  radioState = editRadioState();
+    auto &radio      = (*radioState)[freq];
+    radio.xc                = crossCoupleAcross;
+    radio.crossCoupleAcross = crossCoupleAcross;
     if (crossCoupleAcross) {
-        mRadioState[freq].xc = false;
+        radio.xc = false;
     }
+    publishRadioState(std::move(radioState));
     LOG("ATCRadioSimulation", "setXcRadio: %i", freq);
 }
 
 bool afv_native::afv::ATCRadioSimulation::getCrossCoupleAcrossState(unsigned int freq) {
     std::lock_guard<std::mutex> lock(mRadioStateLock);
-    return mRadioState.count(freq) != 0 ? mRadioState[freq].crossCoupleAcross : false;
+    auto                        radioIter = mRadioState->find(freq);
+    return radioIter != mRadioState->end() ? radioIter->second.crossCoupleAcross : false;
 }
 
 void afv_native::afv::ATCRadioSimulation::setGainAll(float gain) {
     std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
-    for (auto &[_, radio]: mRadioState) {
+    auto                        radioState = editRadioState();
+    for (auto &[_, radio]: *radioState) {
         radio.Gain = gain;
     }
+    publishRadioState(std::move(radioState));
     LOG("ATCRadioSimulation", "setGainAll: %f", gain);
 }
 
 bool afv_native::afv::ATCRadioSimulation::isFrequencyActive(unsigned int freq) {
-    return mRadioState.count(freq) != 0;
+    return mRadioState->count(freq) != 0;
 };
 
 bool afv_native::afv::ATCRadioSimulation::isFrequencyActiveButUnused(unsigned int freq) {
-    if (!isFrequencyActive(freq)) {
+    auto radioIter = mRadioState->find(freq);
+    if (radioIter == mRadioState->end()) {
         return false;
     }
 
-    if (mRadioState[freq].tx == false && mRadioState[freq].rx == false &&
-        mRadioState[freq].xc == false) {
+    const auto &radio = radioIter->second;
+    if (radio.tx == false && radio.rx == false && radio.xc == false) {
         return true;
     }
 
@@ -861,22 +947,26 @@ void ATCRadioSimulation::setTransceivers(unsigned int freq, std::vector<afv::dto
         LOG("ATCRadioSimulation", "setTransceivers failed, frequency inactive: %i", freq);
         return;
     }
-    mRadioState[freq].transceivers.clear();
+    auto  radioState = editRadioState();
+    auto &radio      = (*radioState)[freq];
+    radio.transceivers.clear();
 
     for (auto inTrans: transceivers) {
         // Transceiver IDs all set to 0 here, they will be updated when
         // coalesced into the global transceiver package
         dto::Transceiver out(0, freq, inTrans.LatDeg, inTrans.LonDeg, inTrans.HeightMslM,
                              inTrans.HeightAglM);
-        mRadioState[freq].transceivers.emplace_back(out);
+        radio.transceivers.emplace_back(out);
     }
+    publishRadioState(std::move(radioState));
 }
 
 std::vector<afv::dto::Transceiver> ATCRadioSimulation::makeTransceiverDto() {
     std::lock_guard<std::mutex>        radioStateGuard(mRadioStateLock);
     std::vector<afv::dto::Transceiver> retSet;
-    unsigned int                       i = 0;
-    for (auto &state: mRadioState) {
+    unsigned int                       i          = 0;
+    auto                               radioState = editRadioState();
+    for (auto &state: *radioState) {
         if (!state.second.rx) {
             continue;
         }
@@ -897,15 +987,17 @@ std::vector<afv::dto::Transceiver> ATCRadioSimulation::makeTransceiverDto() {
             }
         }
     }
+    publishRadioState(std::move(radioState));
     return std::move(retSet);
 }
 
 std::vector<afv::dto::CrossCoupleGroup> ATCRadioSimulation::makeCrossCoupleGroupDto() {
     // Make one cross couple group per frequency
+    std::lock_guard<std::mutex>             radioStateGuard(mRadioStateLock);
     std::vector<afv::dto::CrossCoupleGroup> out   = {{0, {}}};
     unsigned int                            index = 1;
 
-    for (auto &[frequency, radio]: mRadioState) {
+    for (const auto &[frequency, radio]: *mRadioState) {
         if (!radio.xc && !radio.crossCoupleAcross) {
             continue;
         }
@@ -948,7 +1040,8 @@ void afv_native::afv::ATCRadioSimulation::setTick(std::shared_ptr<audio::ITick>
 
 std::string afv_native::afv::ATCRadioSimulation::getLastTransmitOnFreq(unsigned int freq) {
     std::lock_guard<std::mutex> mRadioStateGuard(mRadioStateLock);
-    return mRadioState[freq].lastTransmitCallsign;
+    auto                        radioIter = mRadioState->find(freq);
+    return radioIter != mRadioState->end() ? radioIter->second.lastTransmitCallsign : "";
 }
 
 void afv_native::afv::ATCRadioSimulation::stationTransceiverUpdateCallback(const std::string &stationName, std::map<std::string, std::vector<afv::dto::StationTransceiver>> transceivers) {
@@ -956,24 +1049,32 @@ void afv_native::afv::ATCRadioSimulation::stationTransceiverUpdateCallback(const
         return;
     }
 
-    auto it = std::find_if(mRadioState.begin(), mRadioState.end(), [&stationName](const auto &t) {
+    std::shared_ptr<const AtcRadioStateMap> radioState;
+    {
+        std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
+        radioState = mRadioState;
+    }
+    auto it = std::find_if(radioState->begin(), radioState->end(), [&stationName](const auto &t) {
         return t.second.stationName == stationName;
     });
-    if (it != mRadioState.end()) {
+    if (it != radioState->end()) {
         setTransceivers(it->second.Frequency, transceivers[stationName]);
     }
 }
 
 bool afv_native::afv::ATCRadioSimulation::getOnHeadset(unsigned int freq) {
     std::lock_guard<std::mutex> mRadioStateGuard(mRadioStateLock);
-    return mRadioState.count(freq) != 0 ? mRadioState[freq].onHeadset : true;
+    auto                        radioIter = mRadioState->find(freq);
+    return radioIter != mRadioState->end() ? radioIter->second.onHeadset : true;
 }
 
 void afv_native::afv::ATCRadioSimulation::setPlaybackChannelAll(PlaybackChannel channel) {
     std::lock_guard<std::mutex> mRadioStateGuard(mRadioStateLock);
-    for (auto radio: mRadioState) {
-        mRadioState[radio.first].playbackChannel = channel;
+    auto                        radioState = editRadioState();
+    for (auto &[_, radio]: *radioState) {
+        radio.playbackChannel = channel;
     }
+    publishRadioState(std::move(radioState));
 }
 
 void afv_native::afv::ATCRadioSimulation::setPlaybackChannel(unsigned int freq, PlaybackChannel channel) {
@@ -982,23 +1083,32 @@ void afv_native::afv::ATCRadioSimulation::setPlaybackChannel(unsigned int freq,
         LOG("ATCRadioSimulation", "setSplitAudioChannels failed, frequency inactive: %i", freq);
         return;
     }
-    mRadioState[freq].playbackChannel = channel;
+    auto radioState = editRadioState();
+    (*radioState)[freq].playbackChannel = channel;
+    publishRadioState(std::move(radioState));
 }
 
 afv_native::PlaybackChannel afv_native::afv::ATCRadioSimulation::getPlaybackChannel(unsigned int freq) {
     std::lock_guard<std::mutex> mRadioStateGuard(mRadioStateLock);
-    return mRadioState.count(freq) != 0 ? mRadioState[freq].playbackChannel : PlaybackChannel::Both;
+    auto                        radioIter = mRadioState->find(freq);
+    return radioIter != mRadioState->end() ? radioIter->second.playbackChannel : PlaybackChannel::Both;
 }
 
 bool afv_native::afv::ATCRadioSimulation::getRxState(unsigned int freq) {
-    return mRadioState.count(freq) != 0 ? mRadioState[freq].rx : false;
+    std::lock_guard<std::mutex> mRadioStateGuard(mRadioStateLock);
+    auto                        radioIter = mRadioState->find(freq);
+    return radioIter != mRadioState->end() ? radioIter->second.rx : false;
 }
 bool afv_native::afv::ATCRadioSimulation::getTxState(unsigned int freq) {
-    return mRadioState.count(freq) != 0 ? mRadioState[freq].tx : false;
+    std::lock_guard<std::mutex> mRadioStateGuard(mRadioStateLock);
+    auto                        radioIter = mRadioState->find(freq);
+    return radioIter != mRadioState->end() ? radioIter->second.tx : false;
 }
 
 bool afv_native::afv::ATCRadioSimulation::getXcState(unsigned int freq) {
-    return mRadioState.count(freq) != 0 ? mRadioState[freq].xc : false;
+    std::lock_guard<std::mutex> mRadioStateGuard(mRadioStateLock);
+    auto                        radioIter = mRadioState->find(freq);
+    return radioIter != mRadioState->end() ? radioIter->second.xc : false;
 }
 
 void afv_native::afv::ATCRadioSimulation::removeFrequency(unsigned int freq) {
@@ -1009,32 +1119,31 @@ void afv_native::afv::ATCRadioSimulation::removeFrequency(unsigned int freq) {
     }
     ClientEventCallback->invokeAll(ClientEventType::FrequencyRxEnd, &freq, nullptr);
     LOG("ATCRadioSimulation", "FrequencyRxEnd event: %i", freq);
-    for (auto callsign: mRadioState[freq].liveTransmittingCallsigns) {
+    for (auto callsign: mRadioActivity[freq].liveTransmittingCallsigns) {
         ClientEventCallback->invokeAll(ClientEventType::StationRxEnd, &freq,
                                        (void *) callsign.c_str());
         LOG("ATCRadioSimulation", "removeFrequency StationRxEnd event: %i: %s", freq,
             callsign.c_str());
     }
-    resetRadioFx(freq, false);
-    mRadioState.erase(freq);
+    // the effects go with the last snapshot that refers to them.
+    auto radioState = editRadioState();
+    radioState->erase(freq);
+    mRadioFx.erase(freq);
+    mRadioActivity.erase(freq);
+    publishRadioState(std::move(radioState));
     LOG("ATCRadioSimulation", "removeFrequency: %i", freq);
 }
 
 int afv_native::afv::ATCRadioSimulation::getTransceiverCountForFrequency(unsigned int freq) {
     std::lock_guard<std::mutex> lock(mRadioStateLock);
-    if (isFrequencyActive(freq)) {
-        return mRadioState[freq].transceivers.size();
+    auto                        radioIter = mRadioState->find(freq);
+    if (radioIter != mRadioState->end()) {
+        return radioIter->second.transceivers.size();
     }
     return 0;
 }
 
-void afv_native::afv::ATCRadioSimulation::interleave(audio::SampleType *leftChannel, audio::SampleType *rightChannel, audio::SampleType *outputBuffer, size_t numSamples) {
-    for (size_t i = 0; i < numSamples; i++) {
-        outputBuffer[2 * i] = leftChannel[i]; // Interleave left channel data
-        outputBuffer[2 * i + 1] = rightChannel[i]; // Interleave right channel data
-    }
-}
-std::map<unsigned int, AtcRadioState> afv_native::afv::ATCRadioSimulation::getRadioState() {
+std::shared_ptr<const AtcRadioStateMap> afv_native::afv::ATCRadioSimulation::getRadioState() {
     std::lock_guard<std::mutex> lock(mRadioStateLock);
     return mRadioState;
 }
@@ -0,0 +1,63 @@
+#include "afv-native/afv/FrequencyRouteIndex.h"
+
+#include <algorithm>
+
+using namespace afv_native::afv;
+
+static bool routeSlotLess(const FrequencyRouteIndex::StreamRoute &route, size_t slot) {
+    return route.slot < slot;
+}
+
+void FrequencyRouteIndex::update(size_t slot, const std::vector<dto::RxTransceiver> &previous, const std::vector<dto::RxTransceiver> &current) {
+    for (const auto &trans: previous) {
+        removeRoute(trans.Frequency, slot);
+    }
+    for (size_t ratio = 0; ratio < current.size(); ratio++) {
+        auto &routes = mRoutes[current[ratio].Frequency];
+        auto  iter   = std::lower_bound(routes.begin(), routes.end(), slot, routeSlotLess);
+        // a frequency heard on several transceivers keeps the first one's position.
+        if (iter == routes.end() || iter->slot != slot) {
+            routes.insert(iter, StreamRoute{slot, ratio});
+        }
+    }
+}
+
+void FrequencyRouteIndex::remove(size_t slot, const std::vector<dto::RxTransceiver> &transceivers) {
+    for (const auto &trans: transceivers) {
+        removeRoute(trans.Frequency, slot);
+    }
+}
+
+const std::vector<FrequencyRouteIndex::StreamRoute> *FrequencyRouteIndex::find(uint32_t frequency) const {
+    auto iter = mRoutes.find(frequency);
+    if (iter == mRoutes.end() || iter->second.empty()) {
+        return nullptr;
+    }
+    return &iter->second;
+}
+
+void FrequencyRouteIndex::compact() {
+    for (auto iter = mRoutes.begin(); iter != mRoutes.end();) {
+        if (iter->second.empty()) {
+            iter = mRoutes.erase(iter);
+        } else {
+            iter++;
+        }
+    }
+}
+
+void FrequencyRouteIndex::clear() {
+    mRoutes.clear();
+}
+
+void FrequencyRouteIndex::removeRoute(uint32_t frequency, size_t slot) {
+    auto routesIter = mRoutes.find(frequency);
+    if (routesIter == mRoutes.end()) {
+        return;
+    }
+    auto &routes = routesIter->second;
+    auto  iter   = std::lower_bound(routes.begin(), routes.end(), slot, routeSlotLess);
+    if (iter != routes.end() && iter->slot == slot) {
+        routes.erase(iter);
+    }
+}
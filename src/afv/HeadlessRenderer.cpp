@@ -0,0 +1,182 @@
+#include "afv-native/afv/HeadlessRenderer.h"
+#include "afv-native/Log.h"
+#include "afv-native/audio/WavFile.h"
+#include <chrono>
+#include <cmath>
+#include <opus/opus.h>
+
+using namespace afv_native;
+using namespace afv_native::afv;
+
+/** virtualEpochMs is where the virtual clock starts, well clear of zero so that nothing mistakes
+ * the first ticks for an unset time.
+ */
+static const util::monotime_t virtualEpochMs = 1000000;
+
+static uint64_t elapsedNs(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - since).count();
+}
+
+static OutputDeviceState::RenderTimings timingsSince(const OutputDeviceState::RenderTimings &before, const OutputDeviceState::RenderTimings &after) {
+    OutputDeviceState::RenderTimings delta;
+    delta.frames   = after.frames - before.frames;
+    delta.decodeNs = after.decodeNs - before.decodeNs;
+    delta.radiosNs = after.radiosNs - before.radiosNs;
+    delta.outputNs = after.outputNs - before.outputNs;
+    return delta;
+}
+
+HeadlessRenderer::HeadlessRenderer(std::shared_ptr<ATCRadioSimulation> simulation):
+    Events(), mDeliver(), mRender(), mRenderTimings(), mChannelCount(), mSchedule(), mTick(0), mFrame(audio::frameSizeSamples * 2), mCapture(false), mHeadsetOutput(), mSpeakerOutput() {
+    simulation->setupDevices(&Events);
+    mDeliver = [simulation](const dto::AudioRxOnTransceivers &pkt, util::monotime_t now) {
+        simulation->rxVoicePacket(pkt, now);
+    };
+    mRender = [simulation](audio::SampleType *bufferOut, bool onHeadset) {
+        simulation->getAudioFrame(bufferOut, onHeadset);
+    };
+    mRenderTimings = [simulation](bool onHeadset) {
+        return simulation->getRenderTimings(onHeadset);
+    };
+    // the ATC headset is always stereo, and the speaker always mono.
+    mChannelCount = [](bool onHeadset) {
+        return onHeadset ? 2 : 1;
+    };
+}
+
+HeadlessRenderer::HeadlessRenderer(std::shared_ptr<RadioSimulation> simulation):
+    Events(), mDeliver(), mRender(), mRenderTimings(), mChannelCount(), mSchedule(), mTick(0), mFrame(audio::frameSizeSamples * 2), mCapture(false), mHeadsetOutput(), mSpeakerOutput() {
+    simulation->setupDevices(&Events);
+    mDeliver = [simulation](const dto::AudioRxOnTransceivers &pkt, util::monotime_t now) {
+        simulation->rxVoicePacket(pkt, now);
+    };
+    mRender = [simulation](audio::SampleType *bufferOut, bool onHeadset) {
+        simulation->getAudioFrame(bufferOut, onHeadset);
+    };
+    mRenderTimings = [simulation](bool onHeadset) {
+        return simulation->getRenderTimings(onHeadset);
+    };
+    mChannelCount = [simulation](bool) {
+        return simulation->getSplitAudioChannels() ? 2 : 1;
+    };
+}
+
+void HeadlessRenderer::addPacket(uint64_t tick, const dto::AudioRxOnTransceivers &pkt) {
+    mSchedule.emplace(tick, pkt);
+}
+
+void HeadlessRenderer::addTransmission(uint64_t startTick, const std::string &callsign, const std::vector<dto::RxTransceiver> &transceivers, const std::vector<std::vector<unsigned char>> &opusFrames) {
+    for (size_t i = 0; i < opusFrames.size(); i++) {
+        dto::AudioRxOnTransceivers pkt;
+        pkt.Callsign        = callsign;
+        pkt.SequenceCounter = static_cast<uint32_t>(i);
+        pkt.Audio           = opusFrames[i];
+        pkt.LastPacket      = (i + 1) == opusFrames.size();
+        pkt.Transceivers    = transceivers;
+        addPacket(startTick + i, pkt);
+    }
+}
+
+std::vector<std::vector<unsigned char>> HeadlessRenderer::encodeTone(double frequencyHz, float amplitude, size_t frameCount) {
+    std::vector<std::vector<unsigned char>> frames;
+
+    int          opusStatus = 0;
+    OpusEncoder *encoder    = opus_encoder_create(audio::sampleRateHz, 1, OPUS_APPLICATION_VOIP, &opusStatus);
+    if (opusStatus != OPUS_OK) {
+        LOG("HeadlessRenderer", "Got error initialising Opus Codec: %s", opus_strerror(opusStatus));
+        return frames;
+    }
+    opus_encoder_ctl(encoder, OPUS_SET_BITRATE(audio::encoderBitrate));
+
+    audio::SampleType samples[audio::frameSizeSamples];
+    const double      phaseStep = 2.0 * M_PI * frequencyHz / audio::sampleRateHz;
+    uint64_t          sampleIndex = 0;
+    for (size_t frame = 0; frame < frameCount; frame++) {
+        for (size_t i = 0; i < audio::frameSizeSamples; i++, sampleIndex++) {
+            samples[i] = amplitude * static_cast<audio::SampleType>(sin(phaseStep * sampleIndex));
+        }
+        std::vector<unsigned char> encoded(audio::targetOutputFrameSizeBytes);
+        auto encodedLength = opus_encode_float(encoder, samples, audio::frameSizeSamples, encoded.data(), encoded.size());
+        if (encodedLength < 0) {
+            LOG("HeadlessRenderer", "error encoding frame: %s", opus_strerror(encodedLength));
+            break;
+        }
+        encoded.resize(encodedLength);
+        frames.push_back(std::move(encoded));
+    }
+    opus_encoder_destroy(encoder);
+    return frames;
+}
+
+void HeadlessRenderer::setCapture(bool capture) {
+    mCapture = capture;
+}
+
+const std::vector<audio::SampleType> &HeadlessRenderer::getCapturedOutput(bool onHeadset) const {
+    return onHeadset ? mHeadsetOutput : mSpeakerOutput;
+}
+
+int HeadlessRenderer::getChannelCount(bool onHeadset) const {
+    return mChannelCount(onHeadset);
+}
+
+bool HeadlessRenderer::saveWav(bool onHeadset, const std::string &fileName) const {
+    const auto &output   = getCapturedOutput(onHeadset);
+    const int   channels = getChannelCount(onHeadset);
+    return audio::SaveWav(fileName.c_str(), output.data(), output.size() / channels, channels, audio::sampleRateHz);
+}
+
+HeadlessRenderer::Stats HeadlessRenderer::run(uint64_t tickCount) {
+    Stats stats;
+
+    const auto headsetBefore = mRenderTimings(true);
+    const auto speakerBefore = mRenderTimings(false);
+
+    const auto runStart = std::chrono::steady_clock::now();
+    for (uint64_t lastTick = mTick + tickCount; mTick < lastTick; mTick++) {
+        const util::monotime_t now = virtualEpochMs + static_cast<util::monotime_t>(mTick) * audio::frameLengthMs;
+
+        const auto deliverStart = std::chrono::steady_clock::now();
+        auto       due          = mSchedule.equal_range(mTick);
+        for (auto pktIter = due.first; pktIter != due.second; ++pktIter) {
+            mDeliver(pktIter->second, now);
+            stats.packets++;
+        }
+        mSchedule.erase(due.first, due.second);
+        stats.deliverNs += elapsedNs(deliverStart);
+
+        for (bool onHeadset: {true, false}) {
+            mRender(mFrame.data(), onHeadset);
+            if (mCapture) {
+                auto &output = onHeadset ? mHeadsetOutput : mSpeakerOutput;
+                output.insert(output.end(), mFrame.begin(), mFrame.begin() + audio::frameSizeSamples * mChannelCount(onHeadset));
+            }
+        }
+        stats.ticks++;
+    }
+    const uint64_t wallNs = elapsedNs(runStart);
+
+    stats.wallSeconds = wallNs / 1e9;
+    if (wallNs > 0) {
+        stats.ticksPerSecond = stats.ticks / stats.wallSeconds;
+        stats.realtimeFactor = stats.ticksPerSecond * audio::frameLengthMs / 1000.0;
+    }
+    stats.headset = timingsSince(headsetBefore, mRenderTimings(true));
+    stats.speaker = timingsSince(speakerBefore, mRenderTimings(false));
+    return stats;
+}
+
+void HeadlessRenderer::logStats(const Stats &stats) {
+    LOG("HeadlessRenderer", "%llu ticks, %llu packets in %.3fs: %.1f ticks/s, %.1fx real time, deliver %.2fus/tick",
+        static_cast<unsigned long long>(stats.ticks), static_cast<unsigned long long>(stats.packets), stats.wallSeconds,
+        stats.ticksPerSecond, stats.realtimeFactor, stats.ticks ? stats.deliverNs / 1e3 / stats.ticks : 0.0);
+    for (bool onHeadset: {true, false}) {
+        const auto &timings = onHeadset ? stats.headset : stats.speaker;
+        if (timings.frames == 0) {
+            continue;
+        }
+        LOG("HeadlessRenderer", "%s: decode %.2fus, radios %.2fus, output %.2fus per frame", onHeadset ? "Headset" : "Speaker",
+            timings.decodeNs / 1e3 / timings.frames, timings.radiosNs / 1e3 / timings.frames,
+            timings.outputNs / 1e3 / timings.frames);
+    }
+}
@@ -35,9 +35,12 @@
 #include "afv-native/Log.h"
 #include "afv-native/afv/dto/voice_server/AudioTxOnTransceivers.h"
 #include "afv-native/audio/PinkNoiseGenerator.h"
+#include "afv-native/audio/Kernels.h"
 #include "afv-native/audio/VHFFilterSource.h"
 #include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstring>
 #include <iostream>
 
 using namespace afv_native;
@@ -52,10 +55,6 @@ const float  fxHfWhiteNoiseGain  = 0.16f;
 const double minDb               = -40.0;
 const double maxDb               = 0.0;
 
-CallsignMeta::CallsignMeta(): source(), transceivers() {
-    source = std::make_shared<RemoteVoiceSource>();
-}
-
 OutputAudioDevice::OutputAudioDevice(std::weak_ptr<RadioSimulation> radio, bool onHeadset):
     mRadio(radio), onHeadset(onHeadset) {
 }
@@ -64,9 +63,25 @@ audio::SourceStatus OutputAudioDevice::getAudioFrame(audio::SampleType *bufferOu
     return mRadio.lock()->getAudioFrame(bufferOut, onHeadset);
 }
 
+RadioState::RadioState():
+    BlockTone(fxBlockToneFreq), mLastRxCount(0), mRendering(false) {
+}
+
 RadioSimulation::RadioSimulation(struct event_base *evBase, std::shared_ptr<EffectResources> resources, cryptodto::UDPChannel *channel, unsigned int radioCount):
-    IncomingAudioStreams(0), mEvBase(evBase), mResources(std::move(resources)), mChannel(), mStreamMapLock(), mHeadsetIncomingStreams(), mSpeakerIncomingStreams(), mRadioStateLock(), mPtt(false), mLastFramePtt(false), mTxRadio(0), mTxSequence(0), mRadioState(radioCount), mVoiceSink(std::make_shared<VoiceCompressionSink>(*this)), mVoiceFilter(), mMaintenanceTimer(mEvBase, std::bind(&RadioSimulation::maintainIncomingStreams, this)), mVuMeter(300 / audio::frameLengthMs) // VU is a 300ms zero to peak response...
+    IncomingAudioStreams(0), mEvBase(evBase), mResources(std::move(resources)), mChannel(), mIncomingStreams(), mRadioStateLock(), mPtt(false), mLastFramePtt(false), mTxRadio(0), mTxSequence(0), mRadioConfig(radioCount), mRadioSnapshot(new RadioSnapshot()), mRadioState(radioCount), mVoiceSink(std::make_shared<VoiceCompressionSink>()), mVoiceFilter(), mMaintenanceTimer(mEvBase, std::bind(&RadioSimulation::maintainIncomingStreams, this)), mVuMeter(300 / audio::frameLengthMs), mTransmitPipeline(std::bind(&RadioSimulation::processCapturedFrame, this, std::placeholders::_1)) // VU is a 300ms zero to peak response...
 {
+    audio::kernels::selectImplementation();
+    for (auto &radio: mRadioState) {
+        radio.Click.setSample(mResources->mClick, false);
+        radio.Crackle.setSample(mResources->mCrackle, true);
+        radio.AcBus.setSample(mResources->mAcBus, true);
+        radio.VhfWhiteNoise.setSample(mResources->mVhfWhiteNoise, true);
+        radio.HfWhiteNoise.setSample(mResources->mHfWhiteNoise, true);
+    }
+    {
+        std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
+        publishRadioState();
+    }
     setUDPChannel(channel);
     mMaintenanceTimer.enable(maintenanceTimerIntervalMs);
 }
@@ -75,29 +90,32 @@ RadioSimulation::~RadioSimulation() {
 }
 
 void RadioSimulation::putAudioFrame(const audio::SampleType *bufferIn) {
-    audio::SampleType samples[audio::frameSizeSamples];
-    mVoiceFilter->transformFrame(samples, bufferIn);
+    // the sequence ticks over with every frame, whether we're transmitting it or not.
+    const bool     ptt      = mPtt.load();
+    const uint32_t sequence = std::atomic_fetch_add<uint32_t>(&mTxSequence, 1);
+    const bool     transmit = ptt || mLastFramePtt;
+    mLastFramePtt           = ptt;
 
-    float value = 0;
-    for (int i = 0; i < audio::frameSizeSamples; i++) {
-        value = samples[i] * mMicVolume;
-        if (value > 1.0f) {
-            value = 1.0f;
-        }
-        if (value < -1.0f) {
-            value = -1.0f;
-        }
-        samples[i] = value;
+    // everything else happens on the transmit pipeline's worker (see processCapturedFrame).
+    mTransmitPipeline.push(bufferIn, sequence, transmit, !ptt);
+}
+
+void RadioSimulation::processCapturedFrame(const TransmitPipeline::Frame &frame) {
+    const auto preprocessStart = std::chrono::steady_clock::now();
+
+    audio::SampleType samples[audio::frameSizeSamples];
+    const auto        voiceFilter = std::atomic_load(&mVoiceFilter);
+    if (voiceFilter) {
+        voiceFilter->transformFrame(samples, frame.samples);
+    } else {
+        ::memcpy(samples, frame.samples, sizeof(samples));
     }
 
+    audio::kernels::gainClamp(samples, mMicVolume, audio::frameSizeSamples);
+
     // do the peak/Vu calcs
     {
-        auto             *b    = samples;
-        int               i    = audio::frameSizeSamples - 1;
-        audio::SampleType peak = fabs(*(b++));
-        while (i-- > 0) {
-            peak = std::max<audio::SampleType>(peak, fabs(*(b++)));
-        }
+        audio::SampleType peak = audio::kernels::peak(samples, audio::frameSizeSamples);
         double peakDb = 20.0 * log10(peak);
         peakDb        = std::max(minDb, peakDb);
         peakDb        = std::min(maxDb, peakDb);
@@ -111,42 +129,37 @@ void RadioSimulation::putAudioFrame(const audio::SampleType *bufferIn) {
         mVuMeter.addDatum(ratio);
     }
 
-    if (!mPtt.load() && !mLastFramePtt) {
-        // Tick the sequence over when we have no Ptt as the compressed endpoint wont' get called to do that.
-        std::atomic_fetch_add<uint32_t>(&mTxSequence, 1);
+    const auto encodeStart = std::chrono::steady_clock::now();
+    mTransmitPipeline.addStageTime(TransmitPipeline::Stage::Preprocess, encodeStart - preprocessStart);
+    if (!frame.transmit) {
         return;
     }
 
-    mVoiceSink->putAudioFrame(samples);
+    if (!mVoiceSink->encode(samples, mTxEncoded)) {
+        return;
+    }
+    const auto sendStart = std::chrono::steady_clock::now();
+    mTransmitPipeline.addStageTime(TransmitPipeline::Stage::Encode, sendStart - encodeStart);
+
+    processCompressedFrame(mTxEncoded, frame.sequence, frame.lastPacket);
+    mTransmitPipeline.addStageTime(TransmitPipeline::Stage::Send, std::chrono::steady_clock::now() - sendStart);
 }
 
-void RadioSimulation::processCompressedFrame(std::vector<unsigned char> compressedData) {
+void RadioSimulation::processCompressedFrame(const std::vector<unsigned char> &compressedData, uint32_t sequence, bool lastPacket) {
     if (mChannel != nullptr && mChannel->isOpen()) {
-        dto::AudioTxOnTransceivers audioOutDto;
-        {
-            std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
-
-            if (!mPtt.load()) {
-                audioOutDto.LastPacket = true;
-                mLastFramePtt          = false;
-            } else {
-                audioOutDto.LastPacket = false;
-                mLastFramePtt          = true;
-            }
-
-            audioOutDto.Transceivers.emplace_back(mTxRadio);
-        }
-        audioOutDto.SequenceCounter = std::atomic_fetch_add<uint32_t>(&mTxSequence, 1);
-        audioOutDto.Callsign        = mCallsign;
-        audioOutDto.Audio           = std::move(compressedData);
-        mChannel->sendDto(audioOutDto);
+        // everything is assigned in place, so the DTO's buffers are reused from frame to frame.
+        mTxDto.Transceivers.clear();
+        mTxDto.Transceivers.emplace_back(mTxRadio.load());
+        mTxDto.SequenceCounter = sequence;
+        mTxDto.LastPacket      = lastPacket;
+        mTxDto.Callsign        = mCallsign;
+        mTxDto.Audio.assign(compressedData.begin(), compressedData.end());
+        mChannel->sendDto(mTxDto);
     }
 }
 
 void RadioSimulation::mix_buffers(audio::SampleType *RESTRICT src_dst, const audio::SampleType *RESTRICT src2, float src2_gain) {
-    for (int i = 0; i < audio::frameSizeSamples; i++) {
-        src_dst[i] += (src2_gain * src2[i]);
-    }
+    audio::kernels::mix(src_dst, src2, src2_gain, audio::frameSizeSamples);
 }
 
 bool RadioSimulation::getTxActive(unsigned int radio) {
@@ -157,23 +170,43 @@ bool RadioSimulation::getTxActive(unsigned int radio) {
 }
 
 bool RadioSimulation::getRxActive(unsigned int radio) {
-    std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
-
-    return (mRadioState[radio].mLastRxCount > 0);
+    if (radio >= mRadioState.size()) {
+        return false;
+    }
+    return (mRadioState[radio].mLastRxCount.load(std::memory_order_relaxed) > 0);
 }
 
 inline bool freqIsHF(unsigned int freq) {
     return freq < 30000000;
 }
 
-bool RadioSimulation::_process_radio(const std::map<void *, audio::SampleType[audio::frameSizeSamples]> &sampleCache, size_t rxIter, bool onHeadset) {
-    std::shared_ptr<OutputDeviceState> state = onHeadset ? mHeadsetState : mSpeakerState;
+/** rendererFor returns the StreamRegistry renderer number for the headset or speaker output. */
+static inline size_t rendererFor(bool onHeadset) {
+    return onHeadset ? 0 : 1;
+}
+
+bool RadioSimulation::_process_radio(const RadioSnapshot &radios, size_t rxIter, bool onHeadset) {
+    std::shared_ptr<OutputDeviceState> state   = onHeadset ? mHeadsetState : mSpeakerState;
+    const RadioConfig                 &config  = radios.radios[rxIter];
+    RadioState                        &fx      = mRadioState[rxIter];
+    StreamRegistry::StreamTable       *streams = mRenderStreams[rendererFor(onHeadset)];
+
+    // a radio moved between the outputs can briefly be in both snapshots - only one gets to render it.
+    if (fx.mRendering.exchange(true, std::memory_order_acquire)) {
+        return false;
+    }
+    if (fx.mRenderedFrequency != config.Frequency) {
+        // reset all of the effects, except the click which should be audiable due to the Squelch-gate kicking in on the new frequency
+        fx.mRenderedFrequency = config.Frequency;
+        resetRadioFx(fx, true);
+    }
 
     ::memset(state->mChannelBuffer, 0, audio::frameSizeBytes);
     if (mPtt.load() && mTxRadio == rxIter) {
         // don't analyze and mix-in the radios transmitting, but suppress the
         // effects.
-        resetRadioFx(rxIter);
+        resetRadioFx(fx);
+        fx.mRendering.store(false, std::memory_order_release);
         return true;
     }
     // now, find all streams that this applies to.
@@ -182,111 +215,82 @@ bool RadioSimulation::_process_radio(const std::map<void *, audio::SampleType[au
     float    vhfGain           = 0.0f;
     float    acBusGain         = 0.0f;
     uint32_t concurrentStreams = 0;
-    for (auto &srcPair: (onHeadset ? mHeadsetIncomingStreams : mSpeakerIncomingStreams)) {
-        if (!srcPair.second.source || !srcPair.second.source->isActive() ||
-            (sampleCache.find(srcPair.second.source.get()) == sampleCache.end())) {
-            continue;
-        }
-        bool  mUseStream = false;
-        float voiceGain  = 1.0f;
-        for (const afv::dto::RxTransceiver &tx: srcPair.second.transceivers) {
-            if (tx.Frequency == mRadioState[rxIter].Frequency) {
-                mUseStream = true;
-
-                float crackleFactor = 0.0f;
-                if (!mRadioState[rxIter].mBypassEffects) {
-                    crackleFactor = static_cast<float>((exp(tx.DistanceRatio) * pow(tx.DistanceRatio, -4.0) / 350.0) - 0.00776652);
-                    crackleFactor = fmax(0.0f, crackleFactor);
-                    crackleFactor = fmin(0.20f, crackleFactor);
-
-                    if (freqIsHF(tx.Frequency)) {
-                        if (!mRadioState[rxIter].mHfSquelch) {
-                            hfGain = fxHfWhiteNoiseGain;
-                        } else {
-                            hfGain = 0.0f;
-                        }
-                        vhfGain   = 0.0f;
-                        acBusGain = 0.001f;
-                        voiceGain = 0.20f;
+    const auto *routes = streams->routes.find(config.Frequency);
+    if (routes != nullptr) {
+        for (const auto &route: *routes) {
+            const audio::SampleType *streamFrame = streams->frames[rendererFor(onHeadset)][route.slot];
+            if (streamFrame == nullptr) {
+                continue;
+            }
+            float voiceGain = 1.0f;
+
+            float crackleFactor = 0.0f;
+            if (!config.mBypassEffects) {
+                const float distanceRatio = streams->distanceRatio(route);
+                crackleFactor = static_cast<float>((exp(distanceRatio) * pow(distanceRatio, -4.0) / 350.0) - 0.00776652);
+                crackleFactor = fmax(0.0f, crackleFactor);
+                crackleFactor = fmin(0.20f, crackleFactor);
+
+                if (freqIsHF(config.Frequency)) {
+                    if (!config.mHfSquelch) {
+                        hfGain = fxHfWhiteNoiseGain;
                     } else {
-                        hfGain    = 0.0f;
-                        vhfGain   = fxVhfWhiteNoiseGain;
-                        acBusGain = fxAcBusGain;
-                        crackleGain += crackleFactor * 2;
-                        voiceGain = 1.0 - crackleFactor * 3.7;
+                        hfGain = 0.0f;
                     }
+                    vhfGain   = 0.0f;
+                    acBusGain = 0.001f;
+                    voiceGain = 0.20f;
+                } else {
+                    hfGain    = 0.0f;
+                    vhfGain   = fxVhfWhiteNoiseGain;
+                    acBusGain = fxAcBusGain;
+                    crackleGain += crackleFactor * 2;
+                    voiceGain = 1.0 - crackleFactor * 3.7;
                 }
-                break; // matched once.  dont' bother anymore.
             }
-        }
-        if (mUseStream) {
+
             // then include this stream.
-            try {
-                mix_buffers(state->mChannelBuffer, sampleCache.at(srcPair.second.source.get()),
-                            voiceGain * mRadioState[rxIter].Gain);
-                concurrentStreams++;
-            } catch (const std::out_of_range &) {
-                LOG("RadioSimulation", "internal error:  Tried to mix uncached stream");
-            }
+            mix_buffers(state->mChannelBuffer, streamFrame, voiceGain * config.Gain);
+            concurrentStreams++;
         }
     }
 
     if (concurrentStreams > 0) {
-        if (!mRadioState[rxIter].mBypassEffects) {
+        if (!config.mBypassEffects) {
             // limiter effect
-            for (unsigned int i = 0; i < audio::frameSizeSamples; i++) {
-                if (state->mChannelBuffer[i] > 1.0f) {
-                    state->mChannelBuffer[i] = 1.0f;
-                }
-                if (state->mChannelBuffer[i] < -1.0f) {
-                    state->mChannelBuffer[i] = -1.0f;
-                }
-            }
+            audio::kernels::clamp(state->mChannelBuffer, audio::frameSizeSamples);
 
-            mRadioState[rxIter].vhfFilter.transformFrame(state->mChannelBuffer, state->mChannelBuffer);
-            mRadioState[rxIter].simpleCompressorEffect.transformFrame(state->mChannelBuffer, state->mChannelBuffer);
+            fx.vhfFilter.transformFrame(state->mChannelBuffer, state->mChannelBuffer);
+            fx.simpleCompressorEffect.transformFrame(state->mChannelBuffer, state->mChannelBuffer);
 
-            set_radio_effects(rxIter);
-            if (!mix_effect(mRadioState[rxIter].Crackle, crackleGain * mRadioState[rxIter].Gain, state)) {
-                mRadioState[rxIter].Crackle.reset();
-            }
-            if (!mix_effect(mRadioState[rxIter].HfWhiteNoise, hfGain * mRadioState[rxIter].Gain, state)) {
-                mRadioState[rxIter].HfWhiteNoise.reset();
-            }
-            if (!mix_effect(mRadioState[rxIter].VhfWhiteNoise, vhfGain * mRadioState[rxIter].Gain, state)) {
-                mRadioState[rxIter].VhfWhiteNoise.reset();
-            }
-            if (!mix_effect(mRadioState[rxIter].AcBus, acBusGain * mRadioState[rxIter].Gain, state)) {
-                mRadioState[rxIter].AcBus.reset();
-            }
+            set_radio_effects(fx);
+            mix_effect(fx.Crackle, crackleGain * config.Gain, state);
+            mix_effect(fx.HfWhiteNoise, hfGain * config.Gain, state);
+            mix_effect(fx.VhfWhiteNoise, vhfGain * config.Gain, state);
+            mix_effect(fx.AcBus, acBusGain * config.Gain, state);
         } // bypass effects
         if (concurrentStreams > 1) {
-            if (!mRadioState[rxIter].BlockTone) {
-                mRadioState[rxIter].BlockTone = std::make_shared<audio::SineToneSource>(fxBlockToneFreq);
-            }
-            if (!mix_effect(mRadioState[rxIter].BlockTone, fxBlockToneGain * mRadioState[rxIter].Gain, state)) {
-                mRadioState[rxIter].BlockTone.reset();
+            if (!fx.mBlockTonePlaying) {
+                fx.BlockTone.reset();
+                fx.mBlockTonePlaying = true;
             }
+            mix_effect(fx.BlockTone, fxBlockToneGain * config.Gain, state);
         } else {
-            if (mRadioState[rxIter].BlockTone) {
-                mRadioState[rxIter].BlockTone.reset();
-            }
+            fx.mBlockTonePlaying = false;
         }
     } else {
-        resetRadioFx(rxIter, true);
-        if (mRadioState[rxIter].mLastRxCount > 0) {
-            mRadioState[rxIter].Click = std::make_shared<audio::RecordedSampleSource>(mResources->mClick, false);
+        resetRadioFx(fx, true);
+        if (fx.mLastRxCount.load(std::memory_order_relaxed) > 0) {
+            fx.Click.start();
         }
     }
-    mRadioState[rxIter].mLastRxCount = concurrentStreams;
+    fx.mLastRxCount.store(static_cast<int>(concurrentStreams), std::memory_order_relaxed);
 
     // if we have a pending click, play it.
-    if (!mix_effect(mRadioState[rxIter].Click, fxClickGain * mRadioState[rxIter].Gain, state)) {
-        mRadioState[rxIter].Click.reset();
-    }
+    mix_effect(fx.Click, fxClickGain * config.Gain, state);
 
     // now, finally, mix the channel buffer into the mixing buffer.
-    if (mSplitChannels) {
+    if (radios.splitChannels) {
         if (rxIter == 0) {
             mix_buffers(state->mLeftMixingBuffer, state->mChannelBuffer);
         } else if (rxIter == 1) {
@@ -296,109 +300,119 @@ bool RadioSimulation::_process_radio(const std::map<void *, audio::SampleType[au
         mix_buffers(state->mMixingBuffer, state->mChannelBuffer);
     }
 
+    fx.mRendering.store(false, std::memory_order_release);
     return false;
 }
 
 audio::SourceStatus RadioSimulation::getAudioFrame(audio::SampleType *bufferOut, bool onHeadset) {
-    std::shared_ptr<OutputDeviceState> state = onHeadset ? mHeadsetState : mSpeakerState;
-
-    std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
-    std::lock_guard<std::mutex> streamGuard(mStreamMapLock);
-
-    std::map<void *, audio::SampleType[audio::frameSizeSamples]> sampleCache;
-    for (auto &src: (onHeadset ? mHeadsetIncomingStreams : mSpeakerIncomingStreams)) {
-        if (src.second.source && src.second.source->isActive() &&
-            (sampleCache.find(src.second.source.get()) == sampleCache.end())) {
-            const auto rv = src.second.source->getAudioFrame(sampleCache[src.second.source.get()]);
-            if (rv != audio::SourceStatus::OK) {
-                sampleCache.erase(src.second.source.get());
-            }
-        }
-    }
+    std::shared_ptr<OutputDeviceState> state    = onHeadset ? mHeadsetState : mSpeakerState;
+    const size_t                       renderer = rendererFor(onHeadset);
+
+    // Every stream has to be pulled once per tick, routed or not, so that its jitterbuffer keeps
+    // ticking.  Whichever output gets to a tick first does the decode - the other output picks the
+    // same frame up from the cache.
+    const uint64_t frameTick = state->advanceFrameTick(mLatestFrameTick, decodedFrameCacheDepth);
+    const auto decodeStart = std::chrono::steady_clock::now();
+    mRenderStreams[renderer] = mIncomingStreams.beginRender(renderer);
+    gatherStreamFrames(frameTick, renderer);
+    const auto radiosStart = std::chrono::steady_clock::now();
 
     ::memset(state->mLeftMixingBuffer, 0, sizeof(audio::SampleType) * audio::frameSizeSamples);
     ::memset(state->mRightMixingBuffer, 0, sizeof(audio::SampleType) * audio::frameSizeSamples);
     ::memset(state->mMixingBuffer, 0, sizeof(audio::SampleType) * audio::frameSizeSamples);
 
-    size_t rxIter = 0;
-    for (rxIter = 0; rxIter < mRadioState.size(); rxIter++) {
-        if (mRadioState[rxIter].onHeadset == onHeadset) {
-            _process_radio(sampleCache, rxIter, onHeadset);
+    const RadioSnapshot *radios = mRadioSnapshot.beginRead(renderer);
+    for (size_t rxIter = 0; rxIter < radios->radios.size(); rxIter++) {
+        if (radios->radios[rxIter].onHeadset == onHeadset) {
+            _process_radio(*radios, rxIter, onHeadset);
         }
     }
+    const bool splitChannels = radios->splitChannels;
+    mRadioSnapshot.endRead(renderer);
 
-    if (mSplitChannels) {
-        audio::SampleType interleavedSamples[audio::frameSizeSamples * 2];
-        interleave(state->mLeftMixingBuffer, state->mRightMixingBuffer, interleavedSamples, audio::frameSizeSamples);
-        ::memcpy(bufferOut, interleavedSamples, sizeof(audio::SampleType) * audio::frameSizeSamples * 2);
+    const auto outputStart = std::chrono::steady_clock::now();
+    if (splitChannels) {
+        audio::kernels::interleave(state->mLeftMixingBuffer, state->mRightMixingBuffer, bufferOut, audio::frameSizeSamples);
     } else {
         ::memcpy(bufferOut, state->mMixingBuffer, sizeof(audio::SampleType) * audio::frameSizeSamples);
     }
 
+    mIncomingStreams.endRender(renderer);
+    mRenderStreams[renderer] = nullptr;
+
+    state->addRenderTimings(radiosStart - decodeStart, outputStart - radiosStart, std::chrono::steady_clock::now() - outputStart);
+
     return audio::SourceStatus::OK;
 }
 
-void RadioSimulation::set_radio_effects(size_t rxIter) {
-    if (!mRadioState[rxIter].VhfWhiteNoise) {
-        mRadioState[rxIter].VhfWhiteNoise = std::make_shared<audio::RecordedSampleSource>(mResources->mVhfWhiteNoise, true);
-    }
-    if (!mRadioState[rxIter].HfWhiteNoise) {
-        mRadioState[rxIter].HfWhiteNoise = std::make_shared<audio::RecordedSampleSource>(mResources->mHfWhiteNoise, true);
-    }
-    if (!mRadioState[rxIter].Crackle) {
-        mRadioState[rxIter].Crackle = std::make_shared<audio::RecordedSampleSource>(mResources->mCrackle, true);
+void RadioSimulation::set_radio_effects(RadioState &fx) {
+    if (fx.mEffectsActive) {
+        return;
     }
-    if (!mRadioState[rxIter].AcBus) {
-        mRadioState[rxIter].AcBus = std::make_shared<audio::RecordedSampleSource>(mResources->mAcBus, true);
+    fx.VhfWhiteNoise.start();
+    fx.HfWhiteNoise.start();
+    fx.Crackle.start();
+    fx.AcBus.start();
+    fx.mEffectsActive = true;
+}
+
+void RadioSimulation::mix_effect(audio::EffectVoice &effect, float gain, const std::shared_ptr<OutputDeviceState> &state) {
+    if (gain > 0.0f) {
+        effect.mixFrame(state->mChannelBuffer, gain);
     }
 }
 
-bool RadioSimulation::mix_effect(std::shared_ptr<audio::ISampleSource> effect, float gain, std::shared_ptr<OutputDeviceState> state) {
-    if (effect && gain > 0.0f) {
-        auto rv = effect->getAudioFrame(state->mFetchBuffer);
-        if (rv == audio::SourceStatus::OK) {
-            RadioSimulation::mix_buffers(state->mChannelBuffer, state->mFetchBuffer, gain);
-        } else {
-            return false;
-        }
+void RadioSimulation::mix_effect(audio::ISampleSource &effect, float gain, const std::shared_ptr<OutputDeviceState> &state) {
+    if (gain > 0.0f && effect.getAudioFrame(state->mFetchBuffer) == audio::SourceStatus::OK) {
+        RadioSimulation::mix_buffers(state->mChannelBuffer, state->mFetchBuffer, gain);
     }
-    return true;
 }
 
-void RadioSimulation::rxVoicePacket(const afv::dto::AudioRxOnTransceivers &pkt) {
-    std::lock_guard<std::mutex> streamMapLock(mStreamMapLock);
+void RadioSimulation::rxVoicePacket(const afv::dto::AudioRxOnTransceiversView &pkt) {
+    rxVoicePacket(pkt, util::monotime_get());
+}
+
+void RadioSimulation::rxVoicePacket(const afv::dto::AudioRxOnTransceiversView &pkt, util::monotime_t now) {
     // FIXME:  Deal with the case of a single-callsign transmitting multiple different voicestreams simultaneously.
-    mHeadsetIncomingStreams[pkt.Callsign].source->appendAudioDTO(pkt);
-    mHeadsetIncomingStreams[pkt.Callsign].transceivers = pkt.Transceivers;
+    mIncomingStreams.rxVoicePacket(pkt, now);
+}
 
-    mSpeakerIncomingStreams[pkt.Callsign].source->appendAudioDTO(pkt);
-    mSpeakerIncomingStreams[pkt.Callsign].transceivers = pkt.Transceivers;
+void RadioSimulation::rxVoicePacket(const afv::dto::AudioRxOnTransceivers &pkt, util::monotime_t now) {
+    rxVoicePacket(afv::dto::AudioRxOnTransceiversView(pkt), now);
 }
 
 void RadioSimulation::setFrequency(unsigned int radio, unsigned int frequency) {
     std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
-    if (radio >= mRadioState.size()) {
+    if (radio >= mRadioConfig.size()) {
         return;
     }
-    if (mRadioState[radio].Frequency == frequency) {
+    if (mRadioConfig[radio].Frequency == frequency) {
         return;
     }
-    mRadioState[radio].Frequency = frequency;
-    // reset all of the effects, except the click which should be audiable due to the Squelch-gate kicking in on the new frequency
-    resetRadioFx(radio, true);
+    mRadioConfig[radio].Frequency = frequency;
+    // the renderer resets the radio's effects when it sees the new frequency.
+    publishRadioState();
     LOG("RadioSimulation", "setFrequency: %i: %i", radio, frequency);
 }
 
-void RadioSimulation::resetRadioFx(unsigned int radio, bool except_click) {
+void RadioSimulation::resetRadioFx(RadioState &fx, bool except_click) {
     if (!except_click) {
-        mRadioState[radio].Click.reset();
-        mRadioState[radio].mLastRxCount = 0;
+        fx.Click.stop();
+        fx.mLastRxCount.store(0, std::memory_order_relaxed);
     }
-    mRadioState[radio].BlockTone.reset();
-    mRadioState[radio].Crackle.reset();
-    mRadioState[radio].VhfWhiteNoise.reset();
-    mRadioState[radio].HfWhiteNoise.reset();
-    mRadioState[radio].AcBus.reset();
+    fx.mBlockTonePlaying = false;
+    fx.Crackle.stop();
+    fx.VhfWhiteNoise.stop();
+    fx.HfWhiteNoise.stop();
+    fx.AcBus.stop();
+    fx.mEffectsActive = false;
+}
+
+void RadioSimulation::publishRadioState() {
+    auto *snapshot          = new RadioSnapshot();
+    snapshot->radios        = mRadioConfig;
+    snapshot->splitChannels = mSplitChannels;
+    mRadioSnapshot.publish(snapshot);
 }
 
 void RadioSimulation::setPtt(bool pressed) {
@@ -407,13 +421,16 @@ void RadioSimulation::setPtt(bool pressed) {
 
 void RadioSimulation::setGain(unsigned int radio, float gain) {
     std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
-    mRadioState[radio].Gain = gain;
+    if (radio >= mRadioConfig.size()) {
+        return;
+    }
+    mRadioConfig[radio].Gain = gain;
+    publishRadioState();
     LOG("RadioSimulation", "setGain: %i: %f", radio, gain);
 }
 
 void RadioSimulation::setTxRadio(unsigned int radio) {
-    std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
-    if (radio >= mRadioState.size()) {
+    if (radio >= mRadioConfig.size()) {
         return;
     }
     mTxRadio = radio;
@@ -424,83 +441,61 @@ void RadioSimulation::setMicrophoneVolume(float volume) {
     mMicVolume = volume;
 }
 
-void RadioSimulation::dtoHandler(const std::string &dtoName, const unsigned char *bufIn, size_t bufLen, void *user_data) {
+void RadioSimulation::dtoHandler(const unsigned char *bufIn, size_t bufLen, void *user_data) {
     auto *thisRs = reinterpret_cast<RadioSimulation *>(user_data);
-    thisRs->instDtoHandler(dtoName, bufIn, bufLen);
-}
-
-void RadioSimulation::instDtoHandler(const std::string &dtoName, const unsigned char *bufIn, size_t bufLen) {
-    if (dtoName == "AR") {
-        try {
-            dto::AudioRxOnTransceivers audioIn;
-            auto unpacker   = msgpack::unpack(reinterpret_cast<const char *>(bufIn), bufLen);
-            auto msgpackObj = unpacker.get();
-            msgpackObj.convert(audioIn);
-            rxVoicePacket(audioIn);
-        } catch (msgpack::type_error &e) {
-            LOG("radiosimulation", "Error unmarshalling %s packet: %s", dtoName.c_str(), e.what());
-        }
+    thisRs->instDtoHandler(bufIn, bufLen);
+}
+
+void RadioSimulation::instDtoHandler(const unsigned char *bufIn, size_t bufLen) {
+    // decoded in place - the audio is only copied out once the packet is queued.
+    dto::AudioRxOnTransceiversView audioIn;
+    if (!audioIn.decode(bufIn, bufLen)) {
+        LOG("radiosimulation", "unable to unpack audio data received");
+        LOGDUMPHEX("radiosimulation", bufIn, bufLen);
+        return;
     }
+    rxVoicePacket(audioIn);
 }
 
 void RadioSimulation::setUDPChannel(cryptodto::UDPChannel *newChannel) {
     if (mChannel != nullptr) {
-        mChannel->unregisterDtoHandler("AR");
+        mChannel->unregisterDtoHandler(cryptodto::DtoId::AudioRxOnTransceivers);
     }
     mChannel = newChannel;
     if (mChannel != nullptr) {
-        mChannel->registerDtoHandler("AR", [this](const unsigned char *data, size_t len) {
-            try {
-                dto::AudioRxOnTransceivers rxAudio;
-                auto objHdl = msgpack::unpack(reinterpret_cast<const char *>(data), len);
-                objHdl.get().convert(rxAudio);
-                this->rxVoicePacket(rxAudio);
-            } catch (const msgpack::type_error &e) {
-                LOG("radiosimulation", "unable to unpack audio data received: %s", e.what());
-                LOGDUMPHEX("radiosimulation", data, len);
-            }
-        });
+        mChannel->registerDtoHandler(cryptodto::DtoId::AudioRxOnTransceivers, &RadioSimulation::dtoHandler, this);
     }
 }
 
 void RadioSimulation::maintainIncomingStreams() {
-    std::lock_guard<std::mutex> ml(mStreamMapLock);
-    std::vector<std::string>    callsignsToPurge;
-    std::vector<std::string>    speakerCallsignsToPurge;
-    util::monotime_t            now = util::monotime_get();
-    for (const auto &streamPair: mHeadsetIncomingStreams) {
-        if ((now - streamPair.second.source->getLastActivityTime()) > audio::compressedSourceCacheTimeoutMs) {
-            callsignsToPurge.emplace_back(streamPair.first);
-        }
-    }
-    for (const auto &streamPair: mSpeakerIncomingStreams) {
-        if ((now - streamPair.second.source->getLastActivityTime()) > audio::compressedSourceCacheTimeoutMs) {
-            speakerCallsignsToPurge.emplace_back(streamPair.first);
-        }
-    }
-    for (const auto &callsign: callsignsToPurge) {
-        mHeadsetIncomingStreams.erase(callsign);
-    }
-    for (const auto &callsign: speakerCallsignsToPurge) {
-        mSpeakerIncomingStreams.erase(callsign);
+    mIncomingStreams.purgeInactive(util::monotime_get(), audio::compressedSourceCacheTimeoutMs);
+    {
+        // free any radio snapshots the renderer has finished with since the radios last changed.
+        std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
+        mRadioSnapshot.reclaim();
     }
     mMaintenanceTimer.enable(maintenanceTimerIntervalMs);
 }
 
+void RadioSimulation::gatherStreamFrames(uint64_t frameTick, size_t renderer) {
+    auto &sources = mRenderStreams[renderer]->sources;
+    auto &frames  = mRenderStreams[renderer]->frames[renderer];
+    for (size_t slot = 0; slot < sources.size(); slot++) {
+        frames[slot] = sources[slot] ? sources[slot]->getCachedAudioFrame(frameTick, renderer) : nullptr;
+    }
+}
+
 void RadioSimulation::setCallsign(const std::string &newCallsign) {
     mCallsign = newCallsign;
 }
 
 void RadioSimulation::reset() {
-    {
-        std::lock_guard<std::mutex> ml(mStreamMapLock);
-        mHeadsetIncomingStreams.clear();
-        mSpeakerIncomingStreams.clear();
-    }
+    mIncomingStreams.clear();
     mTxSequence.store(0);
     mPtt.store(false);
     mLastFramePtt = false;
-    // reset the voice compression codec state.
+    // drop anything still waiting to be sent, then reset the voice compression codec state.
+    mTransmitPipeline.clear();
     mVoiceSink->reset();
 }
 
@@ -513,31 +508,35 @@ double RadioSimulation::getPeak() const {
 }
 
 bool RadioSimulation::getEnableInputFilters() const {
-    return static_cast<bool>(mVoiceFilter);
+    return static_cast<bool>(std::atomic_load(&mVoiceFilter));
 }
 
 void RadioSimulation::setEnableInputFilters(bool enableInputFilters) {
+    // the transmit worker picks the filter up with atomic_load, and keeps it alive until it's
+    // done with the frame.
     if (enableInputFilters) {
-        if (!mVoiceFilter) {
-            mVoiceFilter = std::make_shared<audio::SpeexPreprocessor>(mVoiceSink);
+        if (!std::atomic_load(&mVoiceFilter)) {
+            std::atomic_store(&mVoiceFilter, std::make_shared<audio::SpeexPreprocessor>(mVoiceSink));
         }
     } else {
-        mVoiceFilter.reset();
+        std::atomic_store(&mVoiceFilter, std::shared_ptr<audio::SpeexPreprocessor>());
     }
 }
 
 void RadioSimulation::setEnableOutputEffects(bool enableEffects) {
     std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
-    for (auto &thisRadio: mRadioState) {
+    for (auto &thisRadio: mRadioConfig) {
         thisRadio.mBypassEffects = !enableEffects;
     }
+    publishRadioState();
 }
 
 void RadioSimulation::setEnableHfSquelch(bool enableSquelch) {
     std::lock_guard<std::mutex> radioStateGuard(mRadioStateLock);
-    for (auto &thisRadio: mRadioState) {
+    for (auto &thisRadio: mRadioConfig) {
         thisRadio.mHfSquelch = enableSquelch;
     }
+    publishRadioState();
 }
 
 void RadioSimulation::setupDevices(util::ChainedCallback<void(ClientEventType, void *, void *)> *eventCallback) {
@@ -552,10 +551,49 @@ void RadioSimulation::setupDevices(util::ChainedCallback<void(ClientEventType, v
 
 void RadioSimulation::setOnHeadset(unsigned int radio, bool onHeadset) {
     std::lock_guard<std::mutex> mRadioStateGuard(mRadioStateLock);
-    mRadioState[radio].onHeadset = onHeadset;
+    if (radio >= mRadioConfig.size()) {
+        return;
+    }
+    mRadioConfig[radio].onHeadset = onHeadset;
+    publishRadioState();
 }
 
 void RadioSimulation::setSplitAudioChannels(bool splitChannels) {
     std::lock_guard<std::mutex> mRadioStateGuard(mRadioStateLock);
     mSplitChannels = splitChannels;
+    publishRadioState();
+}
+
+bool RadioSimulation::getSplitAudioChannels() {
+    std::lock_guard<std::mutex> mRadioStateGuard(mRadioStateLock);
+    return mSplitChannels;
+}
+
+OutputDeviceState::RenderTimings RadioSimulation::getRenderTimings(bool onHeadset) {
+    const auto &state = onHeadset ? mHeadsetState : mSpeakerState;
+    return state ? state->getRenderTimings() : OutputDeviceState::RenderTimings();
+}
+
+void RadioSimulation::setJitterLatencyMode(JitterLatencyMode mode) {
+    mIncomingStreams.setLatencyMode(mode);
+}
+
+void RadioSimulation::setEnableTransmitFec(bool enable, int expectedLossPercent) {
+    mVoiceSink->setInbandFec(enable, expectedLossPercent);
+}
+
+bool RadioSimulation::getStreamJitterStatistics(const std::string &callsign, JitterStatistics &statsOut) {
+    return mIncomingStreams.getStreamStatistics(callsign, statsOut);
+}
+
+JitterStatistics RadioSimulation::getFrequencyJitterStatistics(unsigned int frequency) {
+    return mIncomingStreams.getFrequencyStatistics(frequency);
+}
+
+void RadioSimulation::setMaxReceiveStreams(unsigned int maxStreams) {
+    mIncomingStreams.setMaxStreams(maxStreams);
+}
+
+StreamPoolStatistics RadioSimulation::getStreamPoolStatistics() {
+    return mIncomingStreams.getPoolStatistics();
 }
@@ -44,12 +44,16 @@ using namespace afv_native;
 using namespace std;
 
 RemoteVoiceSource::RemoteVoiceSource():
-    mJitterBufferMutex(), mIsActive(false), mSilentFrames(0), mEnding(false), mEndingSequence(0), mCurrentFrame(0) {
+    mPacketQueue(), mIsActive(false), mLastActive(0), mLatencyMode(JitterLatencyMode::Balanced), mAppliedLatencyMode(JitterLatencyMode::Balanced), mSilentFrames(0), mCurrentFrame(0), mEnding(false), mEndingSequence(0), mLastDecodedTick(0), mDecoding(false), mPlaying(false), mHaveSequence(false), mHighestSequence(0), mMissingSequences(0), PacketQueueOverflows(0), PacketsReceived(0), PacketsLate(0), PacketsLost(0), FramesRecovered(0), FramesConcealed(0), FramesInserted(0), FramesSkipped(0), BufferedFrames(0) {
+    for (auto &frameTick: mDecodedFrameTicks) {
+        frameTick.store(0);
+    }
+    for (auto &pinned: mPinnedFrames) {
+        pinned.store(-1);
+    }
     mJitterBuffer = jitter_buffer_init(1);
-    jitter_buffer_ctl(mJitterBuffer, JITTER_BUFFER_SET_DESTROY_CALLBACK, reinterpret_cast<void *>(::free));
-
-    // spx_uint32_t jitterMargin = 0;
-    // jitter_buffer_ctl(mJitterBuffer, JITTER_BUFFER_SET_MARGIN, &jitterMargin);
+    jitter_buffer_ctl(mJitterBuffer, JITTER_BUFFER_SET_DESTROY_CALLBACK, reinterpret_cast<void *>(&util::PacketSlab::release));
+    applyLatencyMode(mAppliedLatencyMode);
 
     int opus_status;
     mDecoder = opus_decoder_create(sampleRateHz, 1, &opus_status);
@@ -66,37 +70,156 @@ RemoteVoiceSource::~RemoteVoiceSource() {
     }
     jitter_buffer_destroy(mJitterBuffer);
     mJitterBuffer = nullptr;
+
+    QueuedPacket packet;
+    while (mPacketQueue.pop(packet)) {
+        util::PacketSlab::release(packet.data);
+    }
 }
 
-void RemoteVoiceSource::appendAudioDTO(const dto::IAudio &audio) {
-    JitterBufferPacket newPacket;
-    ::memset(&newPacket, 0, sizeof(newPacket));
+void RemoteVoiceSource::appendAudioDTO(const dto::AudioRxOnTransceiversView &audio, util::monotime_t now) {
+    PacketsReceived++;
 
-    if (audio.LastPacket) {
-        mEnding         = true;
-        mEndingSequence = audio.SequenceCounter;
-    } else {
-        mEnding = false;
+    // check for room before taking a buffer, as only the renderer may give one back.  We're the
+    // only thread pushing, so the queue can't fill up between here and the push.
+    if (mPacketQueue.size() >= packetQueueDepth) {
+        PacketQueueOverflows++;
+        return;
     }
 
-    auto currentTime = util::monotime_get();
-    if((currentTime - mLastActive) > 500) {
-        flush();
+    QueuedPacket packet;
+    packet.data = static_cast<char *>(mPacketSlab.allocate(audio.AudioLength));
+    if (packet.data == nullptr) {
+        PacketQueueOverflows++;
+        return;
     }
+    packet.len        = audio.AudioLength;
+    packet.sequence   = audio.SequenceCounter;
+    packet.lastPacket = audio.LastPacket;
+    memcpy(packet.data, audio.Audio, audio.AudioLength);
+
+    packet.flushFirst = (now - mLastActive.load()) > 500;
 
-    newPacket.data = static_cast<char *>(::malloc(audio.Audio.size()));
-    memcpy(newPacket.data, audio.Audio.data(), audio.Audio.size());
-    newPacket.len       = audio.Audio.size();
-    newPacket.timestamp = audio.SequenceCounter;
-    newPacket.span      = 1;
-    {
-        std::lock_guard<std::mutex> lock(mJitterBufferMutex);
+    mPacketQueue.push(std::move(packet));
+    mLastActive.store(now);
+}
+
+void RemoteVoiceSource::drainPacketQueue() {
+    const auto latencyMode = mLatencyMode.load(std::memory_order_relaxed);
+    if (latencyMode != mAppliedLatencyMode) {
+        applyLatencyMode(latencyMode);
+    }
 
-        jitter_buffer_put(mJitterBuffer, &newPacket);
+    QueuedPacket packet;
+    while (mPacketQueue.pop(packet)) {
+        if (packet.lastPacket) {
+            mEnding         = true;
+            mEndingSequence = packet.sequence;
+        } else {
+            mEnding = false;
+        }
+
+        if (packet.flushFirst) {
+            flush();
+        }
+        countPacket(packet.sequence);
+        cachePacket(packet);
+
+        if (isTooLateToBuffer(packet.sequence)) {
+            // the jitterbuffer would drop this without handing it to the destroy callback.
+            util::PacketSlab::release(packet.data);
+        } else {
+            JitterBufferPacket newPacket;
+            ::memset(&newPacket, 0, sizeof(newPacket));
+            newPacket.data      = packet.data;
+            newPacket.len       = packet.len;
+            newPacket.timestamp = packet.sequence;
+            newPacket.span      = 1;
+            jitter_buffer_put(mJitterBuffer, &newPacket);
+        }
         mSilentFrames = 0;
-        mLastActive = currentTime;
+        mIsActive     = true;
     }
-    mIsActive = true;
+}
+
+void RemoteVoiceSource::countPacket(uint32_t sequence) {
+    if (mPlaying && static_cast<int32_t>(sequence - static_cast<uint32_t>(jitter_buffer_get_pointer_timestamp(mJitterBuffer))) < 0) {
+        PacketsLate++;
+    }
+
+    if (!mHaveSequence) {
+        mHaveSequence    = true;
+        mHighestSequence = sequence;
+        return;
+    }
+    const auto ahead = static_cast<int32_t>(sequence - mHighestSequence);
+    if (ahead > 0) {
+        // a jump longer than the jitterbuffer could ever cover is a restarted sender, not loss.
+        if (ahead > 1 && ahead <= maxCountedGap) {
+            const auto missing = static_cast<uint32_t>(ahead - 1);
+            PacketsLost += missing;
+            mMissingSequences += missing;
+        }
+        mHighestSequence = sequence;
+    } else if (mMissingSequences > 0) {
+        // an out of order packet, filling one of the gaps counted as lost.
+        PacketsLost--;
+        mMissingSequences--;
+    }
+}
+
+bool RemoteVoiceSource::isTooLateToBuffer(uint32_t sequence) {
+    // this is jitter_buffer_put's own test - it keeps anything that ends no more than a delay
+    // step before the playout position.  Until something has played it keeps everything.
+    if (!mPlaying) {
+        return false;
+    }
+    spx_int32_t delayStep = 0;
+    jitter_buffer_ctl(mJitterBuffer, JITTER_BUFFER_GET_DELAY_STEP, &delayStep);
+    const auto playoutTimestamp = static_cast<uint32_t>(jitter_buffer_get_pointer_timestamp(mJitterBuffer));
+    return static_cast<int32_t>(sequence + 1 + delayStep - playoutTimestamp) < 0;
+}
+
+void RemoteVoiceSource::cachePacket(const QueuedPacket &packet) {
+    auto &cachedPacket = mFecCache[packet.sequence % fecCacheDepth];
+    if (packet.len > fecCachePacketBytes) {
+        // too big to be a single Opus frame - don't let an older packet stand in for it.
+        cachedPacket.valid = false;
+        return;
+    }
+    cachedPacket.valid    = true;
+    cachedPacket.sequence = packet.sequence;
+    cachedPacket.len      = packet.len;
+    ::memcpy(cachedPacket.data, packet.data, packet.len);
+}
+
+const RemoteVoiceSource::CachedPacket *RemoteVoiceSource::findCachedPacket(uint32_t sequence) const {
+    const auto &cachedPacket = mFecCache[sequence % fecCacheDepth];
+    if (!cachedPacket.valid || cachedPacket.sequence != sequence) {
+        return nullptr;
+    }
+    return &cachedPacket;
+}
+
+void RemoteVoiceSource::applyLatencyMode(JitterLatencyMode mode) {
+    // the margin is in frames, as every packet spans one timestamp.  The late rate is the
+    // percentage of packets the buffer lets arrive too late to play, when picking its delay.
+    spx_int32_t margin      = 0;
+    spx_int32_t maxLateRate = 4; // the Speex default.
+    switch (mode) {
+        case JitterLatencyMode::MinimumLatency:
+            maxLateRate = 10;
+            break;
+        case JitterLatencyMode::Robust:
+            margin      = 2;
+            maxLateRate = 2;
+            break;
+        default:
+            break;
+    }
+    jitter_buffer_ctl(mJitterBuffer, JITTER_BUFFER_SET_MARGIN, &margin);
+    jitter_buffer_ctl(mJitterBuffer, JITTER_BUFFER_SET_MAX_LATE_RATE, &maxLateRate);
+    mAppliedLatencyMode = mode;
 }
 
 SourceStatus RemoteVoiceSource::getAudioFrame(SampleType *bufferOut) {
@@ -107,10 +230,7 @@ SourceStatus RemoteVoiceSource::getAudioFrame(SampleType *bufferOut) {
     spx_int32_t tsOut;
     int         jitter_status;
     int         opus_res = OPUS_OK;
-    {
-        std::lock_guard<std::mutex> lock(mJitterBufferMutex);
-        jitter_status = jitter_buffer_get(mJitterBuffer, &pktOut, 1, &tsOut);
-    }
+    jitter_status = jitter_buffer_get(mJitterBuffer, &pktOut, 1, &tsOut);
     if (mDecoder != nullptr) {
         switch (jitter_status) {
             case JITTER_BUFFER_MISSING:
@@ -118,20 +238,40 @@ SourceStatus RemoteVoiceSource::getAudioFrame(SampleType *bufferOut) {
                 if (mEnding && (mCurrentFrame >= mEndingSequence)) {
                     ::memset(bufferOut, 0, frameSizeSamples * sizeof(SampleType));
                     rv = SourceStatus::Closed;
+                } else if (const auto *nextPacket = mPlaying ? findCachedPacket(pktOut.timestamp + 1) : nullptr) {
+                    // the next packet has arrived, so rebuild this frame from its FEC data.  (If
+                    // the sender has FEC off, Opus conceals the gap as it would below.)  Until
+                    // something has played, the jitterbuffer's timestamp isn't the stream's, so
+                    // there's nothing to look for.
+                    const auto nextLen = static_cast<opus_int32>(nextPacket->len);
+                    opus_res = opus_decode_float(mDecoder, nextPacket->data, nextLen, bufferOut, frameSizeSamples, true);
+#ifdef AFV_NATIVE_HAVE_OPUS_PACKET_HAS_LBRR
+                    if (opus_packet_has_lbrr(nextPacket->data, nextLen) > 0) {
+                        FramesRecovered++;
+                    } else {
+                        FramesConcealed++;
+                    }
+#else
+                    // older libopus can't say whether the packet had FEC data, so assume it did.
+                    FramesRecovered++;
+#endif
                 } else {
                     // prod opus to perform gap compensation.
                     opus_res = opus_decode_float(mDecoder, nullptr, 0, bufferOut, frameSizeSamples, false);
+                    FramesConcealed++;
                 }
                 break;
             case JITTER_BUFFER_INSERTION:
                 // insert silence.
                 ::memset(bufferOut, 0, frameSizeSamples * sizeof(SampleType));
+                FramesInserted++;
                 break;
             case JITTER_BUFFER_OK:
                 mCurrentFrame = tsOut;
+                mPlaying      = true;
                 opus_res = opus_decode_float(mDecoder, reinterpret_cast<unsigned char *>(pktOut.data),
                                              pktOut.len, bufferOut, frameSizeSamples, false);
-                ::free(pktOut.data);
+                util::PacketSlab::release(pktOut.data);
                 break;
             default:
                 LOG("instreambuffer", "Got Error return from the jitter buffer: %d", jitter_status);
@@ -146,18 +286,16 @@ SourceStatus RemoteVoiceSource::getAudioFrame(SampleType *bufferOut) {
         memset(bufferOut, 0, frameSizeSamples * sizeof(SampleType));
         rv = SourceStatus::Error;
     }
-    {
-        std::lock_guard<std::mutex> lock(mJitterBufferMutex);
-        jitter_buffer_tick(mJitterBuffer);
-        // if we don't have a terminally flagged marker, check for timeouts.
-        spx_int32_t bufCount = 0;
-        jitter_buffer_ctl(mJitterBuffer, JITTER_BUFFER_GET_AVAILABLE_COUNT, &bufCount);
-        if (bufCount == 0) {
-            mSilentFrames += 1;
-            if (mSilentFrames > frameTimeOut) {
-                if (rv != SourceStatus::Error) {
-                    rv = SourceStatus::Closed;
-                }
+    jitter_buffer_tick(mJitterBuffer);
+    // if we don't have a terminally flagged marker, check for timeouts.
+    spx_int32_t bufCount = 0;
+    jitter_buffer_ctl(mJitterBuffer, JITTER_BUFFER_GET_AVAILABLE_COUNT, &bufCount);
+    BufferedFrames.store(static_cast<uint32_t>(bufCount), std::memory_order_relaxed);
+    if (bufCount == 0) {
+        mSilentFrames += 1;
+        if (mSilentFrames > frameTimeOut) {
+            if (rv != SourceStatus::Error) {
+                rv = SourceStatus::Closed;
             }
         }
     }
@@ -167,13 +305,138 @@ SourceStatus RemoteVoiceSource::getAudioFrame(SampleType *bufferOut) {
     return rv;
 }
 
+const SampleType *RemoteVoiceSource::getCachedAudioFrame(uint64_t tick, size_t reader) {
+    if (const SampleType *frame = pinCachedFrame(tick, reader)) {
+        return frame;
+    }
+    if (tick <= mLastDecodedTick.load(std::memory_order_acquire)) {
+        // somebody has already started on this tick.  Once they're done it's either cached or
+        // there was nothing to play.
+        if (!mDecoding.load(std::memory_order_acquire)) {
+            return pinCachedFrame(tick, reader);
+        }
+    } else if (!mDecoding.exchange(true, std::memory_order_acquire)) {
+        // we hold the decoder, and may be the leading output for this tick.
+        const SampleType *frame = nullptr;
+        if (tick > mLastDecodedTick.load(std::memory_order_relaxed)) {
+            mLastDecodedTick.store(tick, std::memory_order_release);
+            frame = decodeCachedFrame(tick, reader);
+        } else {
+            frame = pinCachedFrame(tick, reader);
+        }
+        mDecoding.store(false, std::memory_order_release);
+        return frame;
+    }
+
+    // the other output has the decoder, and we won't wait for it: play the stream's previous frame
+    // again if it's still cached, or go without the stream for this frame.
+    FramesSkipped++;
+    return (tick > 0) ? pinCachedFrame(tick - 1, reader) : nullptr;
+}
+
+const SampleType *RemoteVoiceSource::pinCachedFrame(uint64_t tick, size_t reader) {
+    for (int slot = 0; slot < decodedFrameCacheDepth; slot++) {
+        if (mDecodedFrameTicks[slot].load(std::memory_order_acquire) != tick) {
+            continue;
+        }
+        // pin, then make sure the entry wasn't taken for decoding before the pin was seen - see
+        // decodeCachedFrame.
+        mPinnedFrames[reader].store(slot, std::memory_order_seq_cst);
+        if (mDecodedFrameTicks[slot].load(std::memory_order_seq_cst) == tick) {
+            return mDecodedFrames[slot];
+        }
+    }
+    return nullptr;
+}
+
+const SampleType *RemoteVoiceSource::decodeCachedFrame(uint64_t tick, size_t reader) {
+    auto isPinned = [this](int slot) {
+        for (const auto &pinned: mPinnedFrames) {
+            if (pinned.load(std::memory_order_seq_cst) == slot) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // take the oldest entry nobody has pinned.  Clearing it before checking the pins again means
+    // a reader either sees it cleared, or we see its pin and leave the entry alone.  There are
+    // more entries than readers, so one is always free.
+    int slot = -1;
+    while (slot < 0) {
+        int      oldest     = -1;
+        uint64_t oldestTick = 0;
+        for (int candidate = 0; candidate < decodedFrameCacheDepth; candidate++) {
+            const uint64_t candidateTick = mDecodedFrameTicks[candidate].load(std::memory_order_relaxed);
+            if (isPinned(candidate)) {
+                continue;
+            }
+            if (oldest < 0 || candidateTick < oldestTick) {
+                oldest     = candidate;
+                oldestTick = candidateTick;
+            }
+        }
+        mDecodedFrameTicks[oldest].store(0, std::memory_order_seq_cst);
+        if (!isPinned(oldest)) {
+            slot = oldest;
+        }
+    }
+
+    drainPacketQueue();
+    if (!mIsActive || getAudioFrame(mDecodedFrames[slot]) != SourceStatus::OK) {
+        return nullptr;
+    }
+    mDecodedFrameTicks[slot].store(tick, std::memory_order_release);
+    mPinnedFrames[reader].store(slot, std::memory_order_seq_cst);
+    return mDecodedFrames[slot];
+}
+
 void RemoteVoiceSource::flush() {
-    {
-        std::lock_guard<std::mutex> lock(mJitterBufferMutex);
-        // this nukes the jitter buffer contents, without resetting the latency timers.
-        jitter_buffer_reset(mJitterBuffer);
+    // this nukes the jitter buffer contents, without resetting the latency timers.
+    jitter_buffer_reset(mJitterBuffer);
+    if (mDecoder != nullptr) {
+        opus_decoder_ctl(mDecoder, OPUS_RESET_STATE);
+    }
+    mPlaying          = false;
+    mHaveSequence     = false;
+    mMissingSequences = 0;
+    for (auto &cachedPacket: mFecCache) {
+        cachedPacket.valid = false;
+    }
+}
+
+void RemoteVoiceSource::recycle() {
+    QueuedPacket packet;
+    while (mPacketQueue.pop(packet)) {
+        util::PacketSlab::release(packet.data);
+    }
+    // jitter_buffer_reset also clears the jitterbuffer's timing history, leaving only its tuning
+    // - which is the latency mode, and so wanted by the next stream too.
+    flush();
+
+    mIsActive       = false;
+    mLastActive     = 0;
+    mSilentFrames   = 0;
+    mCurrentFrame   = 0;
+    mEnding         = false;
+    mEndingSequence = 0;
+    for (auto &frameTick: mDecodedFrameTicks) {
+        frameTick.store(0);
     }
-    opus_decoder_ctl(mDecoder, OPUS_RESET_STATE);
+    for (auto &pinned: mPinnedFrames) {
+        pinned.store(-1);
+    }
+    mLastDecodedTick = 0;
+
+    PacketQueueOverflows = 0;
+    PacketsReceived      = 0;
+    PacketsLate          = 0;
+    PacketsLost          = 0;
+    FramesRecovered      = 0;
+    FramesConcealed      = 0;
+    FramesInserted       = 0;
+    FramesSkipped        = 0;
+    BufferedFrames       = 0;
 }
 
 bool RemoteVoiceSource::isActive() const {
@@ -183,3 +446,22 @@ bool RemoteVoiceSource::isActive() const {
 util::monotime_t RemoteVoiceSource::getLastActivityTime() const {
     return mLastActive;
 }
+
+void RemoteVoiceSource::setLatencyMode(JitterLatencyMode mode) {
+    mLatencyMode.store(mode, std::memory_order_relaxed);
+}
+
+JitterStatistics RemoteVoiceSource::getJitterStatistics() const {
+    JitterStatistics stats;
+    stats.streams              = 1;
+    stats.packetsReceived      = PacketsReceived.load();
+    stats.packetsLate          = PacketsLate.load();
+    stats.packetsLost          = PacketsLost.load();
+    stats.packetQueueOverflows = PacketQueueOverflows.load();
+    stats.framesRecovered      = FramesRecovered.load();
+    stats.framesConcealed      = FramesConcealed.load();
+    stats.framesInserted       = FramesInserted.load();
+    stats.framesSkipped        = FramesSkipped.load();
+    stats.bufferingDelayMs     = BufferedFrames.load() * frameLengthMs;
+    return stats;
+}
@@ -0,0 +1,281 @@
+#include "afv-native/afv/StreamRegistry.h"
+
+#include <algorithm>
+
+using namespace afv_native;
+using namespace afv_native::afv;
+
+/** sameRouting returns true if a and b route a stream identically - the same frequencies, in the
+ * same order.  Distance ratios don't count - see storeDistanceRatios.
+ */
+static bool sameRouting(const std::vector<dto::RxTransceiver> &a, const dto::AudioRxOnTransceiversView &b) {
+    return std::equal(a.begin(), a.end(), b.transceiversBegin(), b.transceiversEnd(), [](const dto::RxTransceiver &x, const dto::RxTransceiver &y) {
+        return x.Frequency == y.Frequency;
+    });
+}
+
+/** storeDistanceRatios stores the best DistanceRatio for each frequency in pkt into ratios, at
+ * the position of the first transceiver on that frequency.  ratios must have an entry for each
+ * of pkt's transceivers.
+ */
+static void storeDistanceRatios(const dto::AudioRxOnTransceiversView &pkt, StreamRegistry::DistanceRatios &ratios) {
+    const dto::RxTransceiver *transceivers = pkt.transceiversBegin();
+    for (size_t first = 0; first < pkt.TransceiverCount; first++) {
+        const auto frequency = transceivers[first].Frequency;
+        if (std::any_of(transceivers, transceivers + first, [frequency](const dto::RxTransceiver &trans) {
+                return trans.Frequency == frequency;
+            })) {
+            continue;
+        }
+        float best = transceivers[first].DistanceRatio;
+        for (size_t other = first + 1; other < pkt.TransceiverCount; other++) {
+            if (transceivers[other].Frequency == frequency) {
+                best = std::max(best, transceivers[other].DistanceRatio);
+            }
+        }
+        ratios[first].store(best, std::memory_order_relaxed);
+    }
+}
+
+StreamRegistry::StreamRegistry():
+    mWriterLock(), mStreams(), mSources(), mDistanceRatios(), mFreeSlots(), mRoutes(), mPurgedPacketQueueOverflows(0), mLatencyMode(JitterLatencyMode::Balanced), mIdleSources(), mMaxStreams(0), mPoolHits(0), mPoolMisses(0), mEvictions(0), mTable(new StreamTable()) {
+}
+
+void StreamRegistry::rxVoicePacket(const dto::AudioRxOnTransceiversView &pkt, util::monotime_t now) {
+    std::lock_guard<std::mutex> writerGuard(mWriterLock);
+
+    auto       streamIter = mStreams.lower_bound(pkt.Callsign);
+    const bool isNew      = (streamIter == mStreams.end() || streamIter->first != pkt.Callsign);
+    if (isNew) {
+        streamIter = mStreams.emplace_hint(streamIter, std::string(pkt.Callsign), StreamMeta());
+    }
+    auto &stream = streamIter->second;
+    if (isNew) {
+        // make room first, so the new stream can have the slot the evicted one leaves.  (Not its
+        // source, though - the renderer has that until the table published below replaces it.)
+        if (mMaxStreams > 0) {
+            bool evicted = false;
+            while (mStreams.size() > mMaxStreams && evictLeastRecentlyActive(streamIter)) {
+                evicted = true;
+            }
+            if (evicted) {
+                mRoutes.compact();
+            }
+        }
+        stream.source = acquireSource();
+        stream.source->setLatencyMode(mLatencyMode);
+        if (!mFreeSlots.empty()) {
+            stream.slot = mFreeSlots.back();
+            mFreeSlots.pop_back();
+            mSources[stream.slot] = stream.source;
+        } else {
+            stream.slot = mSources.size();
+            mSources.push_back(stream.source);
+            mDistanceRatios.emplace_back();
+        }
+    }
+    // queue the packet before publishing, so a new stream has something to play on its first render.
+    stream.source->appendAudioDTO(pkt, now);
+
+    if (isNew || !sameRouting(stream.transceivers, pkt)) {
+        std::vector<dto::RxTransceiver> transceivers(pkt.transceiversBegin(), pkt.transceiversEnd());
+        mRoutes.update(stream.slot, stream.transceivers, transceivers);
+        stream.transceivers = std::move(transceivers);
+        // the tables still in use keep the old ratios alive.
+        stream.distanceRatios = std::make_shared<DistanceRatios>(pkt.TransceiverCount);
+        storeDistanceRatios(pkt, *stream.distanceRatios);
+        mDistanceRatios[stream.slot] = stream.distanceRatios;
+        publish();
+    } else {
+        // only the distance ratios have changed, and every table shares those.
+        storeDistanceRatios(pkt, *stream.distanceRatios);
+    }
+}
+
+void StreamRegistry::purgeInactive(util::monotime_t now, util::monotime_t timeoutMs) {
+    std::lock_guard<std::mutex> writerGuard(mWriterLock);
+
+    bool purged = false;
+    for (auto streamIter = mStreams.begin(); streamIter != mStreams.end();) {
+        if ((now - streamIter->second.source->getLastActivityTime()) <= timeoutMs) {
+            ++streamIter;
+            continue;
+        }
+        streamIter = removeStream(streamIter);
+        purged     = true;
+    }
+    if (purged) {
+        mRoutes.compact();
+        publish();
+    } else {
+        mTable.reclaim();
+    }
+}
+
+void StreamRegistry::clear() {
+    std::lock_guard<std::mutex> writerGuard(mWriterLock);
+
+    for (const auto &streamPair: mStreams) {
+        mPurgedPacketQueueOverflows += streamPair.second.source->PacketQueueOverflows.load();
+    }
+    mStreams.clear();
+    mSources.clear();
+    mDistanceRatios.clear();
+    mIdleSources.clear();
+    mFreeSlots.clear();
+    mRoutes.clear();
+    publish();
+}
+
+void StreamRegistry::setMaxStreams(size_t maxStreams) {
+    std::lock_guard<std::mutex> writerGuard(mWriterLock);
+
+    mMaxStreams  = maxStreams;
+    bool evicted = false;
+    while (mMaxStreams > 0 && mStreams.size() > mMaxStreams && evictLeastRecentlyActive(mStreams.cend())) {
+        evicted = true;
+    }
+    if (evicted) {
+        mRoutes.compact();
+        publish();
+    }
+}
+
+void StreamRegistry::setLatencyMode(JitterLatencyMode mode) {
+    std::lock_guard<std::mutex> writerGuard(mWriterLock);
+
+    mLatencyMode = mode;
+    for (const auto &streamPair: mStreams) {
+        streamPair.second.source->setLatencyMode(mode);
+    }
+}
+
+bool StreamRegistry::getStreamStatistics(const std::string &callsign, JitterStatistics &statsOut) {
+    std::lock_guard<std::mutex> writerGuard(mWriterLock);
+
+    auto streamIter = mStreams.find(callsign);
+    if (streamIter == mStreams.end()) {
+        return false;
+    }
+    statsOut = streamIter->second.source->getJitterStatistics();
+    return true;
+}
+
+JitterStatistics StreamRegistry::getFrequencyStatistics(unsigned int frequency) {
+    std::lock_guard<std::mutex> writerGuard(mWriterLock);
+
+    JitterStatistics stats;
+    for (const auto &streamPair: mStreams) {
+        const auto &transceivers = streamPair.second.transceivers;
+        const bool  heard        = std::any_of(transceivers.begin(), transceivers.end(), [frequency](const dto::RxTransceiver &transceiver) {
+            return transceiver.Frequency == frequency;
+        });
+        if (heard) {
+            stats += streamPair.second.source->getJitterStatistics();
+        }
+    }
+    return stats;
+}
+
+StreamPoolStatistics StreamRegistry::getPoolStatistics() {
+    std::lock_guard<std::mutex> writerGuard(mWriterLock);
+
+    StreamPoolStatistics stats;
+    stats.liveStreams  = static_cast<uint32_t>(mStreams.size());
+    stats.idleDecoders = static_cast<uint32_t>(mIdleSources.size());
+    stats.maxStreams   = static_cast<uint32_t>(mMaxStreams);
+    stats.poolHits     = mPoolHits;
+    stats.poolMisses   = mPoolMisses;
+    stats.evictions    = mEvictions;
+    return stats;
+}
+
+StreamRegistry::StreamTable *StreamRegistry::beginRender(size_t renderer) {
+    return mTable.beginRead(renderer);
+}
+
+void StreamRegistry::endRender(size_t renderer) {
+    mTable.endRead(renderer);
+}
+
+uint32_t StreamRegistry::getTablesPublished() const {
+    return mTable.Published.load();
+}
+
+uint32_t StreamRegistry::getTablesReclaimed() const {
+    return mTable.Reclaimed.load();
+}
+
+uint32_t StreamRegistry::getPacketQueueOverflows() {
+    std::lock_guard<std::mutex> writerGuard(mWriterLock);
+
+    uint32_t overflows = mPurgedPacketQueueOverflows;
+    for (const auto &streamPair: mStreams) {
+        overflows += streamPair.second.source->PacketQueueOverflows.load();
+    }
+    return overflows;
+}
+
+void StreamRegistry::publish() {
+    auto *table           = new StreamTable();
+    table->sources        = mSources;
+    table->routes         = mRoutes;
+    table->distanceRatios = mDistanceRatios;
+    for (auto &frames: table->frames) {
+        frames.resize(mSources.size(), nullptr);
+    }
+
+    mTable.publish(table);
+}
+
+std::shared_ptr<RemoteVoiceSource> StreamRegistry::acquireSource() {
+    // let go of any tables the renderer has finished with, as they may be all that's holding on
+    // to an idle source.
+    mTable.reclaim();
+
+    // oldest first, as those are the likeliest to be out of every table.  Tables are only ever
+    // freed by writers, under mWriterLock, so a source nothing else refers to stays that way.
+    for (auto sourceIter = mIdleSources.begin(); sourceIter != mIdleSources.end(); ++sourceIter) {
+        if (sourceIter->use_count() != 1) {
+            continue;
+        }
+        auto source = std::move(*sourceIter);
+        mIdleSources.erase(sourceIter);
+        source->recycle();
+        mPoolHits++;
+        return source;
+    }
+    mPoolMisses++;
+    return std::make_shared<RemoteVoiceSource>();
+}
+
+StreamRegistry::StreamMap::iterator StreamRegistry::removeStream(StreamMap::iterator streamIter) {
+    auto &stream = streamIter->second;
+    mPurgedPacketQueueOverflows += stream.source->PacketQueueOverflows.load();
+    mRoutes.remove(stream.slot, stream.transceivers);
+    mSources[stream.slot].reset();
+    mDistanceRatios[stream.slot].reset();
+    mFreeSlots.push_back(stream.slot);
+    if (mIdleSources.size() < idleSourceDepth) {
+        mIdleSources.push_back(std::move(stream.source));
+    }
+    return mStreams.erase(streamIter);
+}
+
+bool StreamRegistry::evictLeastRecentlyActive(StreamMap::const_iterator keep) {
+    auto victim = mStreams.end();
+    for (auto streamIter = mStreams.begin(); streamIter != mStreams.end(); ++streamIter) {
+        if (streamIter == keep) {
+            continue;
+        }
+        if (victim == mStreams.end() || streamIter->second.source->getLastActivityTime() < victim->second.source->getLastActivityTime()) {
+            victim = streamIter;
+        }
+    }
+    if (victim == mStreams.end()) {
+        return false;
+    }
+    removeStream(victim);
+    mEvictions++;
+    return true;
+}
@@ -0,0 +1,117 @@
+#include "afv-native/afv/TransmitPipeline.h"
+#include "afv-native/Log.h"
+#include <cstring>
+
+using namespace afv_native;
+using namespace afv_native::afv;
+
+TransmitPipeline::TransmitPipeline(FrameHandler handler):
+    FramesQueued(0), FramesDropped(0), MaxQueueDepth(0), FramesHandled(0), FrameLatencyNs(0), MaxFrameLatencyNs(0), mHandler(std::move(handler)), mQueue(), mWake(), mStop(false), mClearRequested(0), mClearsDone(0), mLock(), mClearDone() {
+    for (size_t i = 0; i < stageCount; i++) {
+        StageFrames[i].store(0);
+        StageNs[i].store(0);
+        MaxStageNs[i].store(0);
+    }
+    // the worker only starts once everything it touches is set up.
+    mThread = std::thread(&TransmitPipeline::run, this);
+}
+
+TransmitPipeline::~TransmitPipeline() {
+    mStop.store(true);
+    mWake.post();
+    mThread.join();
+}
+
+bool TransmitPipeline::push(const audio::SampleType *samples, uint32_t sequence, bool transmit, bool lastPacket) {
+    Frame frame;
+    ::memcpy(frame.samples, samples, sizeof(frame.samples));
+    frame.sequence   = sequence;
+    frame.transmit   = transmit;
+    frame.lastPacket = lastPacket;
+    frame.queuedAt   = std::chrono::steady_clock::now();
+    if (!mQueue.push(std::move(frame))) {
+        FramesDropped++;
+        return false;
+    }
+    FramesQueued++;
+
+    // only the capture callback pushes, so nothing else can be raising MaxQueueDepth.
+    const auto depth = static_cast<uint32_t>(mQueue.size());
+    if (depth > MaxQueueDepth.load(std::memory_order_relaxed)) {
+        MaxQueueDepth.store(depth, std::memory_order_relaxed);
+    }
+
+    mWake.post();
+    return true;
+}
+
+void TransmitPipeline::clear() {
+    // only the worker may pop, so ask it to do the dropping, which also means it's not in the
+    // middle of a frame when it reports back.
+    const uint32_t              request = mClearRequested.fetch_add(1) + 1;
+    std::unique_lock<std::mutex> clearLock(mLock);
+    mWake.post();
+    mClearDone.wait(clearLock, [this, request]() { return static_cast<int32_t>(mClearsDone - request) >= 0; });
+}
+
+void TransmitPipeline::addStageTime(Stage stage, std::chrono::steady_clock::duration elapsed) {
+    const auto index     = static_cast<size_t>(stage);
+    const auto elapsedNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    StageNs[index] += elapsedNs;
+    if (elapsedNs > MaxStageNs[index].load(std::memory_order_relaxed)) {
+        MaxStageNs[index].store(elapsedNs, std::memory_order_relaxed);
+    }
+    StageFrames[index]++;
+}
+
+/** averageMs is total / count in milliseconds, or 0 if count is. */
+static double averageMs(uint64_t totalNs, uint32_t count) {
+    return count > 0 ? totalNs / (count * 1e6) : 0.0;
+}
+
+void TransmitPipeline::logStatistics() {
+    static const char *stageNames[stageCount] = {"Preprocess", "Encode", "Send"};
+
+    LOG("TransmitPipeline", "Frames Queued: %u, Dropped: %u, Handled: %u, Max Queue Depth: %u, Latency Avg: %.3fms, Max: %.3fms",
+        FramesQueued.load(), FramesDropped.load(), FramesHandled.load(), MaxQueueDepth.load(),
+        averageMs(FrameLatencyNs.load(), FramesHandled.load()), MaxFrameLatencyNs.load() / 1e6);
+    for (size_t i = 0; i < stageCount; i++) {
+        LOG("TransmitPipeline", "%s: Frames: %u, Avg: %.3fms, Max: %.3fms", stageNames[i], StageFrames[i].load(),
+            averageMs(StageNs[i].load(), StageFrames[i].load()), MaxStageNs[i].load() / 1e6);
+    }
+}
+
+void TransmitPipeline::run() {
+    Frame    frame;
+    uint32_t clearsDone = 0;
+    for (;;) {
+        mWake.wait();
+        if (mStop.load()) {
+            break;
+        }
+        const uint32_t clearRequested = mClearRequested.load();
+        if (clearRequested != clearsDone) {
+            while (mQueue.pop(frame)) {
+            }
+            clearsDone = clearRequested;
+            {
+                std::lock_guard<std::mutex> clearGuard(mLock);
+                mClearsDone = clearsDone;
+            }
+            mClearDone.notify_all();
+            continue;
+        }
+        // a clear may already have taken the frame this wake was posted for.
+        if (!mQueue.pop(frame)) {
+            continue;
+        }
+        mHandler(frame);
+
+        const auto latencyNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - frame.queuedAt).count());
+        FrameLatencyNs += latencyNs;
+        if (latencyNs > MaxFrameLatencyNs.load(std::memory_order_relaxed)) {
+            MaxFrameLatencyNs.store(latencyNs, std::memory_order_relaxed);
+        }
+        FramesHandled++;
+    }
+}
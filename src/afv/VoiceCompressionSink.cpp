@@ -33,6 +33,8 @@
 
 #include "afv-native/afv/VoiceCompressionSink.h"
 #include "afv-native/Log.h"
+#include <algorithm>
+#include <utility>
 #include <vector>
 
 using namespace ::afv_native;
@@ -40,7 +42,12 @@ using namespace ::afv_native::afv;
 using namespace ::std;
 
 VoiceCompressionSink::VoiceCompressionSink(ICompressedFrameSink &sink):
-    mEncoder(nullptr), mCompressedFrameSink(sink) {
+    mEncoder(nullptr), mCompressedFrameSink(&sink), mFecLossPercent(fecDisabled), mAppliedFecLossPercent(fecDisabled) {
+    open();
+}
+
+VoiceCompressionSink::VoiceCompressionSink():
+    mEncoder(nullptr), mCompressedFrameSink(nullptr), mFecLossPercent(fecDisabled), mAppliedFecLossPercent(fecDisabled) {
     open();
 }
 
@@ -62,6 +69,7 @@ int VoiceCompressionSink::open() {
         if (opus_status != OPUS_OK) {
             LOG("VoiceCompressionSink", "error setting bitrate on codec: %s", opus_strerror(opus_status));
         }
+        applyFec(mFecLossPercent.load());
     }
     return opus_status;
 }
@@ -78,14 +86,48 @@ void VoiceCompressionSink::reset() {
     open();
 }
 
-void VoiceCompressionSink::putAudioFrame(const audio::SampleType *bufferIn) {
-    vector<unsigned char> outBuffer(audio::targetOutputFrameSizeBytes);
-    auto                  enc_len =
-        opus_encode_float(mEncoder, bufferIn, audio::frameSizeSamples, outBuffer.data(), outBuffer.size());
+void VoiceCompressionSink::setInbandFec(bool enable, int expectedLossPercent) {
+    mFecLossPercent.store(enable ? std::max(0, std::min(100, expectedLossPercent)) : fecDisabled);
+}
+
+void VoiceCompressionSink::applyFec(int lossPercent) {
+    const bool enable      = lossPercent != fecDisabled;
+    int        opus_status = opus_encoder_ctl(mEncoder, OPUS_SET_INBAND_FEC(enable ? 1 : 0));
+    if (opus_status == OPUS_OK) {
+        opus_status = opus_encoder_ctl(mEncoder, OPUS_SET_PACKET_LOSS_PERC(enable ? lossPercent : 0));
+    }
+    if (opus_status != OPUS_OK) {
+        LOG("VoiceCompressionSink", "error setting in-band FEC on codec: %s", opus_strerror(opus_status));
+    }
+    mAppliedFecLossPercent = lossPercent;
+}
+
+bool VoiceCompressionSink::encode(const audio::SampleType *bufferIn, vector<unsigned char> &encodedOut) {
+    if (mEncoder == nullptr) {
+        return false;
+    }
+    const int fecLossPercent = mFecLossPercent.load(std::memory_order_relaxed);
+    if (fecLossPercent != mAppliedFecLossPercent) {
+        applyFec(fecLossPercent);
+    }
+
+    encodedOut.resize(audio::targetOutputFrameSizeBytes);
+    auto enc_len = opus_encode_float(mEncoder, bufferIn, audio::frameSizeSamples, encodedOut.data(), encodedOut.size());
     if (enc_len < 0) {
         LOG("VoiceCompressionSink", "error encoding frame: %s", opus_strerror(enc_len));
+        return false;
+    }
+    encodedOut.resize(enc_len);
+    return true;
+}
+
+void VoiceCompressionSink::putAudioFrame(const audio::SampleType *bufferIn) {
+    if (mCompressedFrameSink == nullptr) {
+        return;
+    }
+    vector<unsigned char> outBuffer;
+    if (!encode(bufferIn, outBuffer)) {
         return;
     }
-    outBuffer.resize(enc_len);
-    mCompressedFrameSink.processCompressedFrame(outBuffer);
+    mCompressedFrameSink->processCompressedFrame(std::move(outBuffer));
 }
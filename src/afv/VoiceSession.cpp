@@ -48,7 +48,7 @@ using json = nlohmann::json;
 
 VoiceSession::VoiceSession(APISession &session, const std::string &callsign):
     mSession(session), mCallsign(callsign), mBaseUrl(""), mVoiceSessionSetupRequest("", http::Method::POST, json()), mVoiceSessionTeardownRequest("", http::Method::DEL, json()), mTransceiverUpdateRequest("", http::Method::POST, json()), mCrossCoupleGroupUpdateRequest("", http::Method::POST, json()),
-    mChannel(), mHeartbeatTimer(mSession.getEventBase(), std::bind(&VoiceSession::sendHeartbeatCallback, this)), mLastHeartbeatReceived(0),
+    mChannel(mSession.getEventBase()), mHeartbeatTimer(mSession.getEventBase(), std::bind(&VoiceSession::sendHeartbeatCallback, this)), mLastHeartbeatReceived(0),
     mHeartbeatTimeout(mSession.getEventBase(), std::bind(&VoiceSession::heartbeatTimedOut, this)), mLastError(VoiceSessionError::NoError) {
     mSessionType = VoiceSessionType::Pilot;
     updateBaseUrl();
@@ -121,9 +121,12 @@ bool VoiceSession::setupSession(const dto::PostCallsignResponse &cresp) {
     mLastHeartbeatReceived = util::monotime_get();
     mHeartbeatTimer.enable(afvHeartbeatIntervalMs);
     mHeartbeatTimeout.enable(afvHeartbeatTimeoutMs);
-    mChannel.registerDtoHandler("HA", [this](const unsigned char *data, size_t len) {
-        this->receivedHeartbeat();
-    });
+    mChannel.registerDtoHandler(
+        cryptodto::DtoId::HeartbeatAck,
+        [](const unsigned char *, size_t, void *user_data) {
+            reinterpret_cast<VoiceSession *>(user_data)->receivedHeartbeat();
+        },
+        this);
     mLastError = VoiceSessionError::NoError;
     StateCallback.invokeAll(VoiceSessionState::Connected);
 
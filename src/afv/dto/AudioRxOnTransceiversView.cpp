@@ -0,0 +1,76 @@
+#include "afv-native/afv/dto/voice_server/AudioRxOnTransceiversView.h"
+#include "afv-native/util/MsgpackReader.h"
+#include <algorithm>
+
+using namespace afv_native::afv::dto;
+using afv_native::util::MsgpackReader;
+
+AudioRxOnTransceiversView::AudioRxOnTransceiversView(const AudioRxOnTransceivers &pkt):
+    Callsign(pkt.Callsign), SequenceCounter(pkt.SequenceCounter), Audio(pkt.Audio.data()), AudioLength(pkt.Audio.size()),
+    LastPacket(pkt.LastPacket), TransceiverCount(std::min(pkt.Transceivers.size(), maxTransceivers)) {
+    std::copy_n(pkt.Transceivers.begin(), TransceiverCount, Transceivers);
+}
+
+static bool readTransceiver(MsgpackReader &reader, RxTransceiver &transceiverOut) {
+    // [ID, Frequency, DistanceRatio], as MSGPACK_DEFINE_ARRAY in RxTransceiver.  Like msgpack-c,
+    // a short array leaves the missing fields at their defaults.
+    uint32_t fieldCount = 0;
+    uint64_t id = 0, frequency = 0;
+    transceiverOut.DistanceRatio = 0.0f;
+    if (!reader.readArray(fieldCount)) {
+        return false;
+    }
+    if ((fieldCount > 0 && !reader.readUint(id)) || (fieldCount > 1 && !reader.readUint(frequency)) || (fieldCount > 2 && !reader.readFloat(transceiverOut.DistanceRatio))) {
+        return false;
+    }
+    transceiverOut.ID        = static_cast<uint16_t>(id);
+    transceiverOut.Frequency = static_cast<uint32_t>(frequency);
+    for (uint32_t i = 3; i < fieldCount; i++) {
+        if (!reader.skip()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AudioRxOnTransceiversView::decode(const unsigned char *buf, size_t len) {
+    MsgpackReader reader(buf, len);
+
+    // [Callsign, SequenceCounter, Audio, LastPacket, Transceivers], as MSGPACK_DEFINE_ARRAY in
+    // AudioRxOnTransceivers.  Like msgpack-c, a short array leaves the missing fields at their
+    // defaults.
+    Callsign         = std::string_view();
+    SequenceCounter  = 0;
+    Audio            = nullptr;
+    AudioLength      = 0;
+    LastPacket       = false;
+    TransceiverCount = 0;
+
+    uint32_t fieldCount = 0;
+    uint64_t sequence   = 0;
+    if (!reader.readArray(fieldCount)) {
+        return false;
+    }
+    if ((fieldCount > 0 && !reader.readStr(Callsign)) || (fieldCount > 1 && !reader.readUint(sequence)) || (fieldCount > 2 && !reader.readBin(Audio, AudioLength)) || (fieldCount > 3 && !reader.readBool(LastPacket))) {
+        return false;
+    }
+    SequenceCounter = static_cast<uint32_t>(sequence);
+
+    uint32_t transceiverCount = 0;
+    if (fieldCount > 4 && (!reader.readArray(transceiverCount) || transceiverCount > maxTransceivers)) {
+        return false;
+    }
+    for (TransceiverCount = 0; TransceiverCount < transceiverCount; TransceiverCount++) {
+        if (!readTransceiver(reader, Transceivers[TransceiverCount])) {
+            return false;
+        }
+    }
+
+    // anything after the fields we know about is ignored, as msgpack-c would.
+    for (uint32_t i = 5; i < fieldCount; i++) {
+        if (!reader.skip()) {
+            return false;
+        }
+    }
+    return true;
+}
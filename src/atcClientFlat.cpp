@@ -136,6 +136,30 @@ AFV_NATIVE_API bool ATCClient_GetEnableInputFilters(ATCClientHandle handle) {
     return handle->impl->GetEnableInputFilters();
 }
 
+AFV_NATIVE_API void ATCClient_SetJitterLatencyMode(ATCClientHandle handle, afv_native::JitterLatencyMode mode) {
+    handle->impl->SetJitterLatencyMode(mode);
+}
+
+AFV_NATIVE_API void ATCClient_SetEnableTransmitFec(ATCClientHandle handle, bool enable, int expectedLossPercent) {
+    handle->impl->SetEnableTransmitFec(enable, expectedLossPercent);
+}
+
+AFV_NATIVE_API bool ATCClient_GetStreamJitterStatistics(ATCClientHandle handle, char *callsign, afv_native::JitterStatistics *statsOut) {
+    return handle->impl->GetStreamJitterStatistics(callsign, *statsOut);
+}
+
+AFV_NATIVE_API void ATCClient_GetFrequencyJitterStatistics(ATCClientHandle handle, unsigned int freq, afv_native::JitterStatistics *statsOut) {
+    *statsOut = handle->impl->GetFrequencyJitterStatistics(freq);
+}
+
+AFV_NATIVE_API void ATCClient_SetMaxReceiveStreams(ATCClientHandle handle, unsigned int maxStreams) {
+    handle->impl->SetMaxReceiveStreams(maxStreams);
+}
+
+AFV_NATIVE_API void ATCClient_GetStreamPoolStatistics(ATCClientHandle handle, afv_native::StreamPoolStatistics *statsOut) {
+    *statsOut = handle->impl->GetStreamPoolStatistics();
+}
+
 AFV_NATIVE_API void ATCClient_StartAudio(ATCClientHandle handle) {
     handle->impl->StartAudio();
 }
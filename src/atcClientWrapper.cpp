@@ -60,18 +60,23 @@ afv_native::api::atcClient::atcClient(std::string clientName, std::string resour
     WSAStartup(wVersionRequested, &wsaData);
 #endif
 
+    // events are added from the API and audio threads while the event thread is blocked in the
+    // loop, so the base needs locking and must be woken up when that happens.
+#ifdef WIN32
+    evthread_use_windows_threads();
+#else
+    evthread_use_pthreads();
+#endif
     ev_base = event_base_new();
 
     client = std::make_unique<afv_native::ATCClient>(ev_base, resourcePath, clientName, baseURL);
 
+    // the loop blocks waiting for events, rather than polling, so that voice packets are handled
+    // as soon as they arrive.  It keeps waiting while there's nothing scheduled, until the
+    // destructor breaks it.
     eventThread = std::make_unique<std::thread>([this] {
         while (!requestLoopExit) {
-            event_base_loop(ev_base, EVLOOP_NONBLOCK);
-#ifdef WIN32
-            Sleep(10);
-#else
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-#endif
+            event_base_loop(ev_base, EVLOOP_NO_EXIT_ON_EMPTY);
         }
     });
 
@@ -83,7 +88,11 @@ afv_native::api::atcClient::atcClient(char *clientName, char *resourcePath, char
 }
 
 afv_native::api::atcClient::~atcClient() {
+    // the break is scheduled on the base rather than made directly, as a loopbreak made before the
+    // event thread has started its loop would be forgotten when it does.
     requestLoopExit = true;
+    static const struct timeval now = {0, 0};
+    event_base_once(ev_base, -1, EV_TIMEOUT, [](evutil_socket_t, short, void *base) { event_base_loopbreak(static_cast<struct event_base *>(base)); }, ev_base, &now);
     if (eventThread->joinable()) {
         eventThread->join();
     }
@@ -315,6 +324,37 @@ bool afv_native::api::atcClient::GetEnableInputFilters() const {
     return client->getEnableInputFilters();
 }
 
+void afv_native::api::atcClient::SetJitterLatencyMode(JitterLatencyMode mode) {
+    std::lock_guard<std::mutex> lock(afvMutex);
+    client->setJitterLatencyMode(mode);
+}
+
+void afv_native::api::atcClient::SetEnableTransmitFec(bool enable, int expectedLossPercent) {
+    std::lock_guard<std::mutex> lock(afvMutex);
+    client->setEnableTransmitFec(enable, expectedLossPercent);
+}
+
+bool afv_native::api::atcClient::GetStreamJitterStatistics(std::string callsign, JitterStatistics &statsOut) {
+    return client->getStreamJitterStatistics(callsign, statsOut);
+}
+
+bool afv_native::api::atcClient::GetStreamJitterStatistics(char *callsign, JitterStatistics &statsOut) {
+    return GetStreamJitterStatistics(std::string(callsign), statsOut);
+}
+
+afv_native::JitterStatistics afv_native::api::atcClient::GetFrequencyJitterStatistics(unsigned int freq) {
+    return client->getFrequencyJitterStatistics(freq);
+}
+
+void afv_native::api::atcClient::SetMaxReceiveStreams(unsigned int maxStreams) {
+    std::lock_guard<std::mutex> lock(afvMutex);
+    client->setMaxReceiveStreams(maxStreams);
+}
+
+afv_native::StreamPoolStatistics afv_native::api::atcClient::GetStreamPoolStatistics() {
+    return client->getStreamPoolStatistics();
+}
+
 void afv_native::api::atcClient::StartAudio() {
     std::lock_guard<std::mutex> lock(afvMutex);
     client->startAudio();
@@ -547,7 +587,7 @@ AFV_NATIVE_API void afv_native::api::atcClient::reset() {
 AFV_NATIVE_API std::map<unsigned int, afv_native::SimpleAtcRadioState> afv_native::api::atcClient::getRadioState() {
     std::lock_guard<std::mutex>                             lock(afvMutex);
     std::map<unsigned int, afv_native::SimpleAtcRadioState> state;
-    for (const auto &[freq, radio]: client->getRadioState()) {
+    for (const auto &[freq, radio]: *client->getRadioState()) {
         afv_native::SimpleAtcRadioState radioState;
         radioState.tx                   = radio.tx;
         radioState.rx                   = radio.rx;
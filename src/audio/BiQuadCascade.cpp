@@ -0,0 +1,39 @@
+#include "afv-native/audio/BiQuadCascade.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+using namespace afv_native::audio;
+
+BiQuadCascade::BiQuadCascade():
+    BiQuadCascade(nullptr, 0) {
+}
+
+BiQuadCascade::BiQuadCascade(const BiQuadSection *sections, size_t count):
+    mLanes() {
+    assert(count <= kernels::biquadMaxSections);
+    count = std::min(count, kernels::biquadMaxSections);
+
+    // the spare lanes still get computed, so fill them with sections that pass their input straight
+    // through.  An empty cascade is a single pass-through section.
+    for (size_t k = 0; k < kernels::biquadMaxSections; k++) {
+        const BiQuadSection section = (k < count) ? sections[k] : BiQuadSection{1.0, 0.0, 0.0, 0.0, 0.0};
+        mLanes.b0[k]                = section.b0;
+        mLanes.b1[k]                = section.b1;
+        mLanes.b2[k]                = section.b2;
+        mLanes.a1[k]                = section.a1;
+        mLanes.a2[k]                = section.a2;
+    }
+    mLanes.sections = std::max<size_t>(count, 1);
+    reset();
+}
+
+void BiQuadCascade::process(SampleType *buf, size_t count) {
+    kernels::biquadCascade(mLanes, buf, count);
+}
+
+void BiQuadCascade::reset() {
+    std::fill(std::begin(mLanes.s1), std::end(mLanes.s1), 0.0);
+    std::fill(std::begin(mLanes.s2), std::end(mLanes.s2), 0.0);
+}
@@ -0,0 +1,50 @@
+#include "afv-native/audio/EffectVoice.h"
+#include "afv-native/audio/Kernels.h"
+
+#include <algorithm>
+
+using namespace afv_native::audio;
+
+EffectVoice::EffectVoice():
+    mStorage(), mSamples(nullptr), mLength(0), mPosition(0), mLoop(false), mPlaying(false) {
+}
+
+void EffectVoice::setSample(std::shared_ptr<ISampleStorage> sample, bool loop) {
+    mStorage  = std::move(sample);
+    mSamples  = mStorage ? mStorage->data() : nullptr;
+    mLength   = mStorage ? mStorage->lengthInSamples() : 0;
+    mPosition = 0;
+    mLoop     = loop;
+    mPlaying  = false;
+}
+
+void EffectVoice::start() {
+    mPosition = 0;
+    mPlaying  = (mSamples != nullptr && mLength > 0);
+}
+
+void EffectVoice::stop() {
+    mPlaying = false;
+}
+
+void EffectVoice::mixFrame(SampleType *bufferOut, float gain) {
+    if (!mPlaying) {
+        return;
+    }
+    size_t mixed = 0;
+    while (mixed < frameSizeSamples) {
+        if (mPosition >= mLength) {
+            if (!mLoop) {
+                break;
+            }
+            mPosition = 0;
+        }
+        const size_t count = std::min<size_t>(frameSizeSamples - mixed, mLength - mPosition);
+        kernels::mix(bufferOut + mixed, mSamples + mPosition, gain, count);
+        mPosition += count;
+        mixed += count;
+    }
+    if (!mLoop && mPosition >= mLength) {
+        mPlaying = false;
+    }
+}
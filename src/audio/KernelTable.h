@@ -0,0 +1,66 @@
+#pragma once
+#include "afv-native/audio/Kernels.h"
+#include "afv-native/audio/audio_params.h"
+#include "afv-native/utility.h"
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define AFV_KERNELS_X86 1
+#else
+#define AFV_KERNELS_X86 0
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define AFV_KERNELS_NEON 1
+#else
+#define AFV_KERNELS_NEON 0
+#endif
+
+namespace afv_native { namespace audio { namespace kernels {
+    /** KernelTable is one implementation of every kernel in afv-native/audio/Kernels.h. */
+    struct KernelTable {
+        const char *name;
+        void (*mix)(SampleType *RESTRICT dst, const SampleType *RESTRICT src, float gain, size_t count);
+        void (*scale)(SampleType *buf, float gain, size_t count);
+        void (*gainClamp)(SampleType *buf, float gain, size_t count);
+        SampleType (*peak)(const SampleType *buf, size_t count);
+        void (*interleave)(const SampleType *RESTRICT left, const SampleType *RESTRICT right, SampleType *RESTRICT out, size_t count);
+        void (*floatToInt16)(int16_t *RESTRICT dst, const SampleType *RESTRICT src, size_t count);
+        void (*int16ToFloat)(SampleType *RESTRICT dst, const int16_t *RESTRICT src, size_t count);
+        void (*biquadCascade)(BiQuadLanes &lanes, SampleType *buf, size_t count);
+    };
+
+    /** BiQuadSteadyFn runs steps first to last-1 of a biquadCascade, where every section is busy.
+     * y holds the output of each lane from the previous step, and is updated to match the last.
+     */
+    typedef void (*BiQuadSteadyFn)(BiQuadLanes &lanes, double *y, SampleType *buf, size_t first, size_t last);
+
+    /* The scalar kernels are also used by the vector implementations to finish off any samples
+     * left over after the last full vector.
+     */
+    namespace scalar {
+        void       mix(SampleType *RESTRICT dst, const SampleType *RESTRICT src, float gain, size_t count);
+        void       scale(SampleType *buf, float gain, size_t count);
+        void       gainClamp(SampleType *buf, float gain, size_t count);
+        SampleType peak(const SampleType *buf, size_t count);
+        void       interleave(const SampleType *RESTRICT left, const SampleType *RESTRICT right, SampleType *RESTRICT out, size_t count);
+        void       floatToInt16(int16_t *RESTRICT dst, const SampleType *RESTRICT src, size_t count);
+        void       int16ToFloat(SampleType *RESTRICT dst, const int16_t *RESTRICT src, size_t count);
+        void       biquadCascade(BiQuadLanes &lanes, SampleType *buf, size_t count);
+
+        /** biquadCascadeWith runs a biquadCascade, using steady for the steps where the chain is
+         * full, and scalar code to fill and drain it.
+         */
+        void biquadCascadeWith(BiQuadLanes &lanes, SampleType *buf, size_t count, BiQuadSteadyFn steady);
+    } // namespace scalar
+
+    extern const KernelTable scalarKernels;
+#if AFV_KERNELS_X86
+    extern const KernelTable sse2Kernels;
+    extern const KernelTable avx2Kernels;
+#endif
+#if AFV_KERNELS_NEON
+    extern const KernelTable neonKernels;
+#endif
+}}} // namespace afv_native::audio::kernels
@@ -0,0 +1,248 @@
+#include "afv-native/audio/Kernels.h"
+#include "afv-native/Log.h"
+#include "KernelTable.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <new>
+
+#if AFV_KERNELS_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace afv_native::audio;
+using namespace afv_native::audio::kernels;
+
+void scalar::mix(SampleType *RESTRICT dst, const SampleType *RESTRICT src, float gain, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] += (gain * src[i]);
+    }
+}
+
+void scalar::scale(SampleType *buf, float gain, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        buf[i] *= gain;
+    }
+}
+
+void scalar::gainClamp(SampleType *buf, float gain, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        SampleType value = buf[i] * gain;
+        if (value > 1.0f) {
+            value = 1.0f;
+        }
+        if (value < -1.0f) {
+            value = -1.0f;
+        }
+        if (std::isnan(value)) {
+            value = 0.0f;
+        }
+        buf[i] = value;
+    }
+}
+
+SampleType scalar::peak(const SampleType *buf, size_t count) {
+    SampleType peak = std::fabs(buf[0]);
+    for (size_t i = 1; i < count; i++) {
+        peak = std::max<SampleType>(peak, std::fabs(buf[i]));
+    }
+    return peak;
+}
+
+void scalar::interleave(const SampleType *RESTRICT left, const SampleType *RESTRICT right, SampleType *RESTRICT out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[2 * i]     = left[i];
+        out[2 * i + 1] = right[i];
+    }
+}
+
+void scalar::floatToInt16(int16_t *RESTRICT dst, const SampleType *RESTRICT src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        SampleType value = src[i] * 32767.0f;
+        if (value > 32767.0f) {
+            value = 32767.0f;
+        }
+        if (value < -32768.0f) {
+            value = -32768.0f;
+        }
+        dst[i] = static_cast<int16_t>(value);
+    }
+}
+
+void scalar::int16ToFloat(SampleType *RESTRICT dst, const int16_t *RESTRICT src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = static_cast<SampleType>(src[i]) / 32768.0f;
+    }
+}
+
+/** biquadRamp runs steps first to last-1 of a biquadCascade one lane at a time, skipping the
+ * lanes that don't have a sample to work on in that step.
+ */
+static void biquadRamp(BiQuadLanes &lanes, double *y, SampleType *buf, size_t count, size_t first, size_t last) {
+    const size_t sections = lanes.sections;
+    for (size_t step = first; step < last; step++) {
+        // lane k works on sample step-k, if there is one.
+        const size_t firstLane = (step >= count) ? (step - count + 1) : 0;
+        const size_t lastLane  = std::min(step, sections - 1);
+        // go backwards, so each lane still sees the output its predecessor made in the last step.
+        for (size_t k = lastLane + 1; k-- > firstLane;) {
+            const double in  = (k == 0) ? buf[step] : y[k - 1];
+            const double out = lanes.b0[k] * in + lanes.s1[k];
+            lanes.s1[k]      = lanes.b1[k] * in - lanes.a1[k] * out + lanes.s2[k];
+            lanes.s2[k]      = lanes.b2[k] * in - lanes.a2[k] * out;
+            y[k]             = out;
+        }
+        if (step >= sections - 1) {
+            buf[step - (sections - 1)] = static_cast<SampleType>(y[sections - 1]);
+        }
+    }
+}
+
+// every lane is busy in the steady steps, so biquadRamp never skips any there.
+static void scalarBiquadSteady(BiQuadLanes &lanes, double *y, SampleType *buf, size_t first, size_t last) {
+    biquadRamp(lanes, y, buf, last, first, last);
+}
+
+void scalar::biquadCascadeWith(BiQuadLanes &lanes, SampleType *buf, size_t count, BiQuadSteadyFn steady) {
+    if (count == 0) {
+        return;
+    }
+    alignas(bufferAlignment) double y[biquadMaxSections] = {};
+
+    // the chain takes sections-1 steps to fill, and as many again to drain after the last input.
+    const size_t fill      = lanes.sections - 1;
+    const size_t steadyEnd = std::max(count, fill);
+    biquadRamp(lanes, y, buf, count, 0, fill);
+    steady(lanes, y, buf, fill, steadyEnd);
+    biquadRamp(lanes, y, buf, count, steadyEnd, count + fill);
+}
+
+void scalar::biquadCascade(BiQuadLanes &lanes, SampleType *buf, size_t count) {
+    biquadCascadeWith(lanes, buf, count, scalarBiquadSteady);
+}
+
+const KernelTable afv_native::audio::kernels::scalarKernels = {
+    "scalar",
+    scalar::mix,
+    scalar::scale,
+    scalar::gainClamp,
+    scalar::peak,
+    scalar::interleave,
+    scalar::floatToInt16,
+    scalar::int16ToFloat,
+    scalar::biquadCascade,
+};
+
+#if AFV_KERNELS_X86
+static bool cpuSupportsAvx2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    // AVX2 is only usable if the OS saves the YMM registers on a context switch.
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx     = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+static const KernelTable &selectKernels() {
+#if AFV_KERNELS_X86
+    return cpuSupportsAvx2() ? avx2Kernels : sse2Kernels;
+#elif AFV_KERNELS_NEON
+    return neonKernels;
+#else
+    return scalarKernels;
+#endif
+}
+
+static std::atomic<const KernelTable *> gActiveKernels(nullptr);
+
+void afv_native::audio::kernels::selectImplementation() {
+    if (gActiveKernels.load(std::memory_order_acquire) != nullptr) {
+        return;
+    }
+    const KernelTable *table    = &selectKernels();
+    const KernelTable *expected = nullptr;
+    if (gActiveKernels.compare_exchange_strong(expected, table, std::memory_order_acq_rel)) {
+        LOG("kernels", "Using %s audio kernels", table->name);
+    }
+}
+
+static const KernelTable &activeKernels() {
+    const KernelTable *table = gActiveKernels.load(std::memory_order_acquire);
+    if (table == nullptr) {
+        // nobody selected them up front, so pay for it here.
+        selectImplementation();
+        table = gActiveKernels.load(std::memory_order_acquire);
+    }
+    return *table;
+}
+
+void afv_native::audio::kernels::mix(SampleType *RESTRICT dst, const SampleType *RESTRICT src, float gain, size_t count) {
+    activeKernels().mix(dst, src, gain, count);
+}
+
+void afv_native::audio::kernels::scale(SampleType *buf, float gain, size_t count) {
+    activeKernels().scale(buf, gain, count);
+}
+
+void afv_native::audio::kernels::gainClamp(SampleType *buf, float gain, size_t count) {
+    activeKernels().gainClamp(buf, gain, count);
+}
+
+SampleType afv_native::audio::kernels::peak(const SampleType *buf, size_t count) {
+    return activeKernels().peak(buf, count);
+}
+
+void afv_native::audio::kernels::interleave(const SampleType *RESTRICT left, const SampleType *RESTRICT right, SampleType *RESTRICT out, size_t count) {
+    activeKernels().interleave(left, right, out, count);
+}
+
+void afv_native::audio::kernels::floatToInt16(int16_t *RESTRICT dst, const SampleType *RESTRICT src, size_t count) {
+    activeKernels().floatToInt16(dst, src, count);
+}
+
+void afv_native::audio::kernels::int16ToFloat(SampleType *RESTRICT dst, const int16_t *RESTRICT src, size_t count) {
+    activeKernels().int16ToFloat(dst, src, count);
+}
+
+void afv_native::audio::kernels::biquadCascade(BiQuadLanes &lanes, SampleType *buf, size_t count) {
+    activeKernels().biquadCascade(lanes, buf, count);
+}
+
+const char *afv_native::audio::kernels::implementationName() {
+    return activeKernels().name;
+}
+
+SampleType *afv_native::audio::kernels::allocateAligned(size_t count) {
+    // over-allocate so we can align the buffer, and stash the original pointer just before it.
+    const size_t bytes = count * sizeof(SampleType);
+    auto        *raw   = static_cast<unsigned char *>(::operator new(bytes + bufferAlignment + sizeof(void *)));
+    uintptr_t    addr  = reinterpret_cast<uintptr_t>(raw + sizeof(void *));
+    addr               = (addr + bufferAlignment - 1) & ~static_cast<uintptr_t>(bufferAlignment - 1);
+    auto *aligned      = reinterpret_cast<void **>(addr);
+    aligned[-1]        = raw;
+    ::memset(aligned, 0, bytes);
+    return reinterpret_cast<SampleType *>(aligned);
+}
+
+void afv_native::audio::kernels::freeAligned(SampleType *buf) {
+    if (buf == nullptr) {
+        return;
+    }
+    ::operator delete(reinterpret_cast<void **>(buf)[-1]);
+}
@@ -0,0 +1,167 @@
+#include "KernelTable.h"
+
+#if AFV_KERNELS_X86
+#include <algorithm>
+#include <immintrin.h>
+
+/* This file is built without any special compiler flags, so that the library still loads on
+ * CPUs without AVX2.  GCC and Clang need each function marked as targeting AVX2 instead;
+ * MSVC allows the intrinsics anywhere.  These kernels are only called once Kernels.cpp has
+ * checked that the CPU supports them.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define AFV_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define AFV_TARGET_AVX2
+#endif
+
+using namespace afv_native::audio;
+using namespace afv_native::audio::kernels;
+
+AFV_TARGET_AVX2 static void avx2Mix(SampleType *RESTRICT dst, const SampleType *RESTRICT src, float gain, size_t count) {
+    const __m256 vgain = _mm256_set1_ps(gain);
+    size_t       i     = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 d = _mm256_loadu_ps(dst + i);
+        d        = _mm256_add_ps(d, _mm256_mul_ps(vgain, _mm256_loadu_ps(src + i)));
+        _mm256_storeu_ps(dst + i, d);
+    }
+    scalar::mix(dst + i, src + i, gain, count - i);
+}
+
+AFV_TARGET_AVX2 static void avx2Scale(SampleType *buf, float gain, size_t count) {
+    const __m256 vgain = _mm256_set1_ps(gain);
+    size_t       i     = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(buf + i, _mm256_mul_ps(_mm256_loadu_ps(buf + i), vgain));
+    }
+    scalar::scale(buf + i, gain, count - i);
+}
+
+AFV_TARGET_AVX2 static void avx2GainClamp(SampleType *buf, float gain, size_t count) {
+    const __m256 vgain = _mm256_set1_ps(gain);
+    const __m256 vmax  = _mm256_set1_ps(1.0f);
+    const __m256 vmin  = _mm256_set1_ps(-1.0f);
+    size_t       i     = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 v = _mm256_mul_ps(_mm256_loadu_ps(buf + i), vgain);
+        // NaN is unordered with itself, so this zeroes it - vminps would turn it into 1.0.
+        v = _mm256_and_ps(v, _mm256_cmp_ps(v, v, _CMP_ORD_Q));
+        v = _mm256_max_ps(_mm256_min_ps(v, vmax), vmin);
+        _mm256_storeu_ps(buf + i, v);
+    }
+    scalar::gainClamp(buf + i, gain, count - i);
+}
+
+AFV_TARGET_AVX2 static SampleType avx2Peak(const SampleType *buf, size_t count) {
+    if (count < 8) {
+        return scalar::peak(buf, count);
+    }
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256       vpeak   = _mm256_and_ps(_mm256_loadu_ps(buf), absMask);
+    size_t       i       = 8;
+    for (; i + 8 <= count; i += 8) {
+        vpeak = _mm256_max_ps(vpeak, _mm256_and_ps(_mm256_loadu_ps(buf + i), absMask));
+    }
+    __m128 half = _mm_max_ps(_mm256_castps256_ps128(vpeak), _mm256_extractf128_ps(vpeak, 1));
+    half        = _mm_max_ps(half, _mm_shuffle_ps(half, half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half        = _mm_max_ps(half, _mm_shuffle_ps(half, half, _MM_SHUFFLE(2, 3, 0, 1)));
+    SampleType peak = _mm_cvtss_f32(half);
+    if (i < count) {
+        peak = std::max(peak, scalar::peak(buf + i, count - i));
+    }
+    return peak;
+}
+
+AFV_TARGET_AVX2 static void avx2Interleave(const SampleType *RESTRICT left, const SampleType *RESTRICT right, SampleType *RESTRICT out, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 l  = _mm256_loadu_ps(left + i);
+        const __m256 r  = _mm256_loadu_ps(right + i);
+        // unpack works within each 128-bit lane, so the halves need swapping back into order.
+        const __m256 lo = _mm256_unpacklo_ps(l, r);
+        const __m256 hi = _mm256_unpackhi_ps(l, r);
+        _mm256_storeu_ps(out + 2 * i, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(out + 2 * i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    scalar::interleave(left + i, right + i, out + 2 * i, count - i);
+}
+
+AFV_TARGET_AVX2 static void avx2FloatToInt16(int16_t *RESTRICT dst, const SampleType *RESTRICT src, size_t count) {
+    const __m256 vscale = _mm256_set1_ps(32767.0f);
+    const __m256 vmax   = _mm256_set1_ps(32767.0f);
+    const __m256 vmin   = _mm256_set1_ps(-32768.0f);
+    size_t       i      = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256 a = _mm256_mul_ps(_mm256_loadu_ps(src + i), vscale);
+        __m256 b = _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), vscale);
+        a        = _mm256_max_ps(_mm256_min_ps(a, vmax), vmin);
+        b        = _mm256_max_ps(_mm256_min_ps(b, vmax), vmin);
+        // packs also works per 128-bit lane, leaving the 64-bit quarters in 0, 2, 1, 3 order.
+        __m256i packed = _mm256_packs_epi32(_mm256_cvttps_epi32(a), _mm256_cvttps_epi32(b));
+        packed         = _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packed);
+    }
+    scalar::floatToInt16(dst + i, src + i, count - i);
+}
+
+AFV_TARGET_AVX2 static void avx2Int16ToFloat(SampleType *RESTRICT dst, const int16_t *RESTRICT src, size_t count) {
+    const __m256 vscale = _mm256_set1_ps(1.0f / 32768.0f);
+    size_t       i      = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i in = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(in), vscale));
+    }
+    scalar::int16ToFloat(dst + i, src + i, count - i);
+}
+
+/** avx2BiquadQuad advances the four biquadCascade lanes starting at lane by one step. */
+AFV_TARGET_AVX2 static inline __m256d avx2BiquadQuad(const BiQuadLanes &lanes, size_t lane, __m256d in, __m256d &s1, __m256d &s2) {
+    const __m256d out = _mm256_add_pd(_mm256_mul_pd(_mm256_load_pd(lanes.b0 + lane), in), s1);
+    s1 = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(_mm256_load_pd(lanes.b1 + lane), in), _mm256_mul_pd(_mm256_load_pd(lanes.a1 + lane), out)), s2);
+    s2 = _mm256_sub_pd(_mm256_mul_pd(_mm256_load_pd(lanes.b2 + lane), in), _mm256_mul_pd(_mm256_load_pd(lanes.a2 + lane), out));
+    return out;
+}
+
+AFV_TARGET_AVX2 static void avx2BiquadSteady(BiQuadLanes &lanes, double *y, SampleType *buf, size_t first, size_t last) {
+    static_assert(biquadMaxSections == 8, "avx2BiquadSteady handles exactly two vectors of lanes");
+    const size_t outLane = lanes.sections - 1;
+    __m256d      outLo = _mm256_load_pd(y), outHi = _mm256_load_pd(y + 4);
+    __m256d      s1Lo = _mm256_load_pd(lanes.s1), s1Hi = _mm256_load_pd(lanes.s1 + 4);
+    __m256d      s2Lo = _mm256_load_pd(lanes.s2), s2Hi = _mm256_load_pd(lanes.s2 + 4);
+    for (size_t step = first; step < last; step++) {
+        // every lane takes the previous output of the lane before it, and lane 0 the next sample.
+        // Rotating each vector up by one lane leaves lanes 3 and 7 at the bottom to be replaced.
+        const __m256d rotLo = _mm256_permute4x64_pd(outLo, _MM_SHUFFLE(2, 1, 0, 3));
+        const __m256d rotHi = _mm256_permute4x64_pd(outHi, _MM_SHUFFLE(2, 1, 0, 3));
+        const __m256d inLo  = _mm256_blend_pd(rotLo, _mm256_set1_pd(buf[step]), 0x1);
+        const __m256d inHi  = _mm256_blend_pd(rotHi, rotLo, 0x1);
+
+        outLo = avx2BiquadQuad(lanes, 0, inLo, s1Lo, s2Lo);
+        outHi = avx2BiquadQuad(lanes, 4, inHi, s1Hi, s2Hi);
+        _mm256_store_pd(y, outLo);
+        _mm256_store_pd(y + 4, outHi);
+        buf[step - outLane] = static_cast<SampleType>(y[outLane]);
+    }
+    _mm256_store_pd(lanes.s1, s1Lo);
+    _mm256_store_pd(lanes.s1 + 4, s1Hi);
+    _mm256_store_pd(lanes.s2, s2Lo);
+    _mm256_store_pd(lanes.s2 + 4, s2Hi);
+}
+
+AFV_TARGET_AVX2 static void avx2BiquadCascade(BiQuadLanes &lanes, SampleType *buf, size_t count) {
+    scalar::biquadCascadeWith(lanes, buf, count, avx2BiquadSteady);
+}
+
+const KernelTable afv_native::audio::kernels::avx2Kernels = {
+    "avx2",
+    avx2Mix,
+    avx2Scale,
+    avx2GainClamp,
+    avx2Peak,
+    avx2Interleave,
+    avx2FloatToInt16,
+    avx2Int16ToFloat,
+    avx2BiquadCascade,
+};
+#endif
@@ -0,0 +1,151 @@
+#include "KernelTable.h"
+
+#if AFV_KERNELS_NEON
+#include <algorithm>
+#include <arm_neon.h>
+
+using namespace afv_native::audio;
+using namespace afv_native::audio::kernels;
+
+static void neonMix(SampleType *RESTRICT dst, const SampleType *RESTRICT src, float gain, size_t count) {
+    const float32x4_t vgain = vdupq_n_f32(gain);
+    size_t            i     = 0;
+    for (; i + 4 <= count; i += 4) {
+        // keep the multiply and add separate so the result matches the other implementations.
+        const float32x4_t d = vaddq_f32(vld1q_f32(dst + i), vmulq_f32(vgain, vld1q_f32(src + i)));
+        vst1q_f32(dst + i, d);
+    }
+    scalar::mix(dst + i, src + i, gain, count - i);
+}
+
+static void neonScale(SampleType *buf, float gain, size_t count) {
+    const float32x4_t vgain = vdupq_n_f32(gain);
+    size_t            i     = 0;
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(buf + i, vmulq_f32(vld1q_f32(buf + i), vgain));
+    }
+    scalar::scale(buf + i, gain, count - i);
+}
+
+static void neonGainClamp(SampleType *buf, float gain, size_t count) {
+    const float32x4_t vgain = vdupq_n_f32(gain);
+    const float32x4_t vmax  = vdupq_n_f32(1.0f);
+    const float32x4_t vmin  = vdupq_n_f32(-1.0f);
+    size_t            i     = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t v = vmulq_f32(vld1q_f32(buf + i), vgain);
+        // NaN never equals itself, so this zeroes it.
+        v = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(v), vceqq_f32(v, v)));
+        v = vmaxq_f32(vminq_f32(v, vmax), vmin);
+        vst1q_f32(buf + i, v);
+    }
+    scalar::gainClamp(buf + i, gain, count - i);
+}
+
+static SampleType neonPeak(const SampleType *buf, size_t count) {
+    if (count < 4) {
+        return scalar::peak(buf, count);
+    }
+    float32x4_t vpeak = vabsq_f32(vld1q_f32(buf));
+    size_t      i     = 4;
+    for (; i + 4 <= count; i += 4) {
+        vpeak = vmaxq_f32(vpeak, vabsq_f32(vld1q_f32(buf + i)));
+    }
+    SampleType peak = vmaxvq_f32(vpeak);
+    if (i < count) {
+        peak = std::max(peak, scalar::peak(buf + i, count - i));
+    }
+    return peak;
+}
+
+static void neonInterleave(const SampleType *RESTRICT left, const SampleType *RESTRICT right, SampleType *RESTRICT out, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4x2_t pair;
+        pair.val[0] = vld1q_f32(left + i);
+        pair.val[1] = vld1q_f32(right + i);
+        vst2q_f32(out + 2 * i, pair);
+    }
+    scalar::interleave(left + i, right + i, out + 2 * i, count - i);
+}
+
+static void neonFloatToInt16(int16_t *RESTRICT dst, const SampleType *RESTRICT src, size_t count) {
+    const float32x4_t vscale = vdupq_n_f32(32767.0f);
+    const float32x4_t vmax   = vdupq_n_f32(32767.0f);
+    const float32x4_t vmin   = vdupq_n_f32(-32768.0f);
+    size_t            i      = 0;
+    for (; i + 8 <= count; i += 8) {
+        float32x4_t a = vmulq_f32(vld1q_f32(src + i), vscale);
+        float32x4_t b = vmulq_f32(vld1q_f32(src + i + 4), vscale);
+        a             = vmaxq_f32(vminq_f32(a, vmax), vmin);
+        b             = vmaxq_f32(vminq_f32(b, vmax), vmin);
+        // vcvtq_s32_f32 rounds towards zero, the same as a static_cast.
+        const int16x8_t packed = vcombine_s16(vqmovn_s32(vcvtq_s32_f32(a)), vqmovn_s32(vcvtq_s32_f32(b)));
+        vst1q_s16(dst + i, packed);
+    }
+    scalar::floatToInt16(dst + i, src + i, count - i);
+}
+
+static void neonInt16ToFloat(SampleType *RESTRICT dst, const int16_t *RESTRICT src, size_t count) {
+    const float32x4_t vscale = vdupq_n_f32(1.0f / 32768.0f);
+    size_t            i      = 0;
+    for (; i + 8 <= count; i += 8) {
+        const int16x8_t in = vld1q_s16(src + i);
+        vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(in))), vscale));
+        vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(in))), vscale));
+    }
+    scalar::int16ToFloat(dst + i, src + i, count - i);
+}
+
+/** neonBiquadPair advances the pair of biquadCascade lanes starting at lane by one step. */
+static inline float64x2_t neonBiquadPair(const BiQuadLanes &lanes, size_t lane, float64x2_t in, float64x2_t &s1, float64x2_t &s2) {
+    const float64x2_t out = vaddq_f64(vmulq_f64(vld1q_f64(lanes.b0 + lane), in), s1);
+    s1 = vaddq_f64(vsubq_f64(vmulq_f64(vld1q_f64(lanes.b1 + lane), in), vmulq_f64(vld1q_f64(lanes.a1 + lane), out)), s2);
+    s2 = vsubq_f64(vmulq_f64(vld1q_f64(lanes.b2 + lane), in), vmulq_f64(vld1q_f64(lanes.a2 + lane), out));
+    return out;
+}
+
+static void neonBiquadSteady(BiQuadLanes &lanes, double *y, SampleType *buf, size_t first, size_t last) {
+    const size_t pairs   = biquadMaxSections / 2;
+    const size_t outLane = lanes.sections - 1;
+    float64x2_t  out[pairs], s1[pairs], s2[pairs];
+    for (size_t j = 0; j < pairs; j++) {
+        out[j] = vld1q_f64(y + 2 * j);
+        s1[j]  = vld1q_f64(lanes.s1 + 2 * j);
+        s2[j]  = vld1q_f64(lanes.s2 + 2 * j);
+    }
+    for (size_t step = first; step < last; step++) {
+        // every lane takes the previous output of the lane before it, and lane 0 the next sample.
+        float64x2_t in[pairs];
+        in[0] = vextq_f64(vdupq_n_f64(buf[step]), out[0], 1);
+        for (size_t j = 1; j < pairs; j++) {
+            in[j] = vextq_f64(out[j - 1], out[j], 1);
+        }
+        for (size_t j = 0; j < pairs; j++) {
+            out[j] = neonBiquadPair(lanes, 2 * j, in[j], s1[j], s2[j]);
+            vst1q_f64(y + 2 * j, out[j]);
+        }
+        buf[step - outLane] = static_cast<SampleType>(y[outLane]);
+    }
+    for (size_t j = 0; j < pairs; j++) {
+        vst1q_f64(lanes.s1 + 2 * j, s1[j]);
+        vst1q_f64(lanes.s2 + 2 * j, s2[j]);
+    }
+}
+
+static void neonBiquadCascade(BiQuadLanes &lanes, SampleType *buf, size_t count) {
+    scalar::biquadCascadeWith(lanes, buf, count, neonBiquadSteady);
+}
+
+const KernelTable afv_native::audio::kernels::neonKernels = {
+    "neon",
+    neonMix,
+    neonScale,
+    neonGainClamp,
+    neonPeak,
+    neonInterleave,
+    neonFloatToInt16,
+    neonInt16ToFloat,
+    neonBiquadCascade,
+};
+#endif
@@ -0,0 +1,156 @@
+#include "KernelTable.h"
+
+#if AFV_KERNELS_X86
+#include <algorithm>
+#include <emmintrin.h>
+
+using namespace afv_native::audio;
+using namespace afv_native::audio::kernels;
+
+static void sse2Mix(SampleType *RESTRICT dst, const SampleType *RESTRICT src, float gain, size_t count) {
+    const __m128 vgain = _mm_set1_ps(gain);
+    size_t       i     = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 d = _mm_loadu_ps(dst + i);
+        d        = _mm_add_ps(d, _mm_mul_ps(vgain, _mm_loadu_ps(src + i)));
+        _mm_storeu_ps(dst + i, d);
+    }
+    scalar::mix(dst + i, src + i, gain, count - i);
+}
+
+static void sse2Scale(SampleType *buf, float gain, size_t count) {
+    const __m128 vgain = _mm_set1_ps(gain);
+    size_t       i     = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(buf + i, _mm_mul_ps(_mm_loadu_ps(buf + i), vgain));
+    }
+    scalar::scale(buf + i, gain, count - i);
+}
+
+static void sse2GainClamp(SampleType *buf, float gain, size_t count) {
+    const __m128 vgain = _mm_set1_ps(gain);
+    const __m128 vmax  = _mm_set1_ps(1.0f);
+    const __m128 vmin  = _mm_set1_ps(-1.0f);
+    size_t       i     = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(buf + i), vgain);
+        // NaN is unordered with itself, so this zeroes it - minps would turn it into 1.0.
+        v = _mm_and_ps(v, _mm_cmpord_ps(v, v));
+        v = _mm_max_ps(_mm_min_ps(v, vmax), vmin);
+        _mm_storeu_ps(buf + i, v);
+    }
+    scalar::gainClamp(buf + i, gain, count - i);
+}
+
+static SampleType sse2Peak(const SampleType *buf, size_t count) {
+    if (count < 4) {
+        return scalar::peak(buf, count);
+    }
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128       vpeak   = _mm_and_ps(_mm_loadu_ps(buf), absMask);
+    size_t       i       = 4;
+    for (; i + 4 <= count; i += 4) {
+        vpeak = _mm_max_ps(vpeak, _mm_and_ps(_mm_loadu_ps(buf + i), absMask));
+    }
+    vpeak = _mm_max_ps(vpeak, _mm_shuffle_ps(vpeak, vpeak, _MM_SHUFFLE(1, 0, 3, 2)));
+    vpeak = _mm_max_ps(vpeak, _mm_shuffle_ps(vpeak, vpeak, _MM_SHUFFLE(2, 3, 0, 1)));
+    SampleType peak = _mm_cvtss_f32(vpeak);
+    if (i < count) {
+        peak = std::max(peak, scalar::peak(buf + i, count - i));
+    }
+    return peak;
+}
+
+static void sse2Interleave(const SampleType *RESTRICT left, const SampleType *RESTRICT right, SampleType *RESTRICT out, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 l = _mm_loadu_ps(left + i);
+        const __m128 r = _mm_loadu_ps(right + i);
+        _mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(l, r));
+    }
+    scalar::interleave(left + i, right + i, out + 2 * i, count - i);
+}
+
+static void sse2FloatToInt16(int16_t *RESTRICT dst, const SampleType *RESTRICT src, size_t count) {
+    const __m128 vscale = _mm_set1_ps(32767.0f);
+    const __m128 vmax   = _mm_set1_ps(32767.0f);
+    const __m128 vmin   = _mm_set1_ps(-32768.0f);
+    size_t       i      = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(src + i), vscale);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(src + i + 4), vscale);
+        a        = _mm_max_ps(_mm_min_ps(a, vmax), vmin);
+        b        = _mm_max_ps(_mm_min_ps(b, vmax), vmin);
+        const __m128i packed = _mm_packs_epi32(_mm_cvttps_epi32(a), _mm_cvttps_epi32(b));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), packed);
+    }
+    scalar::floatToInt16(dst + i, src + i, count - i);
+}
+
+static void sse2Int16ToFloat(SampleType *RESTRICT dst, const int16_t *RESTRICT src, size_t count) {
+    const __m128 vscale = _mm_set1_ps(1.0f / 32768.0f);
+    size_t       i      = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        // sign-extend to 32 bits by unpacking into the top half and shifting back down.
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(in, in), 16);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), vscale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), vscale));
+    }
+    scalar::int16ToFloat(dst + i, src + i, count - i);
+}
+
+/** sse2BiquadPair advances the pair of biquadCascade lanes starting at lane by one step. */
+static inline __m128d sse2BiquadPair(const BiQuadLanes &lanes, size_t lane, __m128d in, __m128d &s1, __m128d &s2) {
+    const __m128d out = _mm_add_pd(_mm_mul_pd(_mm_load_pd(lanes.b0 + lane), in), s1);
+    s1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(_mm_load_pd(lanes.b1 + lane), in), _mm_mul_pd(_mm_load_pd(lanes.a1 + lane), out)), s2);
+    s2 = _mm_sub_pd(_mm_mul_pd(_mm_load_pd(lanes.b2 + lane), in), _mm_mul_pd(_mm_load_pd(lanes.a2 + lane), out));
+    return out;
+}
+
+static void sse2BiquadSteady(BiQuadLanes &lanes, double *y, SampleType *buf, size_t first, size_t last) {
+    const size_t pairs   = biquadMaxSections / 2;
+    const size_t outLane = lanes.sections - 1;
+    __m128d      out[pairs], s1[pairs], s2[pairs];
+    for (size_t j = 0; j < pairs; j++) {
+        out[j] = _mm_load_pd(y + 2 * j);
+        s1[j]  = _mm_load_pd(lanes.s1 + 2 * j);
+        s2[j]  = _mm_load_pd(lanes.s2 + 2 * j);
+    }
+    for (size_t step = first; step < last; step++) {
+        // every lane takes the previous output of the lane before it, and lane 0 the next sample.
+        __m128d in[pairs];
+        in[0] = _mm_unpacklo_pd(_mm_set_sd(buf[step]), out[0]);
+        for (size_t j = 1; j < pairs; j++) {
+            in[j] = _mm_shuffle_pd(out[j - 1], out[j], 1);
+        }
+        for (size_t j = 0; j < pairs; j++) {
+            out[j] = sse2BiquadPair(lanes, 2 * j, in[j], s1[j], s2[j]);
+            _mm_store_pd(y + 2 * j, out[j]);
+        }
+        buf[step - outLane] = static_cast<SampleType>(y[outLane]);
+    }
+    for (size_t j = 0; j < pairs; j++) {
+        _mm_store_pd(lanes.s1 + 2 * j, s1[j]);
+        _mm_store_pd(lanes.s2 + 2 * j, s2[j]);
+    }
+}
+
+static void sse2BiquadCascade(BiQuadLanes &lanes, SampleType *buf, size_t count) {
+    scalar::biquadCascadeWith(lanes, buf, count, sse2BiquadSteady);
+}
+
+const KernelTable afv_native::audio::kernels::sse2Kernels = {
+    "sse2",
+    sse2Mix,
+    sse2Scale,
+    sse2GainClamp,
+    sse2Peak,
+    sse2Interleave,
+    sse2FloatToInt16,
+    sse2Int16ToFloat,
+    sse2BiquadCascade,
+};
+#endif
@@ -1,19 +1,55 @@
 #include "afv-native/audio/OutputDeviceState.h"
+#include "afv-native/audio/Kernels.h"
 
 using namespace afv_native;
 
 OutputDeviceState::OutputDeviceState() {
-    mChannelBuffer     = new audio::SampleType[audio::frameSizeSamples];
-    mMixingBuffer      = new audio::SampleType[audio::frameSizeSamples];
-    mFetchBuffer       = new audio::SampleType[audio::frameSizeSamples];
-    mLeftMixingBuffer  = new audio::SampleType[audio::frameSizeSamples];
-    mRightMixingBuffer = new audio::SampleType[audio::frameSizeSamples];
+    mChannelBuffer     = audio::kernels::allocateAligned(audio::frameSizeSamples);
+    mMixingBuffer      = audio::kernels::allocateAligned(audio::frameSizeSamples);
+    mFetchBuffer       = audio::kernels::allocateAligned(audio::frameSizeSamples);
+    mLeftMixingBuffer  = audio::kernels::allocateAligned(audio::frameSizeSamples);
+    mRightMixingBuffer = audio::kernels::allocateAligned(audio::frameSizeSamples);
 }
 
 OutputDeviceState::~OutputDeviceState() {
-    delete[] mFetchBuffer;
-    delete[] mMixingBuffer;
-    delete[] mLeftMixingBuffer;
-    delete[] mRightMixingBuffer;
-    delete[] mChannelBuffer;
-}
\ No newline at end of file
+    audio::kernels::freeAligned(mFetchBuffer);
+    audio::kernels::freeAligned(mMixingBuffer);
+    audio::kernels::freeAligned(mLeftMixingBuffer);
+    audio::kernels::freeAligned(mRightMixingBuffer);
+    audio::kernels::freeAligned(mChannelBuffer);
+}
+
+uint64_t OutputDeviceState::advanceFrameTick(std::atomic<uint64_t> &latestTick, uint64_t maxLag) {
+    uint64_t latest = latestTick.load(std::memory_order_relaxed);
+    uint64_t tick   = mFrameTick + 1;
+    if (tick + maxLag <= latest) {
+        tick = latest;
+    }
+    // the other output may be moving latestTick on at the same time - it only ever goes forwards.
+    while (tick > latest && !latestTick.compare_exchange_weak(latest, tick, std::memory_order_relaxed)) {
+    }
+    mFrameTick = tick;
+    return tick;
+}
+
+/** toNs converts elapsed to whole nanoseconds. */
+static uint64_t toNs(std::chrono::steady_clock::duration elapsed) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+void OutputDeviceState::addRenderTimings(std::chrono::steady_clock::duration decode, std::chrono::steady_clock::duration radios, std::chrono::steady_clock::duration output) {
+    mDecodeNs.fetch_add(toNs(decode), std::memory_order_relaxed);
+    mRadiosNs.fetch_add(toNs(radios), std::memory_order_relaxed);
+    mOutputNs.fetch_add(toNs(output), std::memory_order_relaxed);
+    mTimedFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+OutputDeviceState::RenderTimings OutputDeviceState::getRenderTimings() const {
+    RenderTimings timings;
+    timings.frames   = mTimedFrames.load(std::memory_order_relaxed);
+    timings.decodeNs = mDecodeNs.load(std::memory_order_relaxed);
+    timings.radiosNs = mRadiosNs.load(std::memory_order_relaxed);
+    timings.outputNs = mOutputNs.load(std::memory_order_relaxed);
+    return timings;
+}
+
@@ -33,6 +33,7 @@
 
 #include "afv-native/audio/OutputMixer.h"
 #include "afv-native/Log.h"
+#include "afv-native/audio/Kernels.h"
 #include "afv-native/audio/SourceStatus.h"
 #include <cstring>
 
@@ -47,10 +48,8 @@ OutputMixer::~OutputMixer() {
 SourceStatus OutputMixer::getAudioFrame(SampleType *RESTRICT bufferOut) {
     SourceStatus src_rv;
     bool         didMix = false;
-    int          i      = 0;
 
-    std::vector<SampleType> ibuf(frameSizeSamples, 0.0); // we must not touch ibuf directly. (due RESTICT in next line).
-    auto *intermediate_buffer = ibuf.data();
+    SampleType intermediate_buffer[frameSizeSamples];
 
     ::memset(bufferOut, 0, sizeof(SampleType) * frameSizeSamples);
 
@@ -58,9 +57,7 @@ SourceStatus OutputMixer::getAudioFrame(SampleType *RESTRICT bufferOut) {
         src_rv = src_iter.src->getAudioFrame(intermediate_buffer);
         if (src_rv == SourceStatus::OK) {
             didMix = true;
-            for (i = 0; i < frameSizeSamples; i++) {
-                bufferOut[i] += (src_iter.gain * intermediate_buffer[i]);
-            }
+            kernels::mix(bufferOut, intermediate_buffer, src_iter.gain, frameSizeSamples);
         } else {
             if (src_rv == SourceStatus::Error) {
                 LOG("outputmixer", "Error reading from stream.  Removing from mixer.");
@@ -74,9 +71,7 @@ SourceStatus OutputMixer::getAudioFrame(SampleType *RESTRICT bufferOut) {
     });
     // apply final volume adjustment.
     if (didMix) {
-        for (i = 0; i < frameSizeSamples; i++) {
-            bufferOut[i] *= mGain;
-        }
+        kernels::scale(bufferOut, mGain, frameSizeSamples);
     }
     return SourceStatus::OK;
 }
@@ -49,3 +49,7 @@ SourceStatus SineToneSource::getAudioFrame(SampleType *bufferOut) {
     mFillCount++;
     return SourceStatus::OK;
 }
+
+void SineToneSource::reset() {
+    mFillCount = 0;
+}
@@ -32,6 +32,7 @@
  */
 
 #include "afv-native/audio/SpeexPreprocessor.h"
+#include "afv-native/audio/Kernels.h"
 #include "afv-native/audio/audio_params.h"
 
 using namespace afv_native::audio;
@@ -63,24 +64,16 @@ SpeexPreprocessor::~SpeexPreprocessor() {
 }
 
 void SpeexPreprocessor::putAudioFrame(const SampleType *bufferIn) {
-    for (size_t i = 0; i < frameSizeSamples; i++) {
-        mSpeexFrame[i] = static_cast<spx_int16_t>(bufferIn[i] * 32767.0f);
-    }
+    kernels::floatToInt16(mSpeexFrame, bufferIn, frameSizeSamples);
     speex_preprocess_run(mPreprocessorState, mSpeexFrame);
-    for (size_t i = 0; i < frameSizeSamples; i++) {
-        mOutputFrame[i] = static_cast<float>(mSpeexFrame[i]) / 32768.0f;
-    }
+    kernels::int16ToFloat(mOutputFrame, mSpeexFrame, frameSizeSamples);
     if (mUpstreamSink) {
         mUpstreamSink->putAudioFrame(mOutputFrame);
     }
 }
 
 void SpeexPreprocessor::transformFrame(SampleType *bufferOut, const SampleType bufferIn[]) {
-    for (size_t i = 0; i < frameSizeSamples; i++) {
-        mSpeexFrame[i] = static_cast<spx_int16_t>(bufferIn[i] * 32767.0f);
-    }
+    kernels::floatToInt16(mSpeexFrame, bufferIn, frameSizeSamples);
     speex_preprocess_run(mPreprocessorState, mSpeexFrame);
-    for (size_t i = 0; i < frameSizeSamples; i++) {
-        bufferOut[i] = static_cast<float>(mSpeexFrame[i]) / 32768.0f;
-    }
+    kernels::int16ToFloat(bufferOut, mSpeexFrame, frameSizeSamples);
 }
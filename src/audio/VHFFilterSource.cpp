@@ -37,6 +37,34 @@
 
 using namespace afv_native::audio;
 
+static constexpr BiQuadSection schmidEd137bFilters[] = {
+    biquad::highPass(sampleRateHz, 310, 0.25),
+    biquad::peakingEQ(sampleRateHz, 450, 0.75, 12.0),
+    biquad::peakingEQ(sampleRateHz, 1450, 1.0, 20.0),
+    biquad::peakingEQ(sampleRateHz, 2000, 1.0, 20.0),
+    biquad::lowPass(sampleRateHz, 2500, 0.25),
+};
+
+static constexpr BiQuadSection garex220Filters[] = {
+    biquad::highPass(sampleRateHz, 300, 0.25),
+    biquad::highShelf(sampleRateHz, 400, 1.0, 8.0),
+    biquad::highShelf(sampleRateHz, 600, 1.0, 4.0),
+    biquad::lowShelf(sampleRateHz, 2000, 1.0, 1.0),
+    biquad::lowShelf(sampleRateHz, 2400, 1.0, 3.0),
+    biquad::lowShelf(sampleRateHz, 3000, 1.0, 10.0),
+    biquad::lowPass(sampleRateHz, 3400, 0.25),
+};
+
+static constexpr BiQuadSection rockwellCollins2100Filters[] = {
+    biquad::custom(1.0, 0.0, 0.0, -0.01, 0.0, 0.0),
+    biquad::custom(1.0, -1.7152995098277, 0.761385315196423, 0.0, 1.0, 0.753162969638192),
+    biquad::custom(1.0, -1.71626681678914, 0.762433947105989, 1.0, -2.29278115712509, 1.000336632935775),
+    biquad::custom(1.0, -1.79384214686345, 0.909678364879526, 1.0, -2.05042803669041, 1.05048374237779),
+    biquad::custom(1.0, -1.79409285259567, 0.909822671281377, 1.0, -1.95188929743297, 0.951942325888074),
+    biquad::custom(1.0, -1.9390093095185, 0.9411847259142, 1.0, -1.82547932903698, 1.09157529229851),
+    biquad::custom(1.0, -1.94022767750807, 0.942630574503006, 1.0, -1.67241244173042, 0.916184578658119),
+};
+
 VHFFilterSource::VHFFilterSource(HardwareType hd):
     compressor(new chunkware_simple::SimpleComp()), limiter(new chunkware_simple::SimpleLimit()) {
     compressor->setSampleRate(sampleRateHz);
@@ -61,35 +89,26 @@ VHFFilterSource::VHFFilterSource(HardwareType hd):
 
 VHFFilterSource::~VHFFilterSource() {
     delete compressor;
+    delete limiter;
 };
 
+void VHFFilterSource::reset() {
+    compressor->initRuntime();
+    limiter->initRuntime();
+    mFilters.reset();
+}
+
 void VHFFilterSource::setupPresets() {
     if (hardware == HardwareType::Schmid_ED_137B) {
-        mFilters.push_back(BiQuadFilter::highPassFilter(sampleRateHz, 310, 0.25));
-        mFilters.push_back(BiQuadFilter::peakingEQ(sampleRateHz, 450, 0.75, 12.0));
-        mFilters.push_back(BiQuadFilter::peakingEQ(sampleRateHz, 1450, 1.0, 20.0));
-        mFilters.push_back(BiQuadFilter::peakingEQ(sampleRateHz, 2000, 1.0, 20.0));
-        mFilters.push_back(BiQuadFilter::lowPassFilter(sampleRateHz, 2500, 0.25));
+        mFilters = BiQuadCascade(schmidEd137bFilters);
     }
 
     if (hardware == HardwareType::Garex_220) {
-        mFilters.push_back(BiQuadFilter::highPassFilter(sampleRateHz, 300, 0.25));
-        mFilters.push_back(BiQuadFilter::highShelfFilter(sampleRateHz, 400, 1.0, 8.0));
-        mFilters.push_back(BiQuadFilter::highShelfFilter(sampleRateHz, 600, 1.0, 4.0));
-        mFilters.push_back(BiQuadFilter::lowShelfFilter(sampleRateHz, 2000, 1.0, 1.0));
-        mFilters.push_back(BiQuadFilter::lowShelfFilter(sampleRateHz, 2400, 1.0, 3.0));
-        mFilters.push_back(BiQuadFilter::lowShelfFilter(sampleRateHz, 3000, 1.0, 10.0));
-        mFilters.push_back(BiQuadFilter::lowPassFilter(sampleRateHz, 3400, 0.25));
+        mFilters = BiQuadCascade(garex220Filters);
     }
 
     if (hardware == HardwareType::Rockwell_Collins_2100) {
-        mFilters.push_back(BiQuadFilter::customBuild(1.0, 0.0, 0.0, -0.01, 0.0, 0.0));
-        mFilters.push_back(BiQuadFilter::customBuild(1.0, -1.7152995098277, 0.761385315196423, 0.0, 1.0, 0.753162969638192));
-        mFilters.push_back(BiQuadFilter::customBuild(1.0, -1.71626681678914, 0.762433947105989, 1.0, -2.29278115712509, 1.000336632935775));
-        mFilters.push_back(BiQuadFilter::customBuild(1.0, -1.79384214686345, 0.909678364879526, 1.0, -2.05042803669041, 1.05048374237779));
-        mFilters.push_back(BiQuadFilter::customBuild(1.0, -1.79409285259567, 0.909822671281377, 1.0, -1.95188929743297, 0.951942325888074));
-        mFilters.push_back(BiQuadFilter::customBuild(1.0, -1.9390093095185, 0.9411847259142, 1.0, -1.82547932903698, 1.09157529229851));
-        mFilters.push_back(BiQuadFilter::customBuild(1.0, -1.94022767750807, 0.942630574503006, 1.0, -1.67241244173042, 0.916184578658119));
+        mFilters = BiQuadCascade(rockwellCollins2100Filters);
     }
 }
 
@@ -98,6 +117,9 @@ void VHFFilterSource::setupPresets() {
  *
  * It always performs a copy of the data from In to Out at the very least.
  *
+ * None of the stages feed back into the ones before, so running each one over
+ * the whole frame in turn gives the same result as running the chain a sample at
+ * a time.
  */
 void VHFFilterSource::transformFrame(SampleType *bufferOut, SampleType const bufferIn[]) {
     double sl, sr;
@@ -106,13 +128,21 @@ void VHFFilterSource::transformFrame(SampleType *bufferOut, SampleType const buf
         sr = sl;
 
         compressor->process(sl, sr); // We use the compressor in reverse to boost quiet audio
-        for (int band = 0; band < mFilters.size(); band++) {
-            sl = mFilters[band].TransformOne(sl);
-        }
+
+        bufferOut[i]   = sl;
+        mLimiterKey[i] = sr;
+    }
+
+    mFilters.process(bufferOut, frameSizeSamples);
+
+    for (unsigned i = 0; i < frameSizeSamples; i++) {
+        sl = bufferOut[i];
+        sr = mLimiterKey[i];
+
         limiter->process(sl, sr); // This limits the total output
 
         sl *= static_cast<float>(compressorPostGain);
 
         bufferOut[i] = sl;
     }
-}
\ No newline at end of file
+}
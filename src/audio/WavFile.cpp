@@ -361,3 +361,59 @@ fail:
     }
     return nullptr;
 }
+
+bool afv_native::audio::SaveWav(const char *fileName, const float *samples, size_t frameCount, int channelCount, int sampleRate) {
+    const uint16_t blockAlign = sizeof(float) * channelCount;
+    const uint64_t dataSize   = static_cast<uint64_t>(frameCount) * blockAlign;
+    /* a RIFF file can't describe more than 4GB. */
+    if (dataSize > UINT32_MAX - 64) {
+        return false;
+    }
+
+    /* float data needs the 18 byte format chunk and a fact chunk, unlike PCM. */
+    const uint32_t formatSize = 18;
+    const uint32_t factSize   = 4;
+
+    FILE *fh = fopen(fileName, "wb");
+    if (fh == nullptr) {
+        return false;
+    }
+
+    struct ChunkHeader ch;
+    memcpy(ch.chunkID, WavTopChunkID, 4);
+    ch.chunkSize = static_cast<uint32_t>(4 + (8 + formatSize) + (8 + factSize) + (8 + dataSize));
+
+    struct WavFormatChunk fc;
+    memset(&fc, 0, sizeof(fc));
+    fc.wFormatTag      = WAV_FORMAT_IEEE_FLOAT;
+    fc.nChannels       = channelCount;
+    fc.nSamplesPerSec  = sampleRate;
+    fc.nAvgBytesPerSec = sampleRate * blockAlign;
+    fc.nBlockAlign     = blockAlign;
+    fc.wBitsPerSample  = 8 * sizeof(float);
+    fc.cbSize          = 0;
+
+    struct ChunkHeader formatHeader;
+    memcpy(formatHeader.chunkID, WavFormatChunkID, 4);
+    formatHeader.chunkSize = formatSize;
+
+    struct ChunkHeader factHeader;
+    memcpy(factHeader.chunkID, "fact", 4);
+    factHeader.chunkSize        = factSize;
+    const uint32_t sampleFrames = static_cast<uint32_t>(frameCount);
+
+    struct ChunkHeader dataHeader;
+    memcpy(dataHeader.chunkID, WavDataChunkID, 4);
+    dataHeader.chunkSize = static_cast<uint32_t>(dataSize);
+
+    bool ok = 1 == fwrite(&ch, sizeof(ch), 1, fh);
+    ok      = ok && 1 == fwrite("WAVE", 4, 1, fh);
+    ok      = ok && 1 == fwrite(&formatHeader, sizeof(formatHeader), 1, fh);
+    ok      = ok && 1 == fwrite(&fc, formatSize, 1, fh);
+    ok      = ok && 1 == fwrite(&factHeader, sizeof(factHeader), 1, fh);
+    ok      = ok && 1 == fwrite(&sampleFrames, sizeof(sampleFrames), 1, fh);
+    ok      = ok && 1 == fwrite(&dataHeader, sizeof(dataHeader), 1, fh);
+    ok      = ok && frameCount == fwrite(samples, blockAlign, frameCount, fh);
+    ok      = (0 == fclose(fh)) && ok;
+    return ok;
+}
@@ -542,6 +542,51 @@ void Client::setSplitAudioChannels(bool split)
     mRadioSim->setSplitAudioChannels(split);
 }
 
+void Client::setJitterLatencyMode(JitterLatencyMode mode)
+{
+    if (mRadioSim) {
+        mRadioSim->setJitterLatencyMode(mode);
+    }
+}
+
+void Client::setEnableTransmitFec(bool enable, int expectedLossPercent)
+{
+    if (mRadioSim) {
+        mRadioSim->setEnableTransmitFec(enable, expectedLossPercent);
+    }
+}
+
+bool Client::getStreamJitterStatistics(const std::string &callsign, JitterStatistics &statsOut)
+{
+    if (mRadioSim) {
+        return mRadioSim->getStreamJitterStatistics(callsign, statsOut);
+    }
+    return false;
+}
+
+JitterStatistics Client::getFrequencyJitterStatistics(unsigned int freq)
+{
+    if (mRadioSim) {
+        return mRadioSim->getFrequencyJitterStatistics(freq);
+    }
+    return JitterStatistics();
+}
+
+void Client::setMaxReceiveStreams(unsigned int maxStreams)
+{
+    if (mRadioSim) {
+        mRadioSim->setMaxReceiveStreams(maxStreams);
+    }
+}
+
+StreamPoolStatistics Client::getStreamPoolStatistics()
+{
+    if (mRadioSim) {
+        return mRadioSim->getStreamPoolStatistics();
+    }
+    return StreamPoolStatistics();
+}
+
 void Client::aliasUpdateCallback()
 {
     ClientEventCallback.invokeAll(ClientEventType::StationAliasesUpdated, nullptr, nullptr);
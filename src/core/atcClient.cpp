@@ -517,6 +517,49 @@ void ATCClient::logAudioStatistics() {
         LOG("ATCClient", "Input Buffer Overflows: %d",
             mAudioDevice->InputOverflows.load());
     }
+    if (mATCRadioStack) {
+        mATCRadioStack->logAudioStatistics();
+    }
+    mVoiceSession.getUDPChannel().logStatistics();
+}
+
+void ATCClient::setJitterLatencyMode(JitterLatencyMode mode) {
+    if (mATCRadioStack) {
+        mATCRadioStack->setJitterLatencyMode(mode);
+    }
+}
+
+void ATCClient::setEnableTransmitFec(bool enable, int expectedLossPercent) {
+    if (mATCRadioStack) {
+        mATCRadioStack->setEnableTransmitFec(enable, expectedLossPercent);
+    }
+}
+
+bool ATCClient::getStreamJitterStatistics(const std::string &callsign, JitterStatistics &statsOut) {
+    if (mATCRadioStack) {
+        return mATCRadioStack->getStreamJitterStatistics(callsign, statsOut);
+    }
+    return false;
+}
+
+JitterStatistics ATCClient::getFrequencyJitterStatistics(unsigned int freq) {
+    if (mATCRadioStack) {
+        return mATCRadioStack->getFrequencyJitterStatistics(freq);
+    }
+    return JitterStatistics();
+}
+
+void ATCClient::setMaxReceiveStreams(unsigned int maxStreams) {
+    if (mATCRadioStack) {
+        mATCRadioStack->setMaxReceiveStreams(maxStreams);
+    }
+}
+
+StreamPoolStatistics ATCClient::getStreamPoolStatistics() {
+    if (mATCRadioStack) {
+        return mATCRadioStack->getStreamPoolStatistics();
+    }
+    return StreamPoolStatistics();
 }
 
 std::shared_ptr<const audio::AudioDevice> ATCClient::getAudioDevice() const {
@@ -587,7 +630,7 @@ bool ATCClient::addFrequency(unsigned int freq, bool onHeadset, std::string stat
 }
 
 bool ATCClient::isFrequencyActive(unsigned int freq) {
-    return mATCRadioStack->isFrequencyActive(freq);
+    return mATCRadioStack->getRadioState()->count(freq) != 0;
 }
 
 void ATCClient::removeFrequency(unsigned int freq) {
@@ -650,7 +693,7 @@ afv_native::PlaybackChannel afv_native::ATCClient::getPlaybackChannel(unsigned i
 int afv_native::ATCClient::getTransceiverCountForFrequency(unsigned int freq) {
     return mATCRadioStack->getTransceiverCountForFrequency(freq);
 }
-std::map<unsigned int, afv::AtcRadioState> afv_native::ATCClient::getRadioState() {
+std::shared_ptr<const afv::AtcRadioStateMap> afv_native::ATCClient::getRadioState() {
     return mATCRadioStack->getRadioState();
 }
 
@@ -34,6 +34,7 @@
 #include "afv-native/cryptodto/Channel.h"
 #include "afv-native/cryptodto/dto/ChannelConfig.h"
 #include "afv-native/cryptodto/dto/Header.h"
+#include "afv-native/util/MsgpackReader.h"
 #include <cstring>
 #include <ctime>
 #include <openssl/rand.h>
@@ -42,68 +43,80 @@
 using namespace afv_native::cryptodto;
 using namespace std;
 
-Channel::Channel(): ChannelTag() {
+Channel::Channel():
+    mTransmitContext(EVP_CIPHER_CTX_new()), mReceiveContext(EVP_CIPHER_CTX_new()), mTransmitLock(), mReceiveLock(), ChannelTag() {
     make_aead_key(aeadTransmitKey);
     make_aead_key(aeadReceiveKey);
+    if (!keyChaCha20Poly1305(mTransmitContext, aeadTransmitKey, 1) || !keyChaCha20Poly1305(mReceiveContext, aeadReceiveKey, 0)) {
+        LOG("Channel", "couldn't set up the ChaCha20-Poly1305 cipher contexts");
+    }
+    buildHeaderTemplates();
+}
+
+Channel::~Channel() {
+    EVP_CIPHER_CTX_free(mTransmitContext);
+    EVP_CIPHER_CTX_free(mReceiveContext);
 }
 
 void Channel::make_aead_key(unsigned char keyBuffer[]) {
     RAND_priv_bytes(keyBuffer, aeadModeKeySize);
 }
 
+bool Channel::keyChaCha20Poly1305(EVP_CIPHER_CTX *context, const unsigned char *key, int encrypt) {
+    // per EVP_EncryptInit, use null keys, then set the keys later with type null.  The nonce is
+    // set per packet.
+    if (!EVP_CipherInit_ex(context, EVP_chacha20_poly1305(), nullptr, nullptr, nullptr, encrypt)) {
+        return false;
+    }
+    if (!EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_AEAD_SET_IVLEN, aeadModeIVSize, nullptr)) {
+        return false;
+    }
+    return EVP_CipherInit_ex(context, nullptr, nullptr, key, nullptr, encrypt);
+}
+
 void Channel::makeChaCha20Poly1305Nonce(uint64_t sequence, unsigned char *nonceBuffer) {
     ::memset(nonceBuffer, 0, aeadModeIVSize);
     // NOTE: LE systems only.
     ::memcpy(nonceBuffer + 4, &sequence, sizeof(sequence));
 }
 
-size_t Channel::encryptChaCha20Poly1305(unsigned char *cipherOut, const unsigned char *plainIn, size_t plainLen, const dto::Header &header, const unsigned char *aadIn, size_t aadLen) {
+size_t Channel::encryptChaCha20Poly1305(unsigned char *cipherOut, const unsigned char *plainIn, size_t plainLen, sequence_t sequence, const unsigned char *aadIn, size_t aadLen) {
     size_t        cipherLen = 0;
     int           enc_len   = 0;
     unsigned char nonce[aeadModeIVSize];
 
-    makeChaCha20Poly1305Nonce(header.Sequence, nonce);
+    makeChaCha20Poly1305Nonce(sequence, nonce);
 
-    auto *cipher_context = EVP_CIPHER_CTX_new();
-    // per EVP_EncryptInit, use null keys, then set the keys later with type null.
-    if (!EVP_EncryptInit_ex(cipher_context, EVP_chacha20_poly1305(), nullptr, nullptr, nullptr)) {
-        goto abort;
-    }
-    if (!EVP_CIPHER_CTX_ctrl(cipher_context, EVP_CTRL_AEAD_SET_IVLEN, aeadModeIVSize, nullptr)) {
-        goto abort;
-    }
-    if (!EVP_EncryptInit_ex(cipher_context, nullptr, nullptr, aeadTransmitKey, nonce)) {
-        goto abort;
+    std::lock_guard<std::mutex> transmitGuard(mTransmitLock);
+    auto                       *cipher_context = mTransmitContext;
+    // the context is already keyed, so only the nonce needs setting.  This also restarts the MAC.
+    if (!EVP_EncryptInit_ex(cipher_context, nullptr, nullptr, nullptr, nonce)) {
+        return 0;
     }
     if (aadLen > 0) {
         if (!EVP_EncryptUpdate(cipher_context, nullptr, &enc_len, aadIn, aadLen)) {
-            goto abort;
+            return 0;
         }
     }
     if (!EVP_EncryptUpdate(cipher_context, cipherOut + cipherLen, &enc_len, plainIn, plainLen)) {
-        goto abort;
+        return 0;
     }
     cipherLen += enc_len;
     if (!EVP_EncryptFinal_ex(cipher_context, cipherOut + cipherLen, &enc_len)) {
-        goto abort;
+        return 0;
     }
     cipherLen += enc_len;
     // append the tag.
     if (!EVP_CIPHER_CTX_ctrl(cipher_context, EVP_CTRL_AEAD_GET_TAG, aeadModeTagSize, cipherOut + cipherLen)) {
-        goto abort;
+        return 0;
     }
 
     cipherLen += aeadModeTagSize;
 
-    EVP_CIPHER_CTX_free(cipher_context);
-
     return cipherLen;
-abort:
-    EVP_CIPHER_CTX_free(cipher_context);
-    return 0;
 }
 
-size_t Channel::decryptChaCha20Poly1305(unsigned char *bodyOut, const unsigned char *cipherIn, size_t cipherLen, const dto::Header &header, const unsigned char *aadIn, size_t aadLen) {
+size_t Channel::decryptChaCha20Poly1305(unsigned char *bodyOut, const unsigned char *cipherIn, size_t cipherLen, sequence_t sequence, const unsigned char *aadIn, size_t aadLen) {
     // make sure the message is long enough
     if (cipherLen < aeadModeTagSize) {
         return 0;
@@ -111,75 +124,70 @@ size_t Channel::decryptChaCha20Poly1305(unsigned char *bodyOut, const unsigned c
 
     size_t        bodyLen = 0;
     unsigned char nonce[aeadModeIVSize];
-    int           dec_len        = 0;
-    auto         *cipher_context = EVP_CIPHER_CTX_new();
+    int           dec_len = 0;
 
-    makeChaCha20Poly1305Nonce(header.Sequence, nonce);
-    if (!EVP_DecryptInit_ex(cipher_context, EVP_chacha20_poly1305(), nullptr, nullptr, nullptr)) {
-        goto abort;
-    }
-    if (!EVP_CIPHER_CTX_ctrl(cipher_context, EVP_CTRL_AEAD_SET_IVLEN, aeadModeIVSize, nullptr)) {
-        goto abort;
-    }
-    if (!EVP_DecryptInit_ex(cipher_context, nullptr, nullptr, aeadReceiveKey, nonce)) {
-        goto abort;
+    makeChaCha20Poly1305Nonce(sequence, nonce);
+
+    std::lock_guard<std::mutex> receiveGuard(mReceiveLock);
+    auto                       *cipher_context = mReceiveContext;
+    if (!EVP_DecryptInit_ex(cipher_context, nullptr, nullptr, nullptr, nonce)) {
+        return 0;
     }
     if (!EVP_CIPHER_CTX_ctrl(cipher_context, EVP_CTRL_AEAD_SET_TAG, aeadModeTagSize, (void *) (cipherIn + (cipherLen - aeadModeTagSize)))) {
-        goto abort;
+        return 0;
     };
     if (aadLen > 0) {
         if (!EVP_DecryptUpdate(cipher_context, nullptr, &dec_len, aadIn, aadLen)) {
-            goto abort;
+            return 0;
         }
         dec_len = 0;
     }
     if (!EVP_DecryptUpdate(cipher_context, bodyOut, &dec_len, cipherIn, cipherLen - aeadModeTagSize)) {
-        goto abort;
+        return 0;
     }
     bodyLen += dec_len;
     dec_len = 0;
     if (!EVP_DecryptFinal_ex(cipher_context, bodyOut + bodyLen, &dec_len)) {
-        goto abort;
+        return 0;
     }
     bodyLen += dec_len;
-    EVP_CIPHER_CTX_free(cipher_context);
 
     return bodyLen;
-abort:
-    EVP_CIPHER_CTX_free(cipher_context);
-    return 0;
 }
 
-bool Channel::Decapsulate(const unsigned char *cipherTextIn, size_t cipherTextLen, std::string &channelTag, sequence_t &sequence, CryptoDtoMode &modeOut, std::string &dtoNameOut, msgpack::sbuffer &dtoOut) {
+/* The header is a msgpack array of [ChannelTag, Sequence, Mode], read straight out of the
+ * datagram rather than unpacked into a dto::Header through a msgpack zone.
+ */
+static bool readHeader(const unsigned char *pos, const unsigned char *end, std::string_view &channelTag, uint64_t &sequence, uint64_t &mode) {
+    afv_native::util::MsgpackReader reader(pos, end - pos);
+    uint32_t                        fieldCount = 0;
+    return reader.readArray(fieldCount) && fieldCount == 3 && reader.readStr(channelTag) && reader.readUint(sequence) && reader.readUint(mode);
+}
+
+bool Channel::Decapsulate(unsigned char *datagramIn, size_t datagramLen, DecapsulatedDto &dtoOut) {
     size_t offset = 2;
-    if (cipherTextLen < 2) {
+    if (datagramLen < 2) {
         return false;
     }
     uint16_t headerSize = 0;
-    ::memcpy(&headerSize, cipherTextIn, sizeof(headerSize));
+    ::memcpy(&headerSize, datagramIn, sizeof(headerSize));
 
     // minimum bounds for the full message is the header size + header + dtonamesize + one byte for the dtoname.
-    if (cipherTextLen <= (2 + headerSize + 3)) {
+    if (datagramLen <= (2 + headerSize + 3)) {
         return false;
     }
 
-    auto headerObjHdl = msgpack::unpack(reinterpret_cast<const char *>(cipherTextIn) + offset, headerSize);
-    dto::Header header;
-    try {
-        headerObjHdl.get().convert(header);
-    } catch (const msgpack::type_error &) {
+    uint64_t mode = 0;
+    if (!readHeader(datagramIn + offset, datagramIn + offset + headerSize, dtoOut.channelTag, dtoOut.sequence, mode)) {
         return false;
     }
     offset += headerSize;
 
-    modeOut = static_cast<cryptodto::CryptoDtoMode>(header.Mode);
-
-    const size_t               bodySize = cipherTextLen - offset;
-    std::vector<unsigned char> bodyOut(bodySize);
-    size_t                     bodyLen = 0;
-    switch (header.Mode) {
+    unsigned char *body     = datagramIn + offset;
+    const size_t   bodySize = datagramLen - offset;
+    size_t         bodyLen  = 0;
+    switch (mode) {
         case CryptoModeNone:
-            ::memcpy(bodyOut.data(), cipherTextIn + offset, bodySize);
             bodyLen = bodySize;
             break;
         case CryptoModeChaCha20Poly1305:
@@ -187,7 +195,9 @@ bool Channel::Decapsulate(const unsigned char *cipherTextIn, size_t cipherTextLe
             if (bodySize <= 16) {
                 return false;
             }
-            bodyLen = decryptChaCha20Poly1305(bodyOut.data(), cipherTextIn + offset, bodySize, header, cipherTextIn, offset);
+            // the header before the body is the additional data, so decrypting over the body
+            // leaves it intact.
+            bodyLen = decryptChaCha20Poly1305(body, body, bodySize, dtoOut.sequence, datagramIn, offset);
             if (bodyLen == 0) {
                 return false;
             }
@@ -195,75 +205,100 @@ bool Channel::Decapsulate(const unsigned char *cipherTextIn, size_t cipherTextLe
         default:
             return false;
     }
+    dtoOut.mode = static_cast<CryptoDtoMode>(mode);
 
     // now, extract the DTO name.
     uint16_t nameSize;
-    ::memcpy(&nameSize, bodyOut.data(), 2);
-    if (nameSize > bodyLen) {
+    ::memcpy(&nameSize, body, 2);
+    if (2 + static_cast<size_t>(nameSize) > bodyLen) {
         return false;
     }
-    dtoNameOut = std::move(string(reinterpret_cast<char *>(bodyOut.data()) + 2, nameSize));
-    dtoOut.write(reinterpret_cast<char *>(bodyOut.data()) + 2 + nameSize, bodyLen - 2 - nameSize);
-
-    sequence   = header.Sequence;
-    channelTag = std::move(header.ChannelTag);
+    dtoOut.dtoName = std::string_view(reinterpret_cast<const char *>(body) + 2, nameSize);
+    dtoOut.body    = body + 2 + nameSize;
+    dtoOut.bodyLen = bodyLen - 2 - nameSize;
     return true;
 }
 
-size_t Channel::Encapsulate(const unsigned char *plainTextBuf, size_t plainTextLen, sequence_t sequence, CryptoDtoMode mode, unsigned char *cipherTextBufOut, size_t cipherTextLen) {
-    size_t   offset = 0;
-    uint16_t nLen;
-    int      enc_len;
+void Channel::buildHeaderTemplates() {
+    DatagramBuffer header(64);
+    for (int mode = CryptoModeNone; mode < CryptoModeLast; mode++) {
+        auto &headerTemplate = mHeaderTemplates[mode];
+        header.clear();
+        const size_t headerLenOffset = header.skip(2);
 
-    msgpack::sbuffer headerBuf;
+        // the same array dto::Header packs to, but with the sequence always as a uint64 so that
+        // it's the same width whatever its value.
+        msgpack::packer<DatagramBuffer> headerPacker(header);
+        headerPacker.pack_array(3);
+        headerPacker.pack(ChannelTag);
+        // the sequence's 8 bytes follow its marker byte.
+        headerTemplate.sequenceOffset = header.size() + 1;
+        headerPacker.pack_fix_uint64(0);
+        headerPacker.pack(mode);
 
-    // assemble the header and pack it.
-    dto::Header myHeader(ChannelTag, sequence, mode);
-    msgpack::pack(headerBuf, myHeader);
+        const size_t headerLen = header.size() - headerLenOffset - 2;
+        if (headerLen > UINT16_MAX) {
+            LOG("Channel", "channel tag is too long for a datagram header");
+            headerTemplate.bytes.clear();
+            continue;
+        }
+        header.patchUint16(headerLenOffset, static_cast<uint16_t>(headerLen));
+        headerTemplate.bytes.assign(header.data(), header.data() + header.size());
+    }
+}
 
-    if (headerBuf.size() > UINT16_MAX) {
+size_t Channel::beginDatagram(DatagramBuffer &datagramOut, sequence_t sequence, CryptoDtoMode mode) {
+    if (mode <= CryptoModeUndefined || mode >= CryptoModeLast) {
         return 0;
     }
-
-    // now, copy out the header.
-    if (cipherTextLen < headerBuf.size() + 2) {
+    const auto &headerTemplate = mHeaderTemplates[mode];
+    if (headerTemplate.bytes.empty()) {
         return 0;
     }
-    nLen = headerBuf.size();
-    ::memcpy(cipherTextBufOut, &nLen, 2);
-    offset += 2;
-    ::memcpy(cipherTextBufOut + offset, headerBuf.data(), headerBuf.size());
-    offset += headerBuf.size();
+    const size_t headerStart = datagramOut.size();
+    datagramOut.write(reinterpret_cast<const char *>(headerTemplate.bytes.data()), headerTemplate.bytes.size());
 
-    assert(offset == (headerBuf.size() + 2));
+    // msgpack is big endian.
+    unsigned char *sequenceOut = datagramOut.data() + headerStart + headerTemplate.sequenceOffset;
+    for (int i = 7; i >= 0; i--) {
+        sequenceOut[i] = static_cast<unsigned char>(sequence & 0xff);
+        sequence >>= 8;
+    }
+    return datagramOut.size();
+}
 
+bool Channel::sealDatagram(DatagramBuffer &datagramOut, size_t bodyStart, sequence_t sequence, CryptoDtoMode mode) {
     switch (mode) {
-        case CryptoModeChaCha20Poly1305:
-            if (cipherTextLen < (offset + plainTextLen + 16)) {
-                return 0;
-            }
-            enc_len = encryptChaCha20Poly1305(cipherTextBufOut + offset, plainTextBuf, plainTextLen, myHeader, cipherTextBufOut, offset);
-            if (0 == enc_len) {
-                return 0;
-            }
-            offset += enc_len;
-            assert(offset == (headerBuf.size() + 2 + plainTextLen + 16));
-            break;
+        case CryptoModeChaCha20Poly1305: {
+            const size_t bodyLen = datagramOut.size() - bodyStart;
+            // make room for the tag before taking any pointers, as it may move the buffer.
+            datagramOut.skip(aeadModeTagSize);
+            unsigned char *body    = datagramOut.data() + bodyStart;
+            const size_t   sealLen = encryptChaCha20Poly1305(body, body, bodyLen, sequence, datagramOut.data(), bodyStart);
+            return sealLen == bodyLen + aeadModeTagSize;
+        }
         case CryptoModeNone:
-            if (cipherTextLen < (offset + plainTextLen)) {
-                return 0;
-            }
-            ::memcpy(cipherTextBufOut + offset, plainTextBuf, plainTextLen);
-            offset += plainTextLen;
-            break;
+            return true;
         default:
-            return 0;
+            return false;
     }
-    return offset;
 }
 
 void Channel::setChannelConfig(const dto::ChannelConfig &config) {
-    ::memcpy(aeadTransmitKey, config.AeadTransmitKey, aeadModeKeySize);
-    ::memcpy(aeadReceiveKey, config.AeadReceiveKey, aeadModeKeySize);
+    {
+        std::lock_guard<std::mutex> transmitGuard(mTransmitLock);
+        ::memcpy(aeadTransmitKey, config.AeadTransmitKey, aeadModeKeySize);
+        if (!keyChaCha20Poly1305(mTransmitContext, aeadTransmitKey, 1)) {
+            LOG("Channel", "couldn't key the transmit cipher context");
+        }
+    }
+    {
+        std::lock_guard<std::mutex> receiveGuard(mReceiveLock);
+        ::memcpy(aeadReceiveKey, config.AeadReceiveKey, aeadModeKeySize);
+        if (!keyChaCha20Poly1305(mReceiveContext, aeadReceiveKey, 0)) {
+            LOG("Channel", "couldn't key the receive cipher context");
+        }
+    }
     ChannelTag = config.ChannelTag;
+    buildHeaderTemplates();
 }
@@ -33,6 +33,7 @@
 
 #include "afv-native/cryptodto/SequenceTest.h"
 #include <algorithm>
+#include <cstring>
 
 #if defined(_MSC_VER)
 
@@ -44,79 +45,121 @@
 using namespace std;
 using namespace afv_native::cryptodto;
 
+static const sequence_t wordBits = sizeof(sequence_bitfield_t) * 8;
+
+/** countTrailingZeros returns the index of the lowest set bit in word, which mustn't be 0. */
+static unsigned countTrailingZeros(sequence_bitfield_t word) {
+#ifdef _MSC_VER
+    unsigned long idx = 0;
+    _BitScanForward64(&idx, word);
+    return idx;
+#else
+    #ifdef __GNUC__
+    return __builtin_ctzll(word);
+    #else
+        #error No BSF for this compiler defined.
+    #endif
+#endif
+}
+
 SequenceTest::SequenceTest(sequence_t start_sequence, unsigned window):
-    _bitfield(0), _min(start_sequence), _window(window) {
+    _ring(), _min(start_sequence), _window(window), Duplicates(0), Late(0), Overflows(0) {
     if (_window < 1) {
         _window = 1;
     }
-    if (_window > (sizeof(sequence_bitfield_t) * 8)) {
-        _window = sizeof(sequence_bitfield_t) * 8;
+    if (_window > maxSequenceWindow) {
+        _window = maxSequenceWindow;
+    }
+}
+
+bool SequenceTest::isReceived(sequence_t sequence) const {
+    const sequence_t bit = sequence % ringBits;
+    return (_ring[bit / wordBits] >> (bit % wordBits)) & 1;
+}
+
+void SequenceTest::markReceived(sequence_t sequence) {
+    const sequence_t bit = sequence % ringBits;
+    _ring[bit / wordBits] |= sequence_bitfield_t(1) << (bit % wordBits);
+}
+
+void SequenceTest::clearRange(sequence_t first, sequence_t count) {
+    if (count >= ringBits) {
+        ::memset(_ring, 0, sizeof(_ring));
+        return;
+    }
+    sequence_t bit = first % ringBits;
+    while (count > 0) {
+        const sequence_t          offset = bit % wordBits;
+        const sequence_t          span   = std::min(count, wordBits - offset);
+        const sequence_bitfield_t mask   = (span == wordBits) ? ~sequence_bitfield_t(0) : ((sequence_bitfield_t(1) << span) - 1) << offset;
+        _ring[bit / wordBits] &= ~mask;
+        count -= span;
+        bit = (bit + span) % ringBits;
     }
 }
 
 void SequenceTest::advanceWindow() {
-    // bitflip the bitfield and look for the first set bit - this will be the
-    // first unreceived packet in the window.
-    unsigned long idx = 0;
+    // packets mostly arrive in order, with nothing received ahead of them.
+    if (!isReceived(_min)) {
+        return;
+    }
 
-#ifdef _MSC_VER
-    auto found = _BitScanForward64(&idx, ~_bitfield);
-    // if idx == 0, then the window was fully received and we advance the full amount!
-    if (!found) {
-        idx = sizeof(_bitfield) * 8;
-    } else {
-        idx++;
+    // find the first gap from _min on, a word at a time.  No more than a window's worth of
+    // flags can be set, so there's always a gap before the scan wraps round.
+    sequence_t bit     = _min % ringBits;
+    sequence_t skipped = 0;
+    for (size_t i = 0; i <= ringWords; i++) {
+        const sequence_t          offset = bit % wordBits;
+        const sequence_bitfield_t gaps   = ~_ring[bit / wordBits] & (~sequence_bitfield_t(0) << offset);
+        if (gaps != 0) {
+            skipped += countTrailingZeros(gaps) - offset;
+            break;
+        }
+        skipped += wordBits - offset;
+        bit = (bit + wordBits - offset) % ringBits;
     }
-#else
-    #ifdef __GNUC__
-    idx = __builtin_ctz(~_bitfield) + 1;
-    #else
-        #error No BSF for this compiler defined.
-    #endif
-#endif
-    idx = std::min(idx, static_cast<unsigned long>(_window));
-    _min += idx;
-    _bitfield = _bitfield >> (idx);
+    clearRange(_min, skipped);
+    _min += skipped;
 }
 
 ReceiveOutcome SequenceTest::Received(sequence_t newSequence) {
     if (newSequence < _min) {
+        Late++;
         return ReceiveOutcome::Before;
     }
     if (newSequence == _min) {
+        _min++;
         advanceWindow();
         return ReceiveOutcome::OK;
     }
     if (newSequence <= (_min + _window)) {
-        // always at least 1 because if it was min, we'd have exited earlier.
-        sequence_t bitidx = newSequence - _min - 1;
-
-        sequence_bitfield_t mask = 1ULL << bitidx;
-        if ((_bitfield & mask) == mask) {
+        if (isReceived(newSequence)) {
+            Duplicates++;
             return ReceiveOutcome::Before;
         }
-        _bitfield |= mask;
+        markReceived(newSequence);
         return ReceiveOutcome::OK;
     }
     // if we're here, then we've forced a window jump.
-    sequence_t oldmin = _min;
-    while (_min < oldmin + _window) {
-        advanceWindow();
-        if ((_min + _window) > newSequence) {
-            // if we're now in window, break out.
-            break;
-        }
-    }
-    // did we fully advance the window?  If so abandon the old position and restart the stream.
-    if (_min >= oldmin + _window) {
-        _min      = newSequence + 1;
-        _bitfield = 0;
+    Overflows++;
+    const sequence_t newMin = newSequence - _window;
+    if (newMin >= _min + _window) {
+        // nothing we've seen is still in the window, so abandon the old position and restart
+        // the stream.
+        ::memset(_ring, 0, sizeof(_ring));
+        _min = newSequence + 1;
         return ReceiveOutcome::Overflow;
     }
-    // if we're inside the window now, mask and return.
-    sequence_t          bitidx = newSequence - _min - 1;
-    sequence_bitfield_t mask   = 1ULL << bitidx;
-    _bitfield |= mask;
+    // move the window up just far enough to take the new sequence, skipping what's missing.
+    clearRange(_min, newMin - _min);
+    _min = newMin;
+    advanceWindow();
+    if (newSequence == _min) {
+        _min++;
+        advanceWindow();
+    } else {
+        markReceived(newSequence);
+    }
     return ReceiveOutcome::Overflow;
 }
 
@@ -124,7 +167,11 @@ sequence_t SequenceTest::GetNext() const {
     return _min;
 }
 
+unsigned SequenceTest::GetWindow() const {
+    return _window;
+}
+
 void SequenceTest::reset() {
-    _min      = 0;
-    _bitfield = 0;
+    _min = 0;
+    ::memset(_ring, 0, sizeof(_ring));
 }
@@ -34,35 +34,166 @@
 #include "afv-native/cryptodto/UDPChannel.h"
 #include "afv-native/Log.h"
 #include "afv-native/cryptodto/dto/ChannelConfig.h"
-#include <Poco/Net/IPAddress.h>
 #include <cerrno>
+#include <cstring>
 #include <event2/util.h>
 
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
 using namespace afv_native::cryptodto;
 using namespace std;
 
-UDPChannel::UDPChannel(int receiveSequenceHistorySize):
-    Channel(), mAddress(), mDatagramRxBuffer(nullptr), mPocoUDPSocket(), mPocoSocketReactor(), mReactorThread("UDP Socket Reactor Thread"), mTxSequence(0), receiveSequence(0, receiveSequenceHistorySize), mAcceptableCiphers(1U << cryptodto::CryptoDtoMode::CryptoModeChaCha20Poly1305), mDtoHandlers(), mLastErrno(0) {
+/** txBufferInitialSize fits any voice or heartbeat datagram, so the transmit buffer shouldn't
+ * ever need to grow.
+ */
+static const size_t txBufferInitialSize = 1500;
+
+UDPChannel::UDPChannel(struct event_base *evBase, int receiveSequenceHistorySize):
+    Channel(), mEvBase(evBase), mReadEvent(nullptr), mSocket(EVUTIL_INVALID_SOCKET), mAddress(), mDatagramRxBuffer(nullptr), mReceiveBufferSize(0), mSendBufferSize(0), mRxTimestampNs(0), mTxSequence(0), mTxBuffer(txBufferInitialSize), mTxLock(), receiveSequence(0, receiveSequenceHistorySize), mAcceptableCiphers(1U << cryptodto::CryptoDtoMode::CryptoModeChaCha20Poly1305), mDtoHandlers(), mLastErrno(0), RxBatches(0), RxDatagrams(0), RxBatchSizes(), RxKernelDrops(0) {
+#ifdef __linux__
+    mRxBatchBuffers   = new unsigned char[rxBatchSize * maxPermittedDatagramSize];
+    mDatagramRxBuffer = mRxBatchBuffers;
+    mKernelDropsSeen  = 0;
+#else
     mDatagramRxBuffer = new unsigned char[maxPermittedDatagramSize];
-    mReactorThread.start(mPocoSocketReactor);
+#endif
 }
 
 UDPChannel::~UDPChannel() {
     close();
-    mPocoSocketReactor.stop();
-    mReactorThread.join();
+#ifdef __linux__
+    delete[] mRxBatchBuffers;
+    mRxBatchBuffers = nullptr;
+#else
     delete[] mDatagramRxBuffer;
+#endif
     mDatagramRxBuffer = nullptr;
 }
 
-void UDPChannel::registerDtoHandler(const string &dtoName, std::function<void(const unsigned char *data, size_t len)> callback) {
-    mDtoHandlers[dtoName] = callback;
+void UDPChannel::registerDtoHandler(DtoId id, DtoHandler handler, void *user_data) {
+    if (id == DtoId::Unknown || id >= DtoId::Count) {
+        return;
+    }
+    mDtoHandlers[static_cast<size_t>(id)] = DtoHandlerSlot {handler, user_data};
+}
+
+/** batchSizeBucket returns the RxBatchSizes bucket for a batch of count datagrams. */
+static int batchSizeBucket(int count) {
+    int bucket = 0;
+    while (count > 1 && bucket < UDPChannel::rxBatchSizeBuckets - 1) {
+        count >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+bool UDPChannel::isRetriableSocketError(int err) {
+#ifdef _WIN32
+    return err == WSAEWOULDBLOCK || err == WSAEINTR;
+#else
+    return err == EAGAIN || err == EWOULDBLOCK || err == EINTR;
+#endif
+}
+
+void UDPChannel::evReadCallback(evutil_socket_t, short, void *arg) {
+    reinterpret_cast<UDPChannel *>(arg)->readCallback();
+}
+
+void UDPChannel::readCallback() {
+#ifdef __linux__
+    receiveBatches();
+#else
+    // drain the socket one datagram at a time.
+    for (;;) {
+        const auto dgSize = ::recv(mSocket, reinterpret_cast<char *>(mDatagramRxBuffer), maxPermittedDatagramSize, 0);
+        if (dgSize < 0) {
+            const int err = EVUTIL_SOCKET_ERROR();
+            if (!isRetriableSocketError(err)) {
+                LOG("udpchannel:readCallback", "recv failed: %s", evutil_socket_error_to_string(err));
+            }
+            return;
+        }
+        RxBatches++;
+        RxDatagrams++;
+        RxBatchSizes[0]++;
+        processDatagram(mDatagramRxBuffer, static_cast<int>(dgSize));
+    }
+#endif
 }
 
-void UDPChannel::readCallback(const Poco::AutoPtr<Poco::Net::ReadableNotification> &notification) {
-    Poco::Net::SocketAddress sender;
-    int dgSize = mPocoUDPSocket.receiveFrom(mDatagramRxBuffer, maxPermittedDatagramSize, sender);
+#ifdef __linux__
+void UDPChannel::receiveBatches() {
+    const int socket = mSocket;
+
+    struct mmsghdr headers[rxBatchSize];
+    struct iovec   iovecs[rxBatchSize];
+    // room for the SO_RXQ_OVFL drop count and SO_TIMESTAMPNS receive time on each datagram.
+    alignas(struct cmsghdr) unsigned char controls[rxBatchSize][CMSG_SPACE(sizeof(uint32_t)) + CMSG_SPACE(sizeof(struct timespec))];
+
+    for (;;) {
+        for (int i = 0; i < rxBatchSize; i++) {
+            iovecs[i].iov_base                = mRxBatchBuffers + i * maxPermittedDatagramSize;
+            iovecs[i].iov_len                 = maxPermittedDatagramSize;
+            headers[i].msg_hdr.msg_name       = nullptr;
+            headers[i].msg_hdr.msg_namelen    = 0;
+            headers[i].msg_hdr.msg_iov        = &iovecs[i];
+            headers[i].msg_hdr.msg_iovlen     = 1;
+            headers[i].msg_hdr.msg_control    = controls[i];
+            headers[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+            headers[i].msg_hdr.msg_flags      = 0;
+            headers[i].msg_len                = 0;
+        }
+
+        const int count = recvmmsg(socket, headers, rxBatchSize, MSG_DONTWAIT, nullptr);
+        if (count < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                LOG("udpchannel:readCallback", "recvmmsg failed: %s", strerror(errno));
+            }
+            return;
+        }
+        if (count == 0) {
+            return;
+        }
+        RxBatches++;
+        RxDatagrams += count;
+        RxBatchSizes[batchSizeBucket(count)]++;
+
+        for (int i = 0; i < count; i++) {
+            auto &message  = headers[i].msg_hdr;
+            mRxTimestampNs = 0;
+            for (auto *cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+                if (cmsg->cmsg_level != SOL_SOCKET) {
+                    continue;
+                }
+                if (cmsg->cmsg_type == SO_RXQ_OVFL) {
+                    uint32_t dropsSeen;
+                    ::memcpy(&dropsSeen, CMSG_DATA(cmsg), sizeof(dropsSeen));
+                    RxKernelDrops += dropsSeen - mKernelDropsSeen;
+                    mKernelDropsSeen = dropsSeen;
+                } else if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                    struct timespec received;
+                    ::memcpy(&received, CMSG_DATA(cmsg), sizeof(received));
+                    mRxTimestampNs = static_cast<int64_t>(received.tv_sec) * 1000000000 + received.tv_nsec;
+                }
+            }
+            processDatagram(static_cast<unsigned char *>(iovecs[i].iov_base), static_cast<int>(headers[i].msg_len));
+        }
+
+        // a short batch means the socket has been drained.
+        if (count < rxBatchSize) {
+            return;
+        }
+    }
+}
+#endif
 
+void UDPChannel::processDatagram(unsigned char *datagram, int dgSize) {
     if (dgSize > maxPermittedDatagramSize) {
         LOG("udpchannel:readCallback", "recv'd datagram %d bytes, exceeding configured maximum of %d", dgSize, maxPermittedDatagramSize);
         return;
@@ -71,32 +202,24 @@ void UDPChannel::readCallback(const Poco::AutoPtr<Poco::Net::ReadableNotificatio
         LOG("udpchannel:readCallback", "recv'd zero-length datagram.  Discarding");
         return;
     }
-    if (dgSize < 0) {
-        LOG("udpchannel:readCallback", "recv failed: %s", mPocoUDPSocket.impl()->socketError());
-        return;
-    }
 
-    std::string      channelTag, dtoName;
-    sequence_t       seq;
-    msgpack::sbuffer dtoBuf;
-    CryptoDtoMode    cipherMode;
-
-    if (!Decapsulate(mDatagramRxBuffer, dgSize, channelTag, seq, cipherMode, dtoName, dtoBuf)) {
+    DecapsulatedDto dto;
+    if (!Decapsulate(datagram, dgSize, dto)) {
         LOG("udpchannel:readCallback", "recv'd invalid cryptodto frame.  Discarding");
         return;
     }
-    if (!RxModeEnabled(cipherMode)) {
+    if (!RxModeEnabled(dto.mode)) {
         LOG("udpchannel:readCallback", "got frame encrypted with undesired mode");
         return;
     }
-    if (channelTag != ChannelTag) {
+    if (dto.channelTag != ChannelTag) {
         LOG("udpchannel:readCallback", "recv'd with invalid Tag.  Discarding");
         return;
     }
-    auto rxOk = receiveSequence.Received(seq);
+    auto rxOk = receiveSequence.Received(dto.sequence);
     switch (rxOk) {
         case ReceiveOutcome::Before:
-            LOG("udpchannel:readCallback", "recv'd duplicate sequence %d.  Discarding.", seq);
+            LOG("udpchannel:readCallback", "recv'd duplicate sequence %d.  Discarding.", dto.sequence);
             return;
         case ReceiveOutcome::OK:
             break;
@@ -104,67 +227,115 @@ void UDPChannel::readCallback(const Poco::AutoPtr<Poco::Net::ReadableNotificatio
             break;
     }
     // validate that the packet has a valid payload.
-    if (dtoBuf.size() < 2) {
+    if (dto.bodyLen < 2) {
         LOG("udpchannel:readCallback", "internal dto had bad length (too short)");
         return;
     }
     uint16_t dtoSize;
-    ::memcpy(&dtoSize, dtoBuf.data(), 2);
-    if (dtoSize != dtoBuf.size() - 2) {
+    ::memcpy(&dtoSize, dto.body, 2);
+    if (dtoSize != dto.bodyLen - 2) {
         LOG("udpchannel:readCallback", "internal dto had bad length (length encoded mismatched datagram size)");
         return;
     }
-    auto dtoIter = mDtoHandlers.find(dtoName);
-    if (dtoIter == mDtoHandlers.end()) {
-        LOG("udpchannel:readCallback", "no handler for packet-type %s", dtoName.c_str());
+    const auto &slot = mDtoHandlers[static_cast<size_t>(dtoIdFromName(dto.dtoName))];
+    if (slot.handler == nullptr) {
+        LOG("udpchannel:readCallback", "no handler for packet-type %.*s", static_cast<int>(dto.dtoName.size()), dto.dtoName.data());
         return;
+    }
+    if (dto.bodyLen == 2) {
+        slot.handler(nullptr, 0, slot.user_data);
     } else {
-        if (dtoBuf.size() == 2) {
-            dtoIter->second(nullptr, 0);
-        } else {
-            dtoIter->second(reinterpret_cast<const unsigned char *>(dtoBuf.data()) + 2, dtoBuf.size() - 2);
-        }
+        slot.handler(dto.body + 2, dto.bodyLen - 2, slot.user_data);
+    }
+}
+
+/** setSocketOption sets an integer socket option, logging if it couldn't. */
+static bool setSocketOption(evutil_socket_t socket, int level, int option, int value, const char *optionName) {
+    if (setsockopt(socket, level, option, reinterpret_cast<const char *>(&value), sizeof(value)) != 0) {
+        LOG("udpchannel", "couldn't set %s: %s", optionName, evutil_socket_error_to_string(EVUTIL_SOCKET_ERROR()));
+        return false;
     }
+    return true;
 }
 
 bool UDPChannel::open() {
-    mIsOpen = false;
+    close();
     if (mAddress.empty()) {
         LOG("udpchannel", "tried to open without address set");
         return false;
     }
-    Poco::Net::SocketAddress socketAddress(mAddress.c_str());
-    std::string              ipAddress = socketAddress.host().toString();
-    Poco::UInt16             port      = socketAddress.port();
-
-    Poco::Net::SocketAddress bindAddress(Poco::Net::IPAddress(), 0);
+    struct sockaddr_storage serverAddress;
+    int                     serverAddressLen = sizeof(serverAddress);
+    ::memset(&serverAddress, 0, sizeof(serverAddress));
+    if (evutil_parse_sockaddr_port(mAddress.c_str(), reinterpret_cast<struct sockaddr *>(&serverAddress), &serverAddressLen) != 0) {
+        LOG("udpchannel", "couldn't parse server address %s", mAddress.c_str());
+        return false;
+    }
 
     // Check if port is within the valid range
-    if (port < 1 || port > 65535) {
+    const uint16_t port = serverAddress.ss_family == AF_INET6 ? reinterpret_cast<struct sockaddr_in6 *>(&serverAddress)->sin6_port : reinterpret_cast<struct sockaddr_in *>(&serverAddress)->sin_port;
+    if (port == 0) {
         LOG("udpchannel", "Invalid port number");
         return false;
     }
 
-    try {
-        mPocoUDPSocket = Poco::Net::DatagramSocket();
-        mPocoUDPSocket.bind(bindAddress, true);
-        mPocoUDPSocket.setBlocking(false);
-        mPocoUDPSocket.connect(socketAddress);
-        mPocoSocketReactor.addEventHandler(mPocoUDPSocket, Poco::NObserver<UDPChannel, Poco::Net::ReadableNotification>(*this, &UDPChannel::readCallback));
-        mIsOpen = true;
-        return true;
-    } catch (const Poco::Exception &e) {
-        LOG("udpchannel", "Couldn't create UDP socket: %s", e.displayText().c_str());
+    evutil_socket_t newSocket = ::socket(serverAddress.ss_family, SOCK_DGRAM, IPPROTO_UDP);
+    if (newSocket == EVUTIL_INVALID_SOCKET) {
+        mLastErrno = EVUTIL_SOCKET_ERROR();
+        LOG("udpchannel", "Couldn't create UDP socket: %s", evutil_socket_error_to_string(mLastErrno));
+        return false;
+    }
+    evutil_make_socket_nonblocking(newSocket);
+    evutil_make_socket_closeonexec(newSocket);
+    if (mReceiveBufferSize > 0) {
+        setSocketOption(newSocket, SOL_SOCKET, SO_RCVBUF, mReceiveBufferSize, "SO_RCVBUF");
+    }
+    if (mSendBufferSize > 0) {
+        setSocketOption(newSocket, SOL_SOCKET, SO_SNDBUF, mSendBufferSize, "SO_SNDBUF");
+    }
+#ifdef __linux__
+    // have the kernel tell us, with each datagram, how many it's had to drop, and when it arrived.
+    setSocketOption(newSocket, SOL_SOCKET, SO_RXQ_OVFL, 1, "SO_RXQ_OVFL");
+    setSocketOption(newSocket, SOL_SOCKET, SO_TIMESTAMPNS, 1, "SO_TIMESTAMPNS");
+    mKernelDropsSeen = 0;
+#endif
+    // connecting binds us to an ephemeral port, and filters out anything not from the server.
+    if (::connect(newSocket, reinterpret_cast<struct sockaddr *>(&serverAddress), serverAddressLen) != 0) {
+        mLastErrno = EVUTIL_SOCKET_ERROR();
+        LOG("udpchannel", "Couldn't connect UDP socket: %s", evutil_socket_error_to_string(mLastErrno));
+        evutil_closesocket(newSocket);
         return false;
     }
 
-    return false;
+    mReadEvent = event_new(mEvBase, newSocket, EV_READ | EV_PERSIST, &UDPChannel::evReadCallback, this);
+    if (mReadEvent == nullptr || event_add(mReadEvent, nullptr) != 0) {
+        LOG("udpchannel", "Couldn't watch UDP socket");
+        if (mReadEvent != nullptr) {
+            event_free(mReadEvent);
+            mReadEvent = nullptr;
+        }
+        evutil_closesocket(newSocket);
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> txGuard(mTxLock);
+        mSocket = newSocket;
+    }
+    mIsOpen = true;
+    return true;
 }
 
 void UDPChannel::close() {
-    if (mPocoUDPSocket.impl()) {
-        mPocoSocketReactor.removeEventHandler(mPocoUDPSocket, Poco::NObserver<UDPChannel, Poco::Net::ReadableNotification>(*this, &UDPChannel::readCallback));
-        mPocoUDPSocket.close();
+    if (mReadEvent != nullptr) {
+        event_free(mReadEvent);
+        mReadEvent = nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> txGuard(mTxLock);
+        if (mSocket != EVUTIL_INVALID_SOCKET) {
+            evutil_closesocket(mSocket);
+            mSocket = EVUTIL_INVALID_SOCKET;
+        }
     }
     mIsOpen = false;
     receiveSequence.reset();
@@ -175,7 +346,16 @@ void UDPChannel::setAddress(const std::string &address) {
 }
 
 bool UDPChannel::isOpen() const {
-    return mIsOpen && mPocoUDPSocket.impl();
+    return mIsOpen;
+}
+
+void UDPChannel::setSocketBufferSizes(int receiveBytes, int sendBytes) {
+    mReceiveBufferSize = receiveBytes;
+    mSendBufferSize    = sendBytes;
+}
+
+int64_t UDPChannel::getRxTimestampNs() const {
+    return mRxTimestampNs;
 }
 
 void UDPChannel::enableRxMode(CryptoDtoMode mode) {
@@ -204,8 +384,11 @@ bool UDPChannel::RxModeEnabled(CryptoDtoMode mode) const {
     return mask == (mAcceptableCiphers & mask);
 }
 
-void UDPChannel::unregisterDtoHandler(const std::string &dtoName) {
-    mDtoHandlers.erase(dtoName);
+void UDPChannel::unregisterDtoHandler(DtoId id) {
+    if (id >= DtoId::Count) {
+        return;
+    }
+    mDtoHandlers[static_cast<size_t>(id)] = DtoHandlerSlot();
 }
 
 int UDPChannel::getLastErrno() const {
@@ -218,5 +401,15 @@ void UDPChannel::setChannelConfig(const dto::ChannelConfig &config) {
     if (::memcmp(aeadReceiveKey, config.AeadReceiveKey, aeadModeKeySize) != 0) {
         receiveSequence.reset();
     }
+    // the header templates are rebuilt, so keep sendDto from using them meanwhile.
+    std::lock_guard<std::mutex> txGuard(mTxLock);
     Channel::setChannelConfig(config);
 }
+
+void UDPChannel::logStatistics() {
+    LOG("udpchannel", "Received %d datagrams in %d reads, kernel drops: %d", RxDatagrams.load(), RxBatches.load(), RxKernelDrops.load());
+    LOG("udpchannel", "Batch sizes: 1: %d, 2-3: %d, 4-7: %d, 8-15: %d, 16: %d", RxBatchSizes[0].load(), RxBatchSizes[1].load(),
+        RxBatchSizes[2].load(), RxBatchSizes[3].load(), RxBatchSizes[4].load());
+    LOG("udpchannel", "Replay window of %u: %d duplicates, %d late, %d window overflows", receiveSequence.GetWindow(),
+        receiveSequence.Duplicates.load(), receiveSequence.Late.load(), receiveSequence.Overflows.load());
+}
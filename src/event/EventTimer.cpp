@@ -64,3 +64,7 @@ void EventTimer::enable(unsigned int delayMs) {
 void EventTimer::disable() {
     event_del(mEvent);
 }
+
+void EventTimer::activate() {
+    event_active(mEvent, EV_TIMEOUT, 0);
+}
@@ -0,0 +1,72 @@
+#include "afv-native/util/Semaphore.h"
+
+#if defined(_WIN32)
+#include <climits>
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#else
+#include <cerrno>
+#include <semaphore.h>
+#endif
+
+using namespace afv_native::util;
+
+#if defined(_WIN32)
+struct Semaphore::Impl {
+    HANDLE handle = CreateSemaphore(nullptr, 0, LONG_MAX, nullptr);
+    ~Impl() {
+        CloseHandle(handle);
+    }
+};
+
+void Semaphore::post() {
+    ReleaseSemaphore(mImpl->handle, 1, nullptr);
+}
+
+void Semaphore::wait() {
+    WaitForSingleObject(mImpl->handle, INFINITE);
+}
+#elif defined(__APPLE__)
+// macOS only has named POSIX semaphores, so use dispatch's instead.
+struct Semaphore::Impl {
+    dispatch_semaphore_t handle = dispatch_semaphore_create(0);
+    ~Impl() {
+        dispatch_release(handle);
+    }
+};
+
+void Semaphore::post() {
+    dispatch_semaphore_signal(mImpl->handle);
+}
+
+void Semaphore::wait() {
+    dispatch_semaphore_wait(mImpl->handle, DISPATCH_TIME_FOREVER);
+}
+#else
+struct Semaphore::Impl {
+    sem_t handle;
+    Impl() {
+        sem_init(&handle, 0, 0);
+    }
+    ~Impl() {
+        sem_destroy(&handle);
+    }
+};
+
+void Semaphore::post() {
+    sem_post(&mImpl->handle);
+}
+
+void Semaphore::wait() {
+    // a signal handler can interrupt the wait before anything was posted.
+    while (sem_wait(&mImpl->handle) != 0 && errno == EINTR) {
+    }
+}
+#endif
+
+Semaphore::Semaphore():
+    mImpl(new Impl()) {
+}
+
+Semaphore::~Semaphore() = default;
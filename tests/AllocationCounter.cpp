@@ -0,0 +1,97 @@
+#include "AllocationCounter.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace afv_native::test;
+
+/** gAllocations only counts while gCountAllocations is set, so that the runner's own setup is left
+ * out.
+ */
+static std::atomic<bool>     gCountAllocations(false);
+static std::atomic<uint64_t> gAllocations(0);
+
+void AllocationCounter::start() {
+    gAllocations.store(0);
+    gCountAllocations.store(true);
+}
+
+uint64_t AllocationCounter::stop() {
+    gCountAllocations.store(false);
+    return gAllocations.load();
+}
+
+static void *countedAllocate(std::size_t size) {
+    if (gCountAllocations.load(std::memory_order_relaxed)) {
+        gAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    void *block = std::malloc(size > 0 ? size : 1);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+static void *countedAllocateAligned(std::size_t size, std::align_val_t alignment) {
+    if (gCountAllocations.load(std::memory_order_relaxed)) {
+        gAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    void *block = nullptr;
+    if (posix_memalign(&block, std::max(sizeof(void *), static_cast<std::size_t>(alignment)), size > 0 ? size : 1) != 0) {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+void *operator new(std::size_t size) {
+    return countedAllocate(size);
+}
+void *operator new[](std::size_t size) {
+    return countedAllocate(size);
+}
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return countedAllocate(size);
+    } catch (const std::bad_alloc &) {
+        return nullptr;
+    }
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return countedAllocate(size);
+    } catch (const std::bad_alloc &) {
+        return nullptr;
+    }
+}
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    return countedAllocateAligned(size, alignment);
+}
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+    return countedAllocateAligned(size, alignment);
+}
+void operator delete(void *block) noexcept {
+    std::free(block);
+}
+void operator delete[](void *block) noexcept {
+    std::free(block);
+}
+void operator delete(void *block, std::size_t) noexcept {
+    std::free(block);
+}
+void operator delete[](void *block, std::size_t) noexcept {
+    std::free(block);
+}
+void operator delete(void *block, std::align_val_t) noexcept {
+    std::free(block);
+}
+void operator delete[](void *block, std::align_val_t) noexcept {
+    std::free(block);
+}
+void operator delete(void *block, std::size_t, std::align_val_t) noexcept {
+    std::free(block);
+}
+void operator delete[](void *block, std::size_t, std::align_val_t) noexcept {
+    std::free(block);
+}
+
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+
+namespace afv_native { namespace test {
+    /** AllocationCounter counts the calls made to the global operator new between start and stop,
+     * on any thread, by the test runner and the library alike.
+     *
+     * Only operator new is replaced, so allocations the C libraries make with malloc themselves
+     * aren't counted.
+     */
+    class AllocationCounter {
+      public:
+        static void start();
+        /** stop returns the number of allocations made since start. */
+        static uint64_t stop();
+    };
+}} // namespace afv_native::test
@@ -0,0 +1,64 @@
+#include "AllocationCounter.h"
+#include "TestHarness.h"
+#include "TestSimulation.h"
+#include "afv-native/afv/ATCRadioSimulation.h"
+#include "afv-native/afv/HeadlessRenderer.h"
+#include <string>
+
+using namespace afv_native;
+using namespace afv_native::afv;
+using namespace afv_native::test;
+
+static const unsigned int headsetFrequency = 122800000;
+static const unsigned int speakerFrequency = 121500000;
+
+/** warmUpTicks is long enough for both streams to be set up and playing. */
+static const uint64_t warmUpTicks   = 20;
+static const uint64_t measuredTicks = 100;
+
+/** countSteadyStateAllocations has a stream transmit to each output for longer than the run, and
+ * returns the number of allocations made while delivering and rendering once both are playing.
+ */
+static uint64_t countSteadyStateAllocations(HeadlessRenderer &renderer) {
+    const auto tone = HeadlessRenderer::encodeTone(1000.0, 0.5f, warmUpTicks + measuredTicks + 10);
+    for (unsigned int frequency: {headsetFrequency, speakerFrequency}) {
+        dto::RxTransceiver transceiver;
+        transceiver.ID            = 0;
+        transceiver.Frequency     = frequency;
+        transceiver.DistanceRatio = 1.0f;
+        // too long for the small string buffer, so that a std::string made per packet is counted.
+        renderer.addTransmission(0, "LONG-CALLSIGN-TEST-" + std::to_string(frequency), {transceiver}, tone);
+    }
+
+    renderer.run(warmUpTicks);
+    AllocationCounter::start();
+    const auto stats       = renderer.run(measuredTicks);
+    const auto allocations = AllocationCounter::stop();
+
+    AFV_CHECK(stats.packets == 2 * measuredTicks);
+    return allocations;
+}
+
+AFV_TEST(PilotRenderDoesNotAllocate) {
+    EventBase evBase;
+    auto      simulation = makePilotSimulation(evBase, 2);
+    simulation->setFrequency(0, headsetFrequency);
+    simulation->setFrequency(1, speakerFrequency);
+    simulation->setOnHeadset(1, false);
+    HeadlessRenderer renderer(simulation);
+
+    AFV_CHECK(countSteadyStateAllocations(renderer) == 0);
+}
+
+AFV_TEST(AtcRenderDoesNotAllocate) {
+    EventBase evBase;
+    auto      resources  = std::make_shared<EffectResources>("afv-native-test-no-effects");
+    auto      simulation = std::make_shared<ATCRadioSimulation>(evBase.get(), resources, nullptr);
+    simulation->addFrequency(headsetFrequency, true);
+    simulation->addFrequency(speakerFrequency, false);
+    simulation->setRx(headsetFrequency, true);
+    simulation->setRx(speakerFrequency, true);
+    HeadlessRenderer renderer(simulation);
+
+    AFV_CHECK(countSteadyStateAllocations(renderer) == 0);
+}
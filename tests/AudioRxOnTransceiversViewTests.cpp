@@ -0,0 +1,38 @@
+#include "TestHarness.h"
+#include "afv-native/afv/dto/voice_server/AudioRxOnTransceiversView.h"
+#include <cstring>
+#include <vector>
+
+using namespace afv_native::afv::dto;
+
+/** packetWithAudio returns an encoded AudioRxOnTransceivers from TEST, with three bytes of audio
+ * after audioMarker (and audioLengthByte, unless it's 0), and one transceiver on 122.8 MHz.
+ */
+static std::vector<unsigned char> packetWithAudio(unsigned char audioMarker, unsigned char audioLengthByte) {
+    std::vector<unsigned char> pkt = {0x95, 0xa4, 'T', 'E', 'S', 'T', 0x07, audioMarker};
+    if (audioLengthByte != 0) {
+        pkt.push_back(audioLengthByte);
+    }
+    pkt.insert(pkt.end(), {0x01, 0x02, 0x03, 0xc3, 0x91, 0x93, 0x00, 0xce, 0x07, 0x51, 0xc7, 0x80, 0x01});
+    return pkt;
+}
+
+AFV_TEST(AudioRxOnTransceiversViewAcceptsStrAudio) {
+    // msgpack-c would convert the audio from a bin, or from any width of str.
+    const std::vector<std::vector<unsigned char>> packets = {
+        packetWithAudio(0xc4, 0x03), packetWithAudio(0xa3, 0x00), packetWithAudio(0xd9, 0x03)};
+    const unsigned char expectedAudio[] = {0x01, 0x02, 0x03};
+
+    for (const auto &pkt: packets) {
+        AudioRxOnTransceiversView view;
+        AFV_CHECK(view.decode(pkt.data(), pkt.size()));
+        AFV_CHECK(view.Callsign == "TEST");
+        AFV_CHECK(view.SequenceCounter == 7);
+        AFV_CHECK(view.AudioLength == sizeof(expectedAudio));
+        AFV_CHECK(view.Audio != nullptr && ::memcmp(view.Audio, expectedAudio, sizeof(expectedAudio)) == 0);
+        AFV_CHECK(view.LastPacket);
+        AFV_CHECK(view.TransceiverCount == 1);
+        AFV_CHECK(view.Transceivers[0].Frequency == 122800000);
+        AFV_CHECK(view.Transceivers[0].DistanceRatio == 1.0f);
+    }
+}
@@ -0,0 +1,71 @@
+#include "BenchHarness.h"
+#include "afv-native/Log.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace afv_native;
+using namespace afv_native::test;
+
+struct RegisteredBench {
+    const char   *name;
+    BenchFunction bench;
+};
+
+/** registeredBenches is a function so that it's constructed before the first registration,
+ * whichever file that's in.
+ */
+static std::vector<RegisteredBench> &registeredBenches() {
+    static std::vector<RegisteredBench> benches;
+    return benches;
+}
+
+BenchRegistration::BenchRegistration(const char *name, BenchFunction bench) {
+    registeredBenches().push_back({name, bench});
+}
+
+static int gFailedBenches = 0;
+
+void afv_native::test::reportTiming(const char *label, size_t iterations, uint64_t elapsedNs) {
+    const double nsEach = iterations ? static_cast<double>(elapsedNs) / iterations : 0.0;
+    const double perSec = nsEach > 0.0 ? 1e9 / nsEach : 0.0;
+    printf("%-56s %12.1f ns %12.0f/s  (%zu runs)\n", label, nsEach, perSec, iterations);
+}
+
+void afv_native::test::reportFailure(const char *bench, const char *reason) {
+    fprintf(stderr, "%s: %s\n", bench, reason);
+    gFailedBenches++;
+}
+
+/** Runs the benchmarks named on the command line, or all of them if there are none. */
+int main(int argc, char **argv) {
+    afv_native::setLogger(nullptr);
+
+    size_t                    iterations = 2000;
+    std::vector<const char *> selected;
+    for (int arg = 1; arg < argc; arg++) {
+        if (strcmp(argv[arg], "--iterations") == 0 && arg + 1 < argc) {
+            iterations = strtoul(argv[++arg], nullptr, 10);
+        } else {
+            selected.push_back(argv[arg]);
+        }
+    }
+
+    int ranBenches = 0;
+    for (const auto &registered: registeredBenches()) {
+        bool run = selected.empty();
+        for (const char *name: selected) {
+            run = run || strcmp(name, registered.name) == 0;
+        }
+        if (run) {
+            registered.bench(iterations);
+            ranBenches++;
+        }
+    }
+    if (ranBenches == 0) {
+        fprintf(stderr, "no benchmarks matched\n");
+        return 1;
+    }
+    return gFailedBenches > 0 ? 1 : 0;
+}
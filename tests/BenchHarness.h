@@ -0,0 +1,43 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace afv_native { namespace test {
+    /** BenchFunction is a benchmark.  It times iterations runs of its work with timeIterations. */
+    typedef void (*BenchFunction)(size_t iterations);
+
+    /** BenchRegistration adds a benchmark to the runner when it's constructed - see AFV_BENCH. */
+    class BenchRegistration {
+      public:
+        BenchRegistration(const char *name, BenchFunction bench);
+    };
+
+    /** reportTiming prints how long each of iterations runs of label took on average, and so how
+     * many runs - packets, frames - that is per second.
+     */
+    void reportTiming(const char *label, size_t iterations, uint64_t elapsedNs);
+
+    /** reportFailure prints why a benchmark couldn't do its work, and fails the run. */
+    void reportFailure(const char *bench, const char *reason);
+
+    /** timeIterations runs work once to warm up, and then iterations more times, and reports the
+     * mean time each of those took as label.
+     */
+    template <typename Work>
+    void timeIterations(const char *label, size_t iterations, Work work) {
+        work();
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            work();
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        reportTiming(label, iterations, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+}} // namespace afv_native::test
+
+/** AFV_BENCH defines a benchmark called name, and registers it with the runner under that name. */
+#define AFV_BENCH(name)                                                           \
+    static void                                  name(size_t iterations);        \
+    static ::afv_native::test::BenchRegistration name##Registration(#name, &name); \
+    static void                                  name(size_t iterations)
@@ -0,0 +1,213 @@
+#include "BenchHarness.h"
+#include "afv-native/afv/dto/voice_server/AudioTxOnTransceivers.h"
+#include "afv-native/cryptodto/Channel.h"
+#include "afv-native/cryptodto/dto/ChannelConfig.h"
+#include <cstring>
+#include <openssl/evp.h>
+#include <vector>
+
+using namespace afv_native;
+using namespace afv_native::cryptodto;
+using namespace afv_native::test;
+
+/** makeConfig returns a channel config with its own keys, which peerConfig turns around for the
+ * other end of the channel.
+ */
+static dto::ChannelConfig makeConfig() {
+    dto::ChannelConfig config;
+    config.ChannelTag = "bench-channel-tag";
+    for (size_t i = 0; i < aeadModeKeySize; i++) {
+        config.AeadTransmitKey[i] = static_cast<unsigned char>(i);
+        config.AeadReceiveKey[i]  = static_cast<unsigned char>(0xff - i);
+    }
+    return config;
+}
+
+static dto::ChannelConfig peerConfig(const dto::ChannelConfig &config) {
+    dto::ChannelConfig peer(config);
+    ::memcpy(peer.AeadTransmitKey, config.AeadReceiveKey, aeadModeKeySize);
+    ::memcpy(peer.AeadReceiveKey, config.AeadTransmitKey, aeadModeKeySize);
+    return peer;
+}
+
+/** makeVoicePacket returns a voice packet the size of one of our own 20ms Opus frames. */
+static afv::dto::AudioTxOnTransceivers makeVoicePacket() {
+    afv::dto::AudioTxOnTransceivers pkt;
+    pkt.Callsign        = "BENCH01";
+    pkt.SequenceCounter = 0;
+    pkt.Audio.assign(40, 0x5a);
+    pkt.LastPacket = false;
+    afv::dto::TxTransceiver transceiver;
+    transceiver.ID = 0;
+    pkt.Transceivers.push_back(transceiver);
+    return pkt;
+}
+
+AFV_BENCH(ChannelEncapsulate) {
+    Channel channel;
+    channel.setChannelConfig(makeConfig());
+    const auto     pkt = makeVoicePacket();
+    DatagramBuffer datagram(1500);
+
+    sequence_t sequence = 0;
+    bool       sealed   = true;
+    timeIterations("Channel::Encapsulate, 40 byte voice packet", iterations, [&]() {
+        sealed = channel.Encapsulate(datagram, sequence++, CryptoModeChaCha20Poly1305, pkt) && sealed;
+    });
+    if (!sealed) {
+        reportFailure("ChannelEncapsulate", "couldn't build the datagram");
+    }
+}
+
+AFV_BENCH(ChannelDecapsulate) {
+    // a datagram is decrypted in place, so each run works on a fresh copy of the same one.
+    Channel sender, receiver;
+    sender.setChannelConfig(makeConfig());
+    receiver.setChannelConfig(peerConfig(makeConfig()));
+
+    DatagramBuffer datagram(1500);
+    if (!sender.Encapsulate(datagram, 1, CryptoModeChaCha20Poly1305, makeVoicePacket())) {
+        reportFailure("ChannelDecapsulate", "couldn't build the datagram");
+        return;
+    }
+    const std::vector<unsigned char> sealed(datagram.data(), datagram.data() + datagram.size());
+    std::vector<unsigned char>       scratch(sealed.size());
+
+    bool authentic = true;
+    timeIterations("Channel::Decapsulate, 40 byte voice packet", iterations, [&]() {
+        ::memcpy(scratch.data(), sealed.data(), sealed.size());
+        DecapsulatedDto dto;
+        authentic = receiver.Decapsulate(scratch.data(), scratch.size(), dto) && authentic;
+    });
+    if (!authentic) {
+        reportFailure("ChannelDecapsulate", "the datagram didn't decrypt");
+    }
+}
+
+/** CipherChannel opens up Channel's ChaCha20-Poly1305 calls, which use its keyed contexts. */
+class CipherChannel: public Channel {
+  public:
+    using Channel::decryptChaCha20Poly1305;
+    using Channel::encryptChaCha20Poly1305;
+};
+
+/** perPacketEncrypt is how Channel used to encrypt, for comparison: a cipher context was created,
+ * set up and keyed for every packet, and freed again.
+ */
+static size_t perPacketEncrypt(const unsigned char *key, unsigned char *cipherOut, const unsigned char *plainIn, size_t plainLen, sequence_t sequence, const unsigned char *aadIn, size_t aadLen) {
+    unsigned char nonce[aeadModeIVSize] = {};
+    ::memcpy(nonce + 4, &sequence, sizeof(sequence));
+
+    size_t cipherLen = 0;
+    int    encLen    = 0;
+    bool   ok        = false;
+    auto  *context   = EVP_CIPHER_CTX_new();
+    if (EVP_EncryptInit_ex(context, EVP_chacha20_poly1305(), nullptr, nullptr, nullptr) &&
+        EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_AEAD_SET_IVLEN, aeadModeIVSize, nullptr) &&
+        EVP_EncryptInit_ex(context, nullptr, nullptr, key, nonce) &&
+        EVP_EncryptUpdate(context, nullptr, &encLen, aadIn, static_cast<int>(aadLen)) &&
+        EVP_EncryptUpdate(context, cipherOut, &encLen, plainIn, static_cast<int>(plainLen))) {
+        cipherLen = encLen;
+        if (EVP_EncryptFinal_ex(context, cipherOut + cipherLen, &encLen)) {
+            cipherLen += encLen;
+            ok = EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_AEAD_GET_TAG, aeadModeTagSize, cipherOut + cipherLen);
+        }
+    }
+    EVP_CIPHER_CTX_free(context);
+    return ok ? cipherLen + aeadModeTagSize : 0;
+}
+
+/** perPacketDecrypt is the decrypting half of perPacketEncrypt. */
+static size_t perPacketDecrypt(const unsigned char *key, unsigned char *bodyOut, const unsigned char *cipherIn, size_t cipherLen, sequence_t sequence, const unsigned char *aadIn, size_t aadLen) {
+    if (cipherLen < static_cast<size_t>(aeadModeTagSize)) {
+        return 0;
+    }
+    unsigned char nonce[aeadModeIVSize] = {};
+    ::memcpy(nonce + 4, &sequence, sizeof(sequence));
+
+    size_t bodyLen = 0;
+    int    decLen  = 0;
+    bool   ok      = false;
+    auto  *context = EVP_CIPHER_CTX_new();
+    if (EVP_DecryptInit_ex(context, EVP_chacha20_poly1305(), nullptr, nullptr, nullptr) &&
+        EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_AEAD_SET_IVLEN, aeadModeIVSize, nullptr) &&
+        EVP_DecryptInit_ex(context, nullptr, nullptr, key, nonce) &&
+        EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_AEAD_SET_TAG, aeadModeTagSize, const_cast<unsigned char *>(cipherIn + cipherLen - aeadModeTagSize)) &&
+        EVP_DecryptUpdate(context, nullptr, &decLen, aadIn, static_cast<int>(aadLen)) &&
+        EVP_DecryptUpdate(context, bodyOut, &decLen, cipherIn, static_cast<int>(cipherLen - aeadModeTagSize))) {
+        bodyLen = decLen;
+        if (EVP_DecryptFinal_ex(context, bodyOut + bodyLen, &decLen)) {
+            bodyLen += decLen;
+            ok = true;
+        }
+    }
+    EVP_CIPHER_CTX_free(context);
+    return ok ? bodyLen : 0;
+}
+
+/** A voice datagram's sealed body - the DTO name and the packed packet - and the header before it,
+ * which is authenticated along with it.
+ */
+static const size_t benchAadLen   = 32;
+static const size_t benchPlainLen = 72;
+
+AFV_BENCH(ChannelEncrypt) {
+    const auto  config = makeConfig();
+    CipherChannel channel;
+    channel.setChannelConfig(config);
+
+    unsigned char aad[benchAadLen], plain[benchPlainLen];
+    unsigned char keyedOut[benchPlainLen + aeadModeTagSize], perPacketOut[benchPlainLen + aeadModeTagSize];
+    for (size_t i = 0; i < benchPlainLen; i++) {
+        plain[i] = static_cast<unsigned char>(i * 7);
+    }
+    ::memset(aad, 0xa5, sizeof(aad));
+
+    // both ways have to produce the same datagram.
+    const size_t keyedLen     = channel.encryptChaCha20Poly1305(keyedOut, plain, benchPlainLen, 1, aad, benchAadLen);
+    const size_t perPacketLen = perPacketEncrypt(config.AeadTransmitKey, perPacketOut, plain, benchPlainLen, 1, aad, benchAadLen);
+    if (keyedLen != sizeof(keyedOut) || perPacketLen != keyedLen || ::memcmp(keyedOut, perPacketOut, keyedLen) != 0) {
+        reportFailure("ChannelEncrypt", "the keyed and per packet contexts disagree");
+        return;
+    }
+
+    sequence_t sequence = 0;
+    timeIterations("ChaCha20-Poly1305 seal, keyed context", iterations, [&]() {
+        channel.encryptChaCha20Poly1305(keyedOut, plain, benchPlainLen, sequence++, aad, benchAadLen);
+    });
+    timeIterations("ChaCha20-Poly1305 seal, context per packet", iterations, [&]() {
+        perPacketEncrypt(config.AeadTransmitKey, perPacketOut, plain, benchPlainLen, sequence++, aad, benchAadLen);
+    });
+}
+
+AFV_BENCH(ChannelDecrypt) {
+    const auto    config = makeConfig();
+    CipherChannel sender, receiver;
+    sender.setChannelConfig(config);
+    receiver.setChannelConfig(peerConfig(config));
+
+    unsigned char aad[benchAadLen], plain[benchPlainLen];
+    unsigned char sealed[benchPlainLen + aeadModeTagSize], body[benchPlainLen];
+    for (size_t i = 0; i < benchPlainLen; i++) {
+        plain[i] = static_cast<unsigned char>(i * 7);
+    }
+    ::memset(aad, 0xa5, sizeof(aad));
+    if (sender.encryptChaCha20Poly1305(sealed, plain, benchPlainLen, 1, aad, benchAadLen) != sizeof(sealed)) {
+        reportFailure("ChannelDecrypt", "couldn't seal the packet");
+        return;
+    }
+
+    bool authentic = receiver.decryptChaCha20Poly1305(body, sealed, sizeof(sealed), 1, aad, benchAadLen) == benchPlainLen &&
+                     ::memcmp(body, plain, benchPlainLen) == 0;
+    authentic = authentic && perPacketDecrypt(config.AeadTransmitKey, body, sealed, sizeof(sealed), 1, aad, benchAadLen) == benchPlainLen &&
+                ::memcmp(body, plain, benchPlainLen) == 0;
+    timeIterations("ChaCha20-Poly1305 open, keyed context", iterations, [&]() {
+        authentic = receiver.decryptChaCha20Poly1305(body, sealed, sizeof(sealed), 1, aad, benchAadLen) == benchPlainLen && authentic;
+    });
+    timeIterations("ChaCha20-Poly1305 open, context per packet", iterations, [&]() {
+        authentic = perPacketDecrypt(config.AeadTransmitKey, body, sealed, sizeof(sealed), 1, aad, benchAadLen) == benchPlainLen && authentic;
+    });
+    if (!authentic) {
+        reportFailure("ChannelDecrypt", "the packet didn't decrypt");
+    }
+}
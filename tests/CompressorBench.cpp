@@ -0,0 +1,71 @@
+#include "BenchHarness.h"
+#include "TestSignals.h"
+#include "afv-native/audio/SimpleCompressorEffect.h"
+#include <compressor/compressor.h>
+#include <compressor/snd.h>
+#include <cstring>
+
+using namespace afv_native;
+using namespace afv_native::test;
+
+/** signalFrames is how many frames of input the benchmarks cycle through. */
+static const size_t signalFrames = 50;
+
+AFV_BENCH(CompressorFrame) {
+    const auto                     input = voicedSignal(signalFrames);
+    std::vector<audio::SampleType> output(audio::frameSizeSamples);
+    audio::SimpleCompressorEffect  compressor;
+
+    size_t frame = 0;
+    timeIterations("SimpleCompressorEffect::transformFrame", iterations, [&]() {
+        compressor.transformFrame(output.data(), input.data() + (frame++ % signalFrames) * audio::frameSizeSamples);
+    });
+}
+
+/** stereoTransformFrame is how SimpleCompressorEffect::transformFrame used to work, for comparison:
+ * the mono frame went through the left channel of two stereo buffers allocated for each frame.
+ */
+static void stereoTransformFrame(sf_compressor_state_st &state, audio::SampleType *bufferOut, const audio::SampleType *bufferIn) {
+    sf_snd output_snd = sf_snd_new(audio::frameSizeSamples, audio::sampleRateHz, true);
+    sf_snd input_snd  = sf_snd_new(audio::frameSizeSamples, audio::sampleRateHz, true);
+
+    for (size_t i = 0; i < audio::frameSizeSamples; i++) {
+        input_snd->samples[i].L = bufferIn[i];
+    }
+    sf_compressor_process(&state, audio::frameSizeSamples, input_snd->samples, output_snd->samples);
+    for (size_t i = 0; i < audio::frameSizeSamples; i++) {
+        bufferOut[i] = static_cast<audio::SampleType>(output_snd->samples[i].L);
+    }
+
+    sf_snd_free(input_snd);
+    sf_snd_free(output_snd);
+}
+
+AFV_BENCH(CompressorFrameStereo) {
+    const auto                     input = voicedSignal(signalFrames);
+    std::vector<audio::SampleType> output(audio::frameSizeSamples);
+
+    // the old path has to agree with the one it's being compared against.
+    {
+        audio::SimpleCompressorEffect  compressor;
+        sf_compressor_state_st         state;
+        std::vector<audio::SampleType> expected(audio::frameSizeSamples);
+        sf_defaultcomp(&state, audio::sampleRateHz);
+        for (size_t frame = 0; frame < signalFrames; frame++) {
+            const audio::SampleType *frameIn = input.data() + frame * audio::frameSizeSamples;
+            compressor.transformFrame(expected.data(), frameIn);
+            stereoTransformFrame(state, output.data(), frameIn);
+            if (::memcmp(expected.data(), output.data(), audio::frameSizeSamples * sizeof(audio::SampleType)) != 0) {
+                reportFailure("CompressorFrameStereo", "the stereo path's output differs from transformFrame's");
+                return;
+            }
+        }
+    }
+
+    sf_compressor_state_st state;
+    sf_defaultcomp(&state, audio::sampleRateHz);
+    size_t frame = 0;
+    timeIterations("sf_compressor_process, allocating stereo sf_snds", iterations, [&]() {
+        stereoTransformFrame(state, output.data(), input.data() + (frame++ % signalFrames) * audio::frameSizeSamples);
+    });
+}
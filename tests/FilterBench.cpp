@@ -0,0 +1,60 @@
+#include "BenchHarness.h"
+#include "TestSignals.h"
+#include "afv-native/audio/BiQuadCascade.h"
+#include "afv-native/audio/Kernels.h"
+#include "afv-native/audio/VHFFilterSource.h"
+#include <cstring>
+#include <string>
+
+using namespace afv_native;
+using namespace afv_native::audio;
+using namespace afv_native::test;
+
+/** signalFrames is how many frames of input the benchmarks cycle through. */
+static const size_t signalFrames = 50;
+
+/** benchSections is the Schmid ED-137B filter chain, as VHFFilterSource builds it. */
+static constexpr BiQuadSection benchSections[] = {
+    biquad::highPass(sampleRateHz, 310, 0.25),
+    biquad::peakingEQ(sampleRateHz, 450, 0.75, 12.0),
+    biquad::peakingEQ(sampleRateHz, 1450, 1.0, 20.0),
+    biquad::peakingEQ(sampleRateHz, 2000, 1.0, 20.0),
+    biquad::lowPass(sampleRateHz, 2500, 0.25),
+};
+
+AFV_BENCH(BiQuadCascadeFrame) {
+    kernels::selectImplementation();
+    const auto              input = voicedSignal(signalFrames);
+    std::vector<SampleType> buffer(frameSizeSamples);
+    BiQuadCascade           cascade(benchSections);
+
+    // the copy in is part of what's timed, but it's small beside the filtering.
+    size_t            frame = 0;
+    const std::string label = std::string("BiQuadCascade::process, 5 sections (") + kernels::implementationName() + ")";
+    timeIterations(label.c_str(), iterations, [&]() {
+        ::memcpy(buffer.data(), input.data() + (frame++ % signalFrames) * frameSizeSamples, frameSizeBytes);
+        cascade.process(buffer.data(), frameSizeSamples);
+    });
+}
+
+AFV_BENCH(VhfFilterFrame) {
+    kernels::selectImplementation();
+    const auto              input = voicedSignal(signalFrames);
+    std::vector<SampleType> output(frameSizeSamples);
+
+    const struct {
+        HardwareType hardware;
+        const char  *label;
+    } presets[] = {
+        {HardwareType::Schmid_ED_137B, "VHFFilterSource::transformFrame, Schmid ED-137B"},
+        {HardwareType::Garex_220, "VHFFilterSource::transformFrame, Garex 220"},
+        {HardwareType::Rockwell_Collins_2100, "VHFFilterSource::transformFrame, Rockwell Collins 2100"},
+    };
+    for (const auto &preset: presets) {
+        VHFFilterSource filter(preset.hardware);
+        size_t          frame = 0;
+        timeIterations(preset.label, iterations, [&]() {
+            filter.transformFrame(output.data(), input.data() + (frame++ % signalFrames) * frameSizeSamples);
+        });
+    }
+}
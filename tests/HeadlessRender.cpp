@@ -0,0 +1,92 @@
+#include "TestSimulation.h"
+#include "afv-native/Log.h"
+#include "afv-native/afv/ATCRadioSimulation.h"
+#include "afv-native/afv/HeadlessRenderer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+using namespace afv_native;
+using namespace afv_native::afv;
+using namespace afv_native::test;
+
+/** The streams are spread across one frequency heard on the headset and one on the speaker. */
+static const unsigned int frequencies[2] = {122800000, 121500000};
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--atc] [--streams N] [--ticks N] [--wav PREFIX]\n", argv0);
+    fprintf(stderr, "  renders N streams for N ticks with no audio device, and reports how fast.\n");
+    fprintf(stderr, "  --wav saves each output to PREFIX-headset.wav and PREFIX-speaker.wav.\n");
+}
+
+/** Renders a number of concurrent transmissions through a radio simulation on HeadlessRenderer's
+ * virtual clock, and logs the frame rate and per-stage render timings.
+ */
+int main(int argc, char **argv) {
+    bool        atc         = false;
+    unsigned    streamCount = 4;
+    uint64_t    tickCount   = 3000;
+    std::string wavPrefix;
+    for (int arg = 1; arg < argc; arg++) {
+        if (strcmp(argv[arg], "--atc") == 0) {
+            atc = true;
+        } else if (strcmp(argv[arg], "--streams") == 0 && arg + 1 < argc) {
+            streamCount = static_cast<unsigned>(strtoul(argv[++arg], nullptr, 10));
+        } else if (strcmp(argv[arg], "--ticks") == 0 && arg + 1 < argc) {
+            tickCount = strtoull(argv[++arg], nullptr, 10);
+        } else if (strcmp(argv[arg], "--wav") == 0 && arg + 1 < argc) {
+            wavPrefix = argv[++arg];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    afv_native::setLogger([](std::string subsystem, std::string, int, std::string lineOut) {
+        fprintf(stderr, "%s: %s\n", subsystem.c_str(), lineOut.c_str());
+    });
+
+    EventBase                         evBase;
+    std::unique_ptr<HeadlessRenderer> renderer;
+    if (atc) {
+        auto resources  = std::make_shared<EffectResources>("afv-native-test-no-effects");
+        auto simulation = std::make_shared<ATCRadioSimulation>(evBase.get(), resources, nullptr);
+        simulation->addFrequency(frequencies[0], true);
+        simulation->addFrequency(frequencies[1], false);
+        simulation->setRx(frequencies[0], true);
+        simulation->setRx(frequencies[1], true);
+        renderer.reset(new HeadlessRenderer(simulation));
+    } else {
+        auto simulation = makePilotSimulation(evBase, 2);
+        simulation->setFrequency(0, frequencies[0]);
+        simulation->setFrequency(1, frequencies[1]);
+        simulation->setOnHeadset(1, false);
+        renderer.reset(new HeadlessRenderer(simulation));
+    }
+
+    // every stream transmits the same tone for the whole run, from its own callsign.
+    const auto tone = HeadlessRenderer::encodeTone(1000.0, 0.25f, tickCount);
+    for (unsigned stream = 0; stream < streamCount; stream++) {
+        dto::RxTransceiver transceiver;
+        transceiver.ID            = 0;
+        transceiver.Frequency     = frequencies[stream % 2];
+        transceiver.DistanceRatio = 1.0f;
+        renderer->addTransmission(0, "HEADLESS" + std::to_string(stream), {transceiver}, tone);
+    }
+
+    renderer->setCapture(!wavPrefix.empty());
+    HeadlessRenderer::logStats(renderer->run(tickCount));
+
+    if (!wavPrefix.empty()) {
+        for (bool onHeadset: {true, false}) {
+            const std::string fileName = wavPrefix + (onHeadset ? "-headset.wav" : "-speaker.wav");
+            if (!renderer->saveWav(onHeadset, fileName)) {
+                fprintf(stderr, "couldn't write %s\n", fileName.c_str());
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "TestHarness.h"
+#include "TestSimulation.h"
+#include "afv-native/afv/ATCRadioSimulation.h"
+#include "afv-native/afv/HeadlessRenderer.h"
+#include <algorithm>
+#include <cmath>
+#include <event2/event.h>
+
+using namespace afv_native;
+using namespace afv_native::afv;
+using namespace afv_native::test;
+
+static const unsigned int headsetFrequency = 122800000;
+static const unsigned int speakerFrequency = 121500000;
+
+/** peakBetween returns the loudest sample a mono output rendered from firstTick up to lastTick. */
+static audio::SampleType peakBetween(const std::vector<audio::SampleType> &output, uint64_t firstTick, uint64_t lastTick) {
+    const size_t first = std::min(output.size(), static_cast<size_t>(firstTick * audio::frameSizeSamples));
+    const size_t last  = std::min(output.size(), static_cast<size_t>(lastTick * audio::frameSizeSamples));
+
+    audio::SampleType peak = 0.0f;
+    for (size_t i = first; i < last; i++) {
+        peak = std::max(peak, std::fabs(output[i]));
+    }
+    return peak;
+}
+
+static dto::RxTransceiver transceiverOn(unsigned int frequency) {
+    dto::RxTransceiver transceiver;
+    transceiver.ID            = 0;
+    transceiver.Frequency     = frequency;
+    transceiver.DistanceRatio = 1.0f;
+    return transceiver;
+}
+
+/** renderTwoTransmissions renders a transmission on the headset radio from tick 5, and one on the
+ * speaker radio from tick 100, and returns what both outputs rendered.
+ */
+static HeadlessRenderer::Stats renderTwoTransmissions(std::vector<audio::SampleType> &headset, std::vector<audio::SampleType> &speaker) {
+    EventBase evBase;
+    auto      simulation = makePilotSimulation(evBase, 2);
+    simulation->setFrequency(0, headsetFrequency);
+    simulation->setFrequency(1, speakerFrequency);
+    simulation->setOnHeadset(1, false);
+
+    HeadlessRenderer renderer(simulation);
+    const auto       tone = HeadlessRenderer::encodeTone(1000.0, 0.5f, 50);
+    renderer.addTransmission(5, "TEST1", {transceiverOn(headsetFrequency)}, tone);
+    renderer.addTransmission(100, "TEST2", {transceiverOn(speakerFrequency)}, tone);
+    renderer.setCapture(true);
+
+    const auto stats = renderer.run(200);
+    headset          = renderer.getCapturedOutput(true);
+    speaker          = renderer.getCapturedOutput(false);
+    return stats;
+}
+
+AFV_TEST(HeadlessRendererRoutesToOutputs) {
+    std::vector<audio::SampleType> headset, speaker;
+    const auto                     stats = renderTwoTransmissions(headset, speaker);
+
+    AFV_CHECK(stats.ticks == 200);
+    AFV_CHECK(stats.packets == 100);
+    AFV_CHECK(stats.headset.frames == 200);
+    AFV_CHECK(stats.speaker.frames == 200);
+    AFV_CHECK(headset.size() == 200 * audio::frameSizeSamples);
+    AFV_CHECK(speaker.size() == 200 * audio::frameSizeSamples);
+
+    // each transmission is only heard on the output its radio is on, and only while it's playing.
+    AFV_CHECK(peakBetween(headset, 0, 5) == 0.0f);
+    AFV_CHECK(peakBetween(headset, 5, 100) > 0.01f);
+    AFV_CHECK(peakBetween(headset, 100, 200) == 0.0f);
+    AFV_CHECK(peakBetween(speaker, 0, 100) == 0.0f);
+    AFV_CHECK(peakBetween(speaker, 100, 200) > 0.01f);
+}
+
+AFV_TEST(HeadlessRendererIsDeterministic) {
+    // the packets are timed by the renderer's virtual clock, so the host's speed mustn't matter.
+    std::vector<audio::SampleType> firstHeadset, firstSpeaker;
+    std::vector<audio::SampleType> secondHeadset, secondSpeaker;
+    renderTwoTransmissions(firstHeadset, firstSpeaker);
+    renderTwoTransmissions(secondHeadset, secondSpeaker);
+
+    AFV_CHECK(firstHeadset == secondHeadset);
+    AFV_CHECK(firstSpeaker == secondSpeaker);
+}
+
+AFV_TEST(AtcRxEventsWaitForTheEventLoop) {
+    EventBase evBase;
+    auto      resources  = std::make_shared<EffectResources>("afv-native-test-no-effects");
+    auto      simulation = std::make_shared<ATCRadioSimulation>(evBase.get(), resources, nullptr);
+    simulation->addFrequency(headsetFrequency, true);
+    simulation->setRx(headsetFrequency, true);
+    HeadlessRenderer renderer(simulation);
+
+    std::vector<ClientEventType> events;
+    renderer.Events.addCallback(&events, [&events](ClientEventType event, void *, void *) {
+        if (event == ClientEventType::FrequencyRxBegin || event == ClientEventType::FrequencyRxEnd) {
+            events.push_back(event);
+        }
+    });
+    renderer.addTransmission(0, "TEST1", {transceiverOn(headsetFrequency)}, HeadlessRenderer::encodeTone(1000.0, 0.5f, 10));
+
+    // the renderer only notes that the frequency has started receiving - the event loop reports it.
+    renderer.run(5);
+    AFV_CHECK(events.empty());
+    event_base_loop(evBase.get(), EVLOOP_NONBLOCK);
+    AFV_CHECK(events == std::vector<ClientEventType>{ClientEventType::FrequencyRxBegin});
+
+    renderer.run(50);
+    AFV_CHECK(events.size() == 1);
+    event_base_loop(evBase.get(), EVLOOP_NONBLOCK);
+    AFV_CHECK(events == (std::vector<ClientEventType>{ClientEventType::FrequencyRxBegin, ClientEventType::FrequencyRxEnd}));
+}
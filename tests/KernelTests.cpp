@@ -0,0 +1,20 @@
+#include "TestHarness.h"
+#include "afv-native/audio/Kernels.h"
+#include <cmath>
+#include <limits>
+
+using namespace afv_native;
+
+AFV_TEST(GainClampFlushesNaN) {
+    // long enough for the vector kernels' main loops, with a few left over for their scalar tail,
+    // and a NaN in both.
+    const audio::SampleType nan = std::numeric_limits<audio::SampleType>::quiet_NaN();
+    audio::SampleType buf[19] = {0.25f, nan, 3.0f, -3.0f, 0.5f, -0.5f, nan, 0.0f, 1.0f, -1.0f, nan, 0.75f, 2.0f, -2.0f, 0.1f, -0.1f, nan, 4.0f, -4.0f};
+    const audio::SampleType expected[19] = {0.5f, 0.0f, 1.0f, -1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 1.0f, 1.0f, -1.0f, 0.2f, -0.2f, 0.0f, 1.0f, -1.0f};
+
+    audio::kernels::gainClamp(buf, 2.0f, 19);
+    for (size_t i = 0; i < 19; i++) {
+        AFV_CHECK(!std::isnan(buf[i]));
+        AFV_CHECK(buf[i] == expected[i]);
+    }
+}
@@ -0,0 +1,115 @@
+#include "TestHarness.h"
+#include "TestSignals.h"
+#include "afv-native/afv/HeadlessRenderer.h"
+#include "afv-native/afv/RemoteVoiceSource.h"
+#include "afv-native/afv/VoiceCompressionSink.h"
+#include "afv-native/afv/dto/voice_server/AudioRxOnTransceiversView.h"
+#include <opus/opus.h>
+#include <vector>
+
+using namespace afv_native;
+using namespace afv_native::afv;
+using namespace afv_native::test;
+
+/** The source is driven directly by the test, one frame tick after another, with each packet
+ * arriving at epochMs plus its tick's worth of frames.
+ */
+static const util::monotime_t epochMs = 1000000;
+
+static util::monotime_t tickTime(uint64_t tick) {
+    return epochMs + static_cast<util::monotime_t>(tick) * audio::frameLengthMs;
+}
+
+static void deliver(RemoteVoiceSource &source, const std::vector<unsigned char> &frame, uint32_t sequence, util::monotime_t now) {
+    dto::AudioRxOnTransceivers pkt;
+    pkt.Callsign        = "TEST";
+    pkt.SequenceCounter = sequence;
+    pkt.Audio           = frame;
+    pkt.LastPacket      = false;
+    source.appendAudioDTO(dto::AudioRxOnTransceiversView(pkt), now);
+}
+
+AFV_TEST(JitterStatisticsCountLateAndLostPackets) {
+    // packets arrive just in time to play, other than 10, which never arrives, and 20, which
+    // turns up long after its turn.
+    const uint32_t lostSequence = 10;
+    const uint32_t lateSequence = 20;
+    const uint64_t lateTick     = 38;
+    const uint64_t tickCount    = 40;
+
+    RemoteVoiceSource source;
+    const auto        frames = HeadlessRenderer::encodeTone(440.0, 0.5f, tickCount);
+    AFV_CHECK(frames.size() == tickCount);
+
+    for (uint64_t tick = 1; tick <= tickCount && frames.size() == tickCount; tick++) {
+        const auto sequence = static_cast<uint32_t>(tick - 1);
+        if (sequence != lostSequence && sequence != lateSequence) {
+            deliver(source, frames[sequence], sequence, tickTime(tick));
+        }
+        if (tick == lateTick) {
+            deliver(source, frames[lateSequence], lateSequence, tickTime(tick));
+        }
+        source.getCachedAudioFrame(tick, 0);
+    }
+
+    const auto stats = source.getJitterStatistics();
+    AFV_CHECK(stats.streams == 1);
+    AFV_CHECK(stats.packetsReceived == tickCount - 1);
+    // 20 was counted lost until it arrived, and then late instead.
+    AFV_CHECK(stats.packetsLost == 1);
+    AFV_CHECK(stats.packetsLate == 1);
+    AFV_CHECK(stats.packetQueueOverflows == 0);
+    // neither gap had the packet after it in time to rebuild it from.
+    AFV_CHECK(stats.framesRecovered == 0);
+    AFV_CHECK(stats.framesConcealed == 2);
+}
+
+/** encodeVoiced encodes frameCount frames of voicedSignal through the transmit path's encoder,
+ * with in-band FEC on.
+ */
+static std::vector<std::vector<unsigned char>> encodeVoiced(size_t frameCount) {
+    VoiceCompressionSink encoder;
+    encoder.setInbandFec(true, 20);
+
+    const auto                              samples = voicedSignal(frameCount);
+    std::vector<std::vector<unsigned char>> frames(frameCount);
+    for (size_t frame = 0; frame < frameCount; frame++) {
+        if (!encoder.encode(samples.data() + frame * audio::frameSizeSamples, frames[frame])) {
+            frames[frame].clear();
+        }
+    }
+    return frames;
+}
+
+AFV_TEST(LostFrameIsRecoveredFromFec) {
+    // every packet but 4 arrives before playback starts, so the one after the gap is always
+    // there to rebuild it from.
+    const uint32_t lostSequence = 4;
+    const uint64_t tickCount    = fecCacheDepth;
+
+    const auto frames = encodeVoiced(tickCount);
+    for (const auto &frame: frames) {
+        AFV_CHECK(!frame.empty());
+    }
+#ifdef AFV_NATIVE_HAVE_OPUS_PACKET_HAS_LBRR
+    // the test relies on the encoder having put the FEC data in.
+    const auto &nextFrame = frames[lostSequence + 1];
+    AFV_CHECK(opus_packet_has_lbrr(nextFrame.data(), static_cast<opus_int32>(nextFrame.size())) > 0);
+#endif
+
+    RemoteVoiceSource source;
+    for (uint32_t sequence = 0; sequence < tickCount; sequence++) {
+        if (sequence != lostSequence) {
+            deliver(source, frames[sequence], sequence, tickTime(1));
+        }
+    }
+    for (uint64_t tick = 1; tick <= tickCount; tick++) {
+        AFV_CHECK(source.getCachedAudioFrame(tick, 0) != nullptr);
+    }
+
+    const auto stats = source.getJitterStatistics();
+    AFV_CHECK(stats.packetsReceived == tickCount - 1);
+    AFV_CHECK(stats.packetsLost == 1);
+    AFV_CHECK(stats.framesRecovered == 1);
+    AFV_CHECK(stats.framesConcealed == 0);
+}
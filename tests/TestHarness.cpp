@@ -0,0 +1,60 @@
+#include "TestHarness.h"
+#include "afv-native/Log.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace afv_native::test;
+
+struct RegisteredTest {
+    const char  *name;
+    TestFunction test;
+};
+
+/** registeredTests is a function so that it's constructed before the first registration, whichever
+ * file that's in.
+ */
+static std::vector<RegisteredTest> &registeredTests() {
+    static std::vector<RegisteredTest> tests;
+    return tests;
+}
+
+static int gFailedChecks = 0;
+
+TestRegistration::TestRegistration(const char *name, TestFunction test) {
+    registeredTests().push_back({name, test});
+}
+
+void afv_native::test::checkFailed(const char *file, int line, const char *expression) {
+    fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+    gFailedChecks++;
+}
+
+/** Runs the tests named on the command line, or all of them if there are none. */
+int main(int argc, char **argv) {
+    // keep the library's logging out of the working directory.
+    afv_native::setLogger(nullptr);
+
+    int failedTests = 0;
+    int ranTests    = 0;
+    for (const auto &registered: registeredTests()) {
+        bool selected = (argc < 2);
+        for (int arg = 1; arg < argc; arg++) {
+            selected = selected || strcmp(argv[arg], registered.name) == 0;
+        }
+        if (!selected) {
+            continue;
+        }
+        const int failedBefore = gFailedChecks;
+        registered.test();
+        const bool passed = (gFailedChecks == failedBefore);
+        printf("%s: %s\n", registered.name, passed ? "ok" : "FAILED");
+        failedTests += passed ? 0 : 1;
+        ranTests++;
+    }
+    if (ranTests == 0) {
+        fprintf(stderr, "no tests matched\n");
+        return 1;
+    }
+    return failedTests > 0 ? 1 : 0;
+}
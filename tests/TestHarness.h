@@ -0,0 +1,29 @@
+#pragma once
+
+namespace afv_native { namespace test {
+    /** TestFunction is a test case.  It reports failures through AFV_CHECK, and passes if none fail. */
+    typedef void (*TestFunction)();
+
+    /** TestRegistration adds a test case to the runner when it's constructed - see AFV_TEST. */
+    class TestRegistration {
+      public:
+        TestRegistration(const char *name, TestFunction test);
+    };
+
+    /** checkFailed records a failed check against the test that's running. */
+    void checkFailed(const char *file, int line, const char *expression);
+}} // namespace afv_native::test
+
+/** AFV_TEST defines a test case called name, and registers it with the runner under that name. */
+#define AFV_TEST(name)                                                          \
+    static void                                 name();                         \
+    static ::afv_native::test::TestRegistration name##Registration(#name, &name); \
+    static void                                 name()
+
+/** AFV_CHECK fails the running test if expression is false, and carries on with it. */
+#define AFV_CHECK(expression)                                                 \
+    do {                                                                      \
+        if (!(expression)) {                                                  \
+            ::afv_native::test::checkFailed(__FILE__, __LINE__, #expression); \
+        }                                                                     \
+    } while (0)
@@ -0,0 +1,16 @@
+#include "TestSignals.h"
+#include <cmath>
+
+std::vector<afv_native::audio::SampleType> afv_native::test::voicedSignal(size_t frameCount) {
+    std::vector<audio::SampleType> samples(frameCount * audio::frameSizeSamples);
+    for (size_t i = 0; i < samples.size(); i++) {
+        const double t     = static_cast<double>(i) / audio::sampleRateHz;
+        const double swell = 0.6 + 0.4 * sin(2.0 * M_PI * 4.0 * t);
+        double       voice = 0.0;
+        for (int harmonic = 1; harmonic <= 20; harmonic++) {
+            voice += sin(2.0 * M_PI * 150.0 * harmonic * t) / harmonic;
+        }
+        samples[i] = static_cast<audio::SampleType>(0.2 * swell * voice);
+    }
+    return samples;
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include "afv-native/audio/audio_params.h"
+#include <cstddef>
+#include <vector>
+
+namespace afv_native { namespace test {
+    /** voicedSignal returns frameCount mono frames of a speech-like signal - a 150Hz harmonic series
+     * with a syllable rate swell, peaking a little under full scale.  Opus takes it for voice,
+     * where a plain tone is liable to be taken for background noise.
+     */
+    std::vector<audio::SampleType> voicedSignal(size_t frameCount);
+}} // namespace afv_native::test
@@ -0,0 +1,38 @@
+#pragma once
+#include "afv-native/afv/EffectResources.h"
+#include "afv-native/afv/RadioSimulation.h"
+#include <event2/event.h>
+#include <memory>
+
+namespace afv_native { namespace test {
+    /** EventBase owns a libevent base for a simulation to schedule its timers on.  The base is
+     * only dispatched by tests that do so themselves, so the timers don't otherwise fire - declare
+     * it ahead of anything using it, so that it's freed last.
+     */
+    class EventBase {
+      public:
+        EventBase():
+            mBase(event_base_new()) {
+        }
+        ~EventBase() {
+            event_base_free(mBase);
+        }
+        EventBase(const EventBase &) = delete;
+        EventBase &operator=(const EventBase &) = delete;
+
+        struct event_base *get() const {
+            return mBase;
+        }
+
+      private:
+        struct event_base *mBase;
+    };
+
+    /** makePilotSimulation returns a pilot radio simulation with radioCount radios, no voice
+     * channel and no effect samples (there are none in the tree), so it only ever renders voice.
+     */
+    inline std::shared_ptr<afv::RadioSimulation> makePilotSimulation(const EventBase &evBase, unsigned int radioCount) {
+        auto resources = std::make_shared<afv::EffectResources>("afv-native-test-no-effects");
+        return std::make_shared<afv::RadioSimulation>(evBase.get(), resources, nullptr, radioCount);
+    }
+}} // namespace afv_native::test